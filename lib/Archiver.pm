@@ -0,0 +1,539 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+#
+
+package Archiver;
+
+# Purpose
+# -------
+# Archive the remainings (datadir backups, cores, logs ...) of RQG runs with a result of interest
+# for rqg_batch.pl.
+#
+# Formats
+# -------
+# xz    -- archive.tar.xz made by Auxiliary::archive_results. Single threaded. (Default)
+# zstd  -- archive.tar.zst made by multi threaded zstd.
+# dedup -- Files >= ARCHIVE_CHUNK_SIZE get cut into chunks of that size. Every chunk gets stored
+#          zstd compressed and named by its SHA-256 in the chunk store
+#              <workdir of rqg_batch.pl>/archive_store/chunks/<first two hex digits>/<sha256>.zst
+#          which is shared by all RQG runs of the campaign. So the same mysqld binary, libraries
+#          captured by rr or unchanged regions of data files get stored only once.
+#          archive.manifest lists these files with their chunks. All other files are in
+#          archive.tar.zst. Use Archiver::restore for getting the original content back.
+#          Chunks get written to some temporary name first and than renamed. So concurrent
+#          archivers never see incomplete chunks and need no lock.
+#
+# Asynchronous archiving (archive_async)
+# --------------------------------------
+# The RQG worker does not archive. It only renames its fast and slow dir so that the next RQG
+# run on that worker cannot destroy the remainings, writes the marker ARCHIVE_PENDING and exits.
+# So the slot of the RQG worker is free again after seconds instead of minutes.
+# rqg_batch.pl enqueues the RQG run after having moved its workdir to the final place and runs
+# up to archive_jobs archivers in the background (poll). A resumed campaign enqueues all RQG runs
+# which have still the marker.
+#
+
+use strict;
+use Cwd;
+use Fcntl qw(:flock);
+use File::Basename;
+use File::Find;
+use File::Path;
+use POSIX ":sys_wait_h";
+use Digest::SHA;
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+use Local;
+
+use constant ARCHIVE_FORMAT_XZ      => 'xz';
+use constant ARCHIVE_FORMAT_ZSTD    => 'zstd';
+use constant ARCHIVE_FORMAT_DEDUP   => 'dedup';
+use constant ARCHIVE_FORMAT_DEFAULT => ARCHIVE_FORMAT_XZ;
+
+use constant ARCHIVE_STORE          => 'archive_store';
+use constant ARCHIVE_MANIFEST       => 'archive.manifest';
+use constant ARCHIVE_PENDING        => 'rqg_archive.pending';
+use constant ARCHIVE_STAGE_PREFIX   => 'archive_';
+use constant ARCHIVE_CHUNK_SIZE     => 1048576;
+use constant ARCHIVE_THREADS_DEFAULT => 2;
+use constant ARCHIVE_JOBS_DEFAULT    => 2;
+# Number of files handed over to one zstd call.
+use constant ARCHIVE_FILES_PER_CALL => 256;
+
+my $archive_format;
+my $archive_async;
+my $archive_threads;
+my $archive_jobs;
+my $store_dir;
+
+# Asynchronous archiving: RQG workdirs waiting and pid -> RQG workdir of running archivers.
+my @archive_queue;
+my %archiver_hash;
+
+sub check_and_set_archiver {
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- wrong value assigned or required compressor missing
+    my ($workdir, $format, $async, $threads, $jobs) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (5 != scalar @_ or not defined $workdir) {
+        my $status = STATUS_INTERNAL_ERROR;
+        Carp::cluck("INTERNAL ERROR: $who_am_i Exact five parameters(workdir, format, async, " .
+                    "threads, jobs) need to get assigned and workdir must be defined. " .
+                    Basics::exit_status_text($status));
+        safe_exit($status);
+    }
+    $format = ARCHIVE_FORMAT_DEFAULT if not defined $format;
+    if ($format ne ARCHIVE_FORMAT_XZ and $format ne ARCHIVE_FORMAT_ZSTD and
+        $format ne ARCHIVE_FORMAT_DEDUP) {
+        say("ERROR: $who_am_i The value '$format' assigned to archive_format is not supported.");
+        help();
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    my $compressor = ($format eq ARCHIVE_FORMAT_XZ) ? 'xz' : 'zstd';
+    if (STATUS_OK != Auxiliary::find_external_command($compressor)) {
+        say("ERROR: $who_am_i The compressor '$compressor' required for archive_format " .
+            "'$format' was not found.");
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $threads = ARCHIVE_THREADS_DEFAULT if not defined $threads;
+    $jobs    = ARCHIVE_JOBS_DEFAULT    if not defined $jobs;
+    if ($threads !~ m{^[0-9]+$} or $jobs !~ m{^[1-9][0-9]*$}) {
+        say("ERROR: $who_am_i archive_threads must be a non negative integer and archive_jobs " .
+            "a positive integer.");
+        help();
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $archive_format  = $format;
+    $archive_async   = $async ? 1 : 0;
+    $archive_threads = $threads;
+    $archive_jobs    = $jobs;
+    $store_dir       = $workdir . "/" . ARCHIVE_STORE;
+    if ($archive_format eq ARCHIVE_FORMAT_DEDUP) {
+        foreach my $dir ($store_dir, $store_dir . "/chunks", $store_dir . "/tmp") {
+            return STATUS_ENVIRONMENT_FAILURE if STATUS_OK != Basics::conditional_make_dir($dir);
+        }
+    }
+    say("INFO: $who_am_i archive_format '$archive_format', archive_async $archive_async" .
+        ($archive_async ? ", archive_jobs $archive_jobs" : "") . ".");
+    return STATUS_OK;
+}
+
+sub get_format {
+    return $archive_format;
+}
+
+sub is_async {
+    return $archive_async;
+}
+
+sub archive {
+# Archive the remainings of the RQG run with the workdir $rqg_workdir in the format selected.
+#
+# Return values
+# STATUS_OK      -- Success
+# STATUS_FAILURE -- No success
+    my ($rqg_workdir) = @_;
+
+    if      ($archive_format eq ARCHIVE_FORMAT_XZ)   {
+        return Auxiliary::archive_results($rqg_workdir);
+    }
+    return STATUS_FAILURE if STATUS_OK != Auxiliary::move_rr_traces($rqg_workdir);
+    Auxiliary::tweak_permissions($rqg_workdir);
+    if ($archive_format eq ARCHIVE_FORMAT_ZSTD) {
+        return tar_zstd($rqg_workdir, undef);
+    } else {
+        return archive_dedup($rqg_workdir);
+    }
+}
+
+sub zstd_command {
+    return "zstd -q -3 -T$archive_threads";
+}
+
+sub tar_zstd {
+# Write archive.tar.zst. $list_file undef means all except archive.* and rr traces.
+# Otherwise $list_file contains the NUL separated names of the objects to be archived.
+    my ($rqg_workdir, $list_file) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $archive     = $rqg_workdir . "/archive.tar.zst";
+    my $archive_err = $rqg_workdir . "/rqg_arch.err";
+    # See Auxiliary::archive_results for the reasons behind the options.
+    my $what = (defined $list_file) ? "--no-recursion --null --files-from=$list_file"
+                                    : "--exclude='./archive.*' --exclude='./*/rr' ./*";
+    my $cmd = "cd $rqg_workdir 2>>$archive_err; tar --create --file - --dereference $what " .
+              "2>>$archive_err | " . zstd_command() . " --stdout > $archive 2>>$archive_err";
+    say("DEBUG: cmd : ->$cmd<-") if Auxiliary::script_debug("A5");
+    system($cmd);
+    my $rc = $? >> 8;
+    my $status = STATUS_OK;
+    if ($rc != 0) {
+        say("ERROR: $who_am_i The command for archiving '$cmd' failed with exit status $rc");
+        sayFile($archive_err);
+        $status = STATUS_FAILURE;
+    }
+    unlink $archive_err;
+    return $status;
+}
+
+sub chunk_path {
+    my ($hash) = @_;
+    return $store_dir . "/chunks/" . substr($hash, 0, 2) . "/" . $hash . ".zst";
+}
+
+sub write_raw_file {
+# Basics::make_file appends a newline which is wrong for binary content.
+    my ($file, $content) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (not open(RAW_FILE, '>', $file)) {
+        say("ERROR: $who_am_i Open file '>$file' failed : $!");
+        return STATUS_FAILURE;
+    }
+    binmode RAW_FILE;
+    if (not print RAW_FILE $content or not close(RAW_FILE)) {
+        say("ERROR: $who_am_i Writing into '$file' failed : $!");
+        return STATUS_FAILURE;
+    }
+    return STATUS_OK;
+}
+
+sub store_chunks {
+# Split the big files into chunks, compress the chunks not yet in the store via $tmp_dir and
+# move them into the store. Add a line per file to $$manifest.
+    my ($rqg_workdir, $big_files, $tmp_dir, $manifest, $chunks_total, $chunks_new) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    # hash -> 1 for chunks written by us into $tmp_dir
+    my %new_chunk;
+    foreach my $rel (@$big_files) {
+        my $file = $rqg_workdir . "/" . $rel;
+        if (not open(CHUNK_IN, '<', $file)) {
+            say("ERROR: $who_am_i Open file '$file' failed : $!");
+            return STATUS_FAILURE;
+        }
+        binmode CHUNK_IN;
+        my @hashes;
+        my $buffer;
+        while (my $got = read(CHUNK_IN, $buffer, ARCHIVE_CHUNK_SIZE)) {
+            my $hash = Digest::SHA::sha256_hex($buffer);
+            push @hashes, $hash;
+            $$chunks_total++;
+            next if exists $new_chunk{$hash} or -e chunk_path($hash);
+            $new_chunk{$hash} = 1;
+            $$chunks_new++;
+            if (STATUS_OK != write_raw_file($tmp_dir . "/" . $hash, $buffer)) {
+                close(CHUNK_IN);
+                return STATUS_FAILURE;
+            }
+        }
+        close(CHUNK_IN);
+        my $mode = (stat($file))[2] & 07777;
+        $$manifest .= sprintf("%d\t%o\t%s\t%s\n", -s $file, $mode, join(',', @hashes), $rel);
+    }
+
+    my @new_list = sort keys %new_chunk;
+    while (my @part = splice(@new_list, 0, ARCHIVE_FILES_PER_CALL)) {
+        my $cmd = "cd $tmp_dir && " . zstd_command() . " --rm -- " . join(' ', @part);
+        system($cmd);
+        if ($? >> 8) {
+            say("ERROR: $who_am_i The command '$cmd' failed with exit status " . ($? >> 8));
+            return STATUS_FAILURE;
+        }
+        foreach my $hash (@part) {
+            my $target = chunk_path($hash);
+            return STATUS_FAILURE
+                if STATUS_OK != Basics::conditional_make_dir(File::Basename::dirname($target));
+            # Some concurrent archiver might have stored the same chunk meanwhile. No problem.
+            if (not rename($tmp_dir . "/" . $hash . ".zst", $target)) {
+                say("ERROR: $who_am_i Renaming the chunk to '$target' failed : $!");
+                return STATUS_FAILURE;
+            }
+        }
+    }
+    return STATUS_OK;
+}
+
+sub archive_dedup {
+    my ($rqg_workdir) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my @tar_list;
+    my @big_files;
+    my $wanted = sub {
+        my $rel = $File::Find::name;
+        $rel =~ s{^\Q$rqg_workdir\E}{.};
+        if ($rel =~ m{^\./archive\.} or $rel =~ m{^\./[^/]+/rr$}) {
+            $File::Find::prune = 1;
+            return;
+        }
+        return if $rel eq '.';
+        if (-f $File::Find::name and ARCHIVE_CHUNK_SIZE <= -s _) {
+            push @big_files, $rel;
+        } else {
+            push @tar_list, $rel;
+        }
+    };
+    # follow because of the excessive symlinking (tar --dereference in the other formats).
+    File::Find::find({ wanted => $wanted, follow_fast => 1, follow_skip => 2, no_chdir => 1 },
+                     $rqg_workdir);
+
+    my $manifest = "# RQG archive manifest 1 chunk_size=" . ARCHIVE_CHUNK_SIZE .
+                   " store=$store_dir\n";
+    my ($chunks_total, $chunks_new) = (0, 0);
+    my $tmp_dir = $store_dir . "/tmp/" . $$;
+    my $status  = Basics::conditional_remove__make_dir($tmp_dir);
+    $status = store_chunks($rqg_workdir, \@big_files, $tmp_dir, \$manifest, \$chunks_total,
+                           \$chunks_new) if STATUS_OK == $status;
+    File::Path::rmtree($tmp_dir);
+    return STATUS_FAILURE if STATUS_OK != $status;
+
+    my $list_file = $rqg_workdir . "/rqg_arch.list";
+    return STATUS_FAILURE
+        if STATUS_OK != write_raw_file($list_file, join('', map { $_ . "\0" } @tar_list));
+    $status = tar_zstd($rqg_workdir, $list_file);
+    unlink($list_file);
+    return $status if STATUS_OK != $status;
+    $status = Basics::make_file($rqg_workdir . "/" . ARCHIVE_MANIFEST, $manifest);
+    say("INFO: $who_am_i '$rqg_workdir': " . scalar(@big_files) . " files with $chunks_total " .
+        "chunks deduplicated, $chunks_new chunks were new.");
+    return $status;
+}
+
+sub restore {
+# Restore the content of some archive made with the format dedup into $target_dir.
+# Example:
+#     perl -I$RQG_HOME/lib -MArchiver -e 'Archiver::restore(<RQG run dir>, <target dir>)'
+    my ($run_dir, $target_dir) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    return STATUS_FAILURE if STATUS_OK != Basics::conditional_make_dir($target_dir);
+    system("zstd -dcq $run_dir/archive.tar.zst | tar --extract --file - -C $target_dir");
+    if ($? >> 8) {
+        say("ERROR: $who_am_i Extracting '$run_dir/archive.tar.zst' failed.");
+        return STATUS_FAILURE;
+    }
+    my $manifest = $run_dir . "/" . ARCHIVE_MANIFEST;
+    return STATUS_OK if not -f $manifest;
+    if (not open(MANIFEST, '<', $manifest)) {
+        say("ERROR: $who_am_i Open file '$manifest' failed : $!");
+        return STATUS_FAILURE;
+    }
+    my $header = <MANIFEST>;
+    if (not defined $header or $header !~ m{^# RQG archive manifest 1 .* store=(\S+)$}) {
+        say("ERROR: $who_am_i '$manifest' has no valid header.");
+        close(MANIFEST);
+        return STATUS_FAILURE;
+    }
+    $store_dir = $1;
+    while (my $line = <MANIFEST>) {
+        chomp $line;
+        next if $line eq '';
+        my ($size, $mode, $hashes, $rel) = split(/\t/, $line, 4);
+        my $file = $target_dir . "/" . $rel;
+        Basics::conditional_make_dir(File::Basename::dirname($file));
+        return STATUS_FAILURE if STATUS_OK != Basics::make_file($file, undef);
+        my @chunk_list = map { chunk_path($_) } split(/,/, $hashes);
+        while (my @part = splice(@chunk_list, 0, ARCHIVE_FILES_PER_CALL)) {
+            system("zstd -dcq -- " . join(' ', @part) . " >> '$file'");
+            if ($? >> 8) {
+                say("ERROR: $who_am_i Restoring '$file' failed. Chunk missing?");
+                close(MANIFEST);
+                return STATUS_FAILURE;
+            }
+        }
+        if ($size != -s $file) {
+            say("ERROR: $who_am_i '$file' has not the expected size $size.");
+            close(MANIFEST);
+            return STATUS_FAILURE;
+        }
+        chmod(oct($mode), $file);
+    }
+    close(MANIFEST);
+    return STATUS_OK;
+}
+
+#---------------------------------------------------------------------------------------------------
+# Asynchronous archiving
+
+sub stage {
+# Called by the RQG worker instead of archive.
+# Rename the fast and slow dir of the RQG worker, let the symlinks point to the new names and
+# leave the marker behind.
+#
+# Return values
+# STATUS_OK      -- Success
+# STATUS_FAILURE -- No success
+    my ($rqg_workdir, $worker_num) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    # old prefix -> new prefix
+    my %rename_hash;
+    foreach my $base (Local::get_rqg_fast_dir(), Local::get_rqg_slow_dir()) {
+        my $old = $base . "/" . $worker_num;
+        next if not -d $old;
+        my $new = $base . "/" . ARCHIVE_STAGE_PREFIX . $worker_num . "_" . $$;
+        if (not rename($old, $new)) {
+            say("ERROR: $who_am_i Renaming '$old' to '$new' failed : $!");
+            return STATUS_FAILURE;
+        }
+        $rename_hash{$old} = $new;
+    }
+    my $retarget = sub {
+        my $object = $File::Find::name;
+        return if not -l $object;
+        my $target = readlink($object);
+        foreach my $old (keys %rename_hash) {
+            if ($target =~ s{^\Q$old\E(/|$)}{$rename_hash{$old}$1}) {
+                unlink($object);
+                if (not symlink($target, $object)) {
+                    say("ERROR: $who_am_i Creating the symlink '$object' failed : $!");
+                }
+                last;
+            }
+        }
+    };
+    File::Find::find({ wanted => $retarget, no_chdir => 1 },
+                     $rqg_workdir, values %rename_hash);
+    my $marker = $rqg_workdir . "/" . ARCHIVE_PENDING;
+    return Basics::make_file($marker, join("\n", values %rename_hash));
+}
+
+sub enqueue {
+# The RQG workdir was moved to its final place $rqg_workdir. Archive it in the background.
+    my ($rqg_workdir) = @_;
+    return if grep { $_ eq $rqg_workdir } @archive_queue, values %archiver_hash;
+    push @archive_queue, $rqg_workdir;
+}
+
+sub enqueue_pending {
+# Resume of some campaign: Enqueue all RQG runs with pending archiving.
+    my ($workdir) = @_;
+    foreach my $marker (sort glob($workdir . "/[0-9]*/" . ARCHIVE_PENDING)) {
+        enqueue(File::Basename::dirname($marker));
+    }
+    say("INFO: Archiver: " . scalar(@archive_queue) . " RQG runs with pending archiving found.")
+        if 0 < scalar @archive_queue;
+}
+
+sub run_archiver {
+# Runs in the child process. Does the archiving of some staged RQG run.
+    my ($rqg_workdir) = @_;
+    my $who_am_i = "Archiver [$rqg_workdir]:";
+
+    my $marker = $rqg_workdir . "/" . ARCHIVE_PENDING;
+    # Some archiver of the previous rqg_batch.pl process might be still working on it.
+    if (not open(MARKER, '<', $marker) or not flock(MARKER, LOCK_EX | LOCK_NB)) {
+        say("INFO: $who_am_i Some other archiver is already working on it.");
+        safe_exit(STATUS_OK);
+    }
+    my @staged = grep { $_ ne '' } map { chomp; $_ } <MARKER>;
+    my $status = archive($rqg_workdir);
+    if (STATUS_OK != $status) {
+        say("ERROR: $who_am_i Archiving failed.");
+        Basics::append_string_to_file($rqg_workdir . "/rqg.log",
+                                      "ERROR: Archiving the remainings of the RQG test failed.\n");
+    }
+    chdir($rqg_workdir);
+    if (STATUS_OK != Auxiliary::clean_workdir_preserve($rqg_workdir)) {
+        say("ERROR: $who_am_i Auxiliary::clean_workdir_preserve failed.");
+        $status = STATUS_FAILURE;
+    }
+    foreach my $dir (@staged) {
+        File::Path::rmtree($dir);
+    }
+    unlink($marker);
+    close(MARKER);
+    safe_exit($status == STATUS_OK ? STATUS_OK : STATUS_ENVIRONMENT_FAILURE);
+}
+
+sub poll {
+# To be called in the main loops of rqg_batch.pl.
+# Reap finished archivers and start new ones.
+    my $who_am_i = Basics::who_am_i;
+
+    # Archiving disabled.
+    return if not defined $archive_jobs;
+    foreach my $pid (keys %archiver_hash) {
+        next if $pid != waitpid($pid, WNOHANG);
+        my $exit_status = $? >> 8;
+        say("WARN: $who_am_i Archiving '$archiver_hash{$pid}' failed.") if $exit_status;
+        delete $archiver_hash{$pid};
+    }
+    while (@archive_queue and $archive_jobs > scalar keys %archiver_hash) {
+        my $rqg_workdir = shift @archive_queue;
+        my $pid = fork();
+        if (not defined $pid) {
+            say("ERROR: $who_am_i fork failed : $!. Will try later.");
+            unshift @archive_queue, $rqg_workdir;
+            last;
+        }
+        if (0 == $pid) {
+            # Do not get killed together with rqg_batch.pl or some RQG worker.
+            setpgrp(0,0);
+            run_archiver($rqg_workdir);
+        }
+        $archiver_hash{$pid} = $rqg_workdir;
+    }
+}
+
+sub count_pending {
+    return scalar(@archive_queue) + scalar(keys %archiver_hash);
+}
+
+sub drain {
+# Wait till all archiving is done. To be called at the end of rqg_batch.pl.
+    my $who_am_i = Basics::who_am_i;
+    say("INFO: $who_am_i Waiting for " . count_pending() . " pending archivings.")
+        if count_pending();
+    while (count_pending()) {
+        poll();
+        sleep 1 if count_pending();
+    }
+}
+
+sub help {
+    print("\nHELP about the rqg_batch.pl options 'archive_format', 'archive_threads', "           .
+          "'archive_async' and\n'archive_jobs'.\n"                                               .
+          "--archive_format=<format>\n"                                                          .
+          "    " . ARCHIVE_FORMAT_XZ    . "    -- archive.tar.xz, single threaded xz\n"            .
+          "    " . ARCHIVE_FORMAT_ZSTD  . "  -- archive.tar.zst, multi threaded zstd\n"            .
+          "    " . ARCHIVE_FORMAT_DEDUP . " -- Files >= " . ARCHIVE_CHUNK_SIZE . " Byte get cut into chunks "  .
+          "which get stored\n"                                                                   .
+          "             once per campaign in <workdir>/" . ARCHIVE_STORE . ". archive.manifest "  .
+          "lists these files.\n"                                                                 .
+          "             Anything else is in archive.tar.zst. Restore with\n"                     .
+          "             perl -I\$RQG_HOME/lib -MArchiver -e "                                    .
+          "'Archiver::restore(\"<run dir>\", \"<target dir>\")'\n"                               .
+          "    (Default) " . ARCHIVE_FORMAT_DEFAULT . "\n"                                       .
+          "--archive_threads=<n>\n"                                                              .
+          "    Threads per zstd process. 0 means one per CPU core. (Default) "                   .
+          ARCHIVE_THREADS_DEFAULT . "\n"                                                         .
+          "--archive_async\n"                                                                    .
+          "    The RQG worker only preserves the remainings and is than free for the next RQG "   .
+          "run.\n"                                                                               .
+          "    Archiving happens in the background.\n"                                           .
+          "--archive_jobs=<n>\n"                                                                 .
+          "    Maximum number of archivers running in the background. (Default) "                .
+          ARCHIVE_JOBS_DEFAULT . "\n"                                                            .
+          "RQG runs performed by some agent get archived by the agent with xz.\n");
+}
+
+1;
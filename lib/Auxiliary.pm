@@ -24,6 +24,8 @@ use GenTest_e::Constants;
 use GenTest_e::Grammar;
 use Local;
 use File::Copy;
+use Time::HiRes;
+use POSIX ();
 
 # The script debugging "system"
 # -----------------------------
@@ -266,6 +268,8 @@ sub make_rqg_infrastructure {
     $my_file = $workdir . '/rqg_phase.init';
     $result  = Basics::make_file ($my_file, undef);
     return $result if $result;
+    # The processes of the RQG run do not exist yet.
+    append_rqg_phase_time($workdir, RQG_PHASE_INIT(), 0);
     $my_file = $workdir . '/rqg.job';
     $result  = Basics::make_file ($my_file, undef);
     return $result if $result;
@@ -485,10 +489,67 @@ sub set_rqg_phase {
         return STATUS_FAILURE;
     } else {
         # say("PHASE: $new_phase");
+        append_rqg_phase_time($workdir, $new_phase, get_process_group_cpu());
         return STATUS_OK;
     }
 } # End set_rqg_phase
 
+# Every phase change gets appended as line
+#     <phase> <unix timestamp with fraction> <CPU seconds consumed by the process group>
+# to that file. rqg_batch.pl aggregates these records (PhaseTimes.pm).
+use constant RQG_PHASE_TIMES_FILE         => 'rqg_phase.times';
+
+sub append_rqg_phase_time {
+# Failing to write the record must not harm the RQG run. So only a warning.
+    my ($workdir, $phase, $cpu) = @_;
+    my $line = sprintf("%s %.3f %.2f\n", $phase, Time::HiRes::time(), $cpu);
+    if (not open(PHASE_TIMES, '>>', $workdir . '/' . RQG_PHASE_TIMES_FILE)) {
+        say("WARN: Auxiliary::append_rqg_phase_time : Open '$workdir/" . RQG_PHASE_TIMES_FILE .
+            "' failed : $!");
+        return;
+    }
+    print PHASE_TIMES $line;
+    close(PHASE_TIMES);
+}
+
+sub get_process_group_cpu {
+#
+# Purpose
+# -------
+# Get the CPU time in s (user + system) consumed by the current process group.
+# RQG worker, RQG runner, DB servers and the tools started belong to the same process group
+# because the RQG worker had run setpgrp.
+# The CPU time of processes which are already gone counts only if they were reaped by some
+# member of the process group (cutime, cstime of the reaper).
+# If /proc is not available than only the current process and its reaped children count.
+#
+    my ($user, $system, $child_user, $child_system) = times();
+    my $cpu = $user + $system + $child_user + $child_system;
+    return $cpu if osWindows() or not -d '/proc/self';
+
+    my $pgrp = getpgrp();
+    my $ticks = POSIX::sysconf(POSIX::_SC_CLK_TCK()) || 100;
+    if (not opendir(PROC_DIR, '/proc')) {
+        return $cpu;
+    }
+    my $group_ticks = 0;
+    foreach my $pid (readdir(PROC_DIR)) {
+        next if $pid !~ m{^[0-9]+$};
+        next if not open(PROC_STAT, '<', "/proc/$pid/stat");
+        my $stat = <PROC_STAT>;
+        close(PROC_STAT);
+        next if not defined $stat;
+        # The command name in (...) could contain spaces. So split after it.
+        $stat =~ s{^.*\)\s+}{};
+        my @fields = split(/\s+/, $stat);
+        # Fields after the command: 0 state, 2 pgrp, 11 utime, 12 stime, 13 cutime, 14 cstime
+        next if not defined $fields[14] or $fields[2] != $pgrp;
+        $group_ticks += $fields[11] + $fields[12] + $fields[13] + $fields[14];
+    }
+    closedir(PROC_DIR);
+    return $group_ticks / $ticks;
+}
+
 sub get_rqg_phase {
 #
 # Purpose
@@ -1690,12 +1751,13 @@ sub describe_object {
     return STATUS_OK;
 }
 
-sub archive_results {
+sub move_rr_traces {
+# Move the rr trace directories of some RQG run to their final position below the RQG workdir.
 
     my $who_am_i = Basics::who_am_i();
     # say("DEBUG: $who_am_i --------------- begin");
 
-    my ($workdir, $vardir) = @_;
+    my ($workdir) = @_;
     if (not -d $workdir) {
         say("ERROR: $who_am_i RQG workdir '$workdir' is missing or not a directory.");
         return STATUS_FAILURE;
@@ -1752,6 +1814,18 @@ sub archive_results {
     }
     closedir(TOPDIR);
     # say("DEBUG: Finished processing of '$workdir'.");
+    return STATUS_OK;
+}
+
+sub archive_results {
+
+    my $who_am_i = Basics::who_am_i();
+    # say("DEBUG: $who_am_i --------------- begin");
+
+    my ($workdir, $vardir) = @_;
+    if (STATUS_OK != move_rr_traces($workdir)) {
+        return STATUS_FAILURE;
+    }
 
     my $compress_option;
     my $suffix;
@@ -2376,6 +2450,25 @@ sub unify_grammar {
             $grammar_obj          = $final_grammar_obj;
         }
     }
+    # Detect endless recursion now and not by the generator after bootstrap and gendata.
+    my $analysis = $grammar_obj->analyze();
+    foreach my $rule_name (@{$analysis->{all_recursive}}) {
+        say("WARN: Every component of the rule '$rule_name' references the rule itself.");
+    }
+    if (0 < scalar @{$analysis->{non_terminating}}) {
+        say("WARN: Every expansion of the rules '" . join("', '", @{$analysis->{non_terminating}}) .
+            "' is endless.");
+        my @top_rules = grep { GenTest_e::Grammar::is_top_rule($_) }
+                             @{$analysis->{non_terminating}};
+        if (0 < scalar @top_rules) {
+            say("ERROR: The top level rules '" . join("', '", @top_rules) . "' cannot generate " .
+                "any query. Will return undef.");
+            return undef;
+        }
+    }
+    say("DEBUG: The rules '" . join("', '", @{$analysis->{unreachable}}) . "' are not reachable " .
+        "from any top level rule.") if 0 < scalar @{$analysis->{unreachable}} and
+                                      Auxiliary::script_debug("R2");
     my $grammar_string = $grammar_obj->toString;
     $grammar_file = $workdir . "/rqg.yy";
     if (STATUS_OK != Basics::make_file($grammar_file, $grammar_string)) {
@@ -2825,7 +2918,7 @@ sub print_ps_group {
     say($ps_group);
 }
 
-use POSIX;
+use POSIX ();
 
 sub reapChild {
 # Usage
@@ -50,6 +50,11 @@ use Auxiliary;
 use Local;
 use Verdict;
 use ResourceControl;
+use Checkpoint;
+use PhaseTimes;
+use BatchMetrics;
+use Archiver;
+use RRTraces;
 use POSIX qw( WNOHANG );
 
 # Constants serving for more convenient printing of results in table layout
@@ -62,6 +67,10 @@ use constant RQG_WNO_LENGTH      => 6;              # practical Maximum is 1000
 use constant RQG_LOG_TITLE       => 'RQG log   ';   # 999999.log or <deleted>
 use constant RQG_LOG_LENGTH      => 10;             # 999999.log or <deleted>
 
+# Written into the RQG workdir before the result of the RQG run gets into the write ahead log.
+# Contains "<sequence of the WAL record>\t<target directory or empty if dropped>".
+use constant RQG_WAL_MARKER      => 'rqg.wal';
+
 use constant RQG_ORDERID_TITLE   => 'OrderId';
 use constant RQG_ORDERID_LENGTH  => 7;              # Maximum is 9999999/Title
 
@@ -278,6 +287,11 @@ use constant STOP_REASON_BATCH_LIMIT => 'batch_limit';
 #   max_rqg_runtime was exceeded
 #       == Stopping of that RQG worker is recommended.
 use constant STOP_REASON_RQG_LIMIT   => 'rqg_limit';
+#
+# - STOP_REASON_RESUME
+#   The RQG run was in work when the previous rqg_batch.pl process died and has not finished.
+#       == Repeating the RQG run is required.
+use constant STOP_REASON_RESUME      => 'resume';
 # than WORKER_STOP_REASON will be set and some corresponding entry will be later written
 # into the log of the RQG worker. The main reason doing this is to have more information about
 # what happened at rqg_batch.pl runtime. And this is required for discovering defects in the
@@ -858,7 +872,7 @@ sub check_resources {
         }
     }
 
-    if  (ResourceControl::LOAD_INCREASE eq $load_status) {
+    if  (ResourceControl::LOAD_INCREASE() eq $load_status) {
 
         # Never exceed $parallel_max because that could be a user or OS limit related border.
         return STATUS_FAILURE if $active_workers + 1 > $workers_max;
@@ -971,7 +985,7 @@ sub check_resources {
         return $return_status;
     }
 
-    if (ResourceControl::LOAD_KEEP eq $load_status) {
+    if (ResourceControl::LOAD_KEEP() eq $load_status) {
         if ($no_raise_before < $current_time + 30) {
             $no_raise_before = $current_time + 30;
         }
@@ -981,7 +995,7 @@ sub check_resources {
         return $return_status;
     }
 
-    if (ResourceControl::LOAD_DECREASE eq $load_status) {
+    if (ResourceControl::LOAD_DECREASE() eq $load_status) {
         my $problem_persists = 1;
         #  LOOP till the problem is fixed
         while ($problem_persists) {
@@ -1039,7 +1053,7 @@ sub check_resources {
                           "Will ask for emergency_exit.");
             }
             $load_status = ResourceControl::report($active_workers);
-            if (ResourceControl::LOAD_DECREASE ne $load_status) {
+            if (ResourceControl::LOAD_DECREASE() ne $load_status) {
                 $problem_persists = 0;
             } else {
                 # In case we would not use a sleep than we would stop all jobs because swap
@@ -1061,7 +1075,7 @@ sub check_resources {
         $return_status = STATUS_FAILURE;
     }
 
-    if (ResourceControl::LOAD_GIVE_UP eq $load_status) {
+    if (ResourceControl::LOAD_GIVE_UP() eq $load_status) {
         my $status = STATUS_ENVIRONMENT_FAILURE;
         emergency_exit($status, "ERROR: ResourceControl::report delivered '$load_status'. " .
                        "Will ask for emergency_exit.");
@@ -1163,163 +1177,7 @@ sub reap_workers {
                 # and make some radical cleanup.
                 kill '-9', $worker_process_group;
 
-                my $rqg_log       = "$rqg_workdir" . "/rqg.log";
-                my $rqg_job       = "$rqg_workdir" . "/rqg.job";
-
-                my ($verdict, $extra_info) = Verdict::get_rqg_verdict($rqg_workdir);
-                if (not defined $verdict) {
-                    Carp::cluck("verdict is undef.");
-                    emergency_exit(STATUS_INTERNAL_ERROR, "ERROR: This must not happen.");
-                }
-
-                $worker_array[$worker_num][WORKER_END] = time();
-                if (-1 == $worker_array[$worker_num][WORKER_START]) {
-                    # The parent (rqg_batch.pl) has never detected that the child (rqg.pl) started
-                    # to work. Hence WORKER_START is -1. And than in minimum the current RQG
-                    # worker had to be stopped because of maximum rqg_batch.pl runtime exceeded.
-                    # So we set here WORKER_START = WORKER_END in order to avoid strange total
-                    # runtime values like current unix timestamp in "result.txt".
-                    $worker_array[$worker_num][WORKER_START] = $worker_array[$worker_num][WORKER_END];
-                }
-                my $iso_ts = isoTimestamp();
-                if (defined $worker_array[$worker_num][WORKER_STOP_REASON]) {
-                    # The RQG worker was 'victim' of a stop with SIGKILL.
-                    # So write various information into the RQG run log which the RQG worker was
-                    # no more able to do.
-                    # Its no problem that this appended stuff will be not in the archive because
-                    # there is
-                    # - most likely no archive at all
-                    # - sometimes an archive harmed by the SIGKILL
-                    # - extreme unlikely a complete archive
-                    # ==> The archive gets thrown away in general.
-                    if ($worker_array[$worker_num][WORKER_STOP_REASON] eq STOP_REASON_RQG_LIMIT) {
-                        $verdict = Verdict::RQG_VERDICT_INTEREST;
-                    } else {
-                        $verdict = Verdict::RQG_VERDICT_IGNORE_STOPPED;
-                    }
-                    append_string_to_file($rqg_log, "# $iso_ts BATCH: Stop the run ".
-                        "because of '" . $worker_array[$worker_num][WORKER_STOP_REASON] . "'.\n" .
-                                                           "# $iso_ts Verdict: $verdict\n");
-                }
-
-                $worker_array[$worker_num][WORKER_VERDICT] = $verdict;
-                $worker_array[$worker_num][WORKER_V_INFO]  = $extra_info;
-                say("DEBUG: Worker [$worker_num] with (process) exit status " .
-                    "'$exit_status' and verdict '$verdict' reaped.") if Auxiliary::script_debug("T4");
-
-                # Prevent that some historic + fixed but evil bug can ever happen again.
-                if (not defined $verdict_collected) {
-                    Carp::cluck("INTERNAL ERROR: verdict_collected is undef.");
-                    emergency_exit(STATUS_INTERNAL_ERROR, "ERROR: This must not happen.");
-                }
-
-                my $target_prefix     = $workdir . "/" . Basics::lfill0($verdict_collected,
-                                                                           RQG_NO_LENGTH);
-                my $saved_log         = $target_prefix     . "/rqg.log";
-                $worker_array[$worker_num][WORKER_LOG] = $saved_log;
-                my $saved_job         = $target_prefix     . "/rqg.job";
-
-                $iso_ts = isoTimestamp();
-
-                # Note:
-                # The next routine is required because the standard failure handling is to make
-                # an emergency_exit and not just some simple exit.
-                sub drop_directory {
-                    my ($directory) = @_;
-                    if (-d $directory) {
-                        if(not File::Path::rmtree($directory)) {
-                            say("ERROR: Removal of the directory '$directory' failed. : $!.");
-                            emergency_exit(STATUS_ENVIRONMENT_FAILURE,
-                                "ERROR: This must not happen.");
-                        }
-                    }
-                }
-
-                if ($verdict eq Verdict::RQG_VERDICT_IGNORE           or
-                    $verdict eq Verdict::RQG_VERDICT_IGNORE_STATUS_OK or
-                    $verdict eq Verdict::RQG_VERDICT_IGNORE_STOPPED   or
-                    $verdict eq Verdict::RQG_VERDICT_IGNORE_UNWANTED    ) {
-                    if ($verdict eq Verdict::RQG_VERDICT_IGNORE_STOPPED) {
-                        $stopped++;
-                        # Do nothing with $order_array[$order_id][ORDER_EFFORTS*]
-                        $worker_array[$worker_num][WORKER_LOG] = "<deleted>";
-                        drop_directory($rqg_workdir);
-                    } else {
-                        if ($discard_logs) {
-                            $worker_array[$worker_num][WORKER_LOG] = "<deleted>";
-                            drop_directory($rqg_workdir);
-                        } else {
-                            # WARNING: The "move" does not work across filesystems.
-                            if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target_prefix)) {
-                                emergency_exit(STATUS_ENVIRONMENT_FAILURE,
-                                    "ERROR: This must not happen.");
-                            }
-                        }
-                    }
-                    $verdict_ignore++;
-                } elsif ($verdict eq Verdict::RQG_VERDICT_INTEREST or
-                         $verdict eq Verdict::RQG_VERDICT_REPLAY     ) {
-                    # WARNING: The "move" does not work across filesystems.
-                    if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target_prefix)) {
-                        emergency_exit(STATUS_ENVIRONMENT_FAILURE,
-                            "ERROR: This must not happen.");
-                    }
-                    say("DEBUG: '$rqg_workdir' moved to '$target_prefix'");
-                    if ($dryrun) {
-                        # We fake a RQG run and therefore some archive cannot exist.
-                    } else {
-                        my $rqg_arc = $target_prefix . "/archive.tar.xz";
-                        if (not -e $rqg_arc) {
-                            if (not $archive_warning_emitted) {
-                                say("WARN: Some archive does not exist. This might be " .
-                                    "intentional or a mistake. Further warnings of this kind " .
-                                    "will be suppressed.");
-                                $archive_warning_emitted = 1;
-                            }
-                        }
-                    }
-                    if ($verdict eq Verdict::RQG_VERDICT_INTEREST) {
-                        $verdict_interest++;
-                    } else {
-                        $verdict_replay++;
-                    }
-                } elsif ($verdict eq Verdict::RQG_VERDICT_INIT) {
-                    # The RQG worker was definitely not the 'victim' of a stop_worker because
-                    # that gets marked as RQG_VERDICT_STOPPED.
-                    # The RQG runner
-                    # - took over (->RQG_PHASE_START)
-                    # - did something
-                    # - disappeared before having reached a verdict
-                    # Most likely
-                    #   "ill" command line snip (generated by Simplifier/Combinator/...)
-                    #   which was not "accepted" by RQG runner (unknown or missing parameter).
-                    # Less likely
-                    #   Failure in environment (Example: Missing file) wrong (Example: croak)
-                    #   handled by RQG core.
-                    #   Perl aborts because of heavy failure in RQG core.
-                    # We might have a RQG log which maybe explains why the run failed so early.
-                    # We do not have an archive of remaining data and its also quite unlikely
-                    # that any remaining data would be valuable.
-                    # Letting the rqg_batch process generate an archive is a too big danger
-                    # (death during archiving or too long busy with just that) for control.
-                    # WARNING: The "move" does not work across filesystems.
-                    if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target_prefix)) {
-                        emergency_exit(STATUS_ENVIRONMENT_FAILURE,
-                            "ERROR: This must not happen.");
-                    }
-                    $verdict_init++;
-                    say("WARN: The final Verdict in '$saved_log' is RQG_VERDICT_INIT.");
-                    # Maybe touch ORDER_EFFORTS_INVESTED or ORDER_EFFORTS_LEFT
-                } else {
-                    emergency_exit(STATUS_CRITICAL_FAILURE,
-                        "INTERNAL ERROR: Final Verdict '$verdict' is not treated/unknown. " .
-                        "This should not happen.");
-                }
-                $verdict_collected++;
-                foreach my $dir (Local::get_rqg_fast_dir . $rqg_appendix,
-                                 Local::get_rqg_slow_dir . $rqg_appendix) {
-                    drop_directory($dir);
-                }
+                handle_finished_worker($worker_num, $exit_status);
             } elsif (-1 == $kid) {
                 say("ALARM: RQG worker $worker_num was already reaped.");
                 worker_reset($worker_num);
@@ -1360,6 +1218,239 @@ sub reap_workers {
 
 } # End sub reap_workers
 
+sub handle_finished_worker {
+# The main process of the RQG worker was reaped or is known to be gone.
+# Get the verdict, move or drop the workdir of the RQG run, maintain the counters and cleanup
+# the vardir of the RQG run.
+
+    my ($worker_num, $exit_status) = @_;
+
+    my $rqg_appendix  = "/" . $worker_num;
+    my $rqg_workdir   = "$workdir" . $rqg_appendix;
+
+    my $rqg_log       = "$rqg_workdir" . "/rqg.log";
+    my $rqg_job       = "$rqg_workdir" . "/rqg.job";
+
+    my ($verdict, $extra_info) = Verdict::get_rqg_verdict($rqg_workdir);
+    if (not defined $verdict) {
+        Carp::cluck("verdict is undef.");
+        emergency_exit(STATUS_INTERNAL_ERROR, "ERROR: This must not happen.");
+    }
+
+    $worker_array[$worker_num][WORKER_END] = time();
+    if (-1 == $worker_array[$worker_num][WORKER_START]) {
+        # The parent (rqg_batch.pl) has never detected that the child (rqg.pl) started
+        # to work. Hence WORKER_START is -1. And than in minimum the current RQG
+        # worker had to be stopped because of maximum rqg_batch.pl runtime exceeded.
+        # So we set here WORKER_START = WORKER_END in order to avoid strange total
+        # runtime values like current unix timestamp in "result.txt".
+        $worker_array[$worker_num][WORKER_START] = $worker_array[$worker_num][WORKER_END];
+    }
+    my $iso_ts = isoTimestamp();
+    if (defined $worker_array[$worker_num][WORKER_STOP_REASON]) {
+        # The RQG worker was 'victim' of a stop with SIGKILL.
+        # So write various information into the RQG run log which the RQG worker was
+        # no more able to do.
+        # Its no problem that this appended stuff will be not in the archive because
+        # there is
+        # - most likely no archive at all
+        # - sometimes an archive harmed by the SIGKILL
+        # - extreme unlikely a complete archive
+        # ==> The archive gets thrown away in general.
+        if ($worker_array[$worker_num][WORKER_STOP_REASON] eq STOP_REASON_RQG_LIMIT) {
+            $verdict = Verdict::RQG_VERDICT_INTEREST;
+        } else {
+            $verdict = Verdict::RQG_VERDICT_IGNORE_STOPPED;
+        }
+        append_string_to_file($rqg_log, "# $iso_ts BATCH: Stop the run ".
+            "because of '" . $worker_array[$worker_num][WORKER_STOP_REASON] . "'.\n" .
+                                               "# $iso_ts Verdict: $verdict\n");
+    }
+
+    $worker_array[$worker_num][WORKER_VERDICT] = $verdict;
+    $worker_array[$worker_num][WORKER_V_INFO]  = $extra_info;
+    my $finished_time = PhaseTimes::account_run($worker_num,
+                            $worker_array[$worker_num][WORKER_ORDER_ID],
+                            Basics::lfill0($verdict_collected, RQG_NO_LENGTH), $verdict,
+                            $rqg_workdir, $worker_array[$worker_num][WORKER_END]);
+    BatchMetrics::register_run($verdict,
+                 $worker_array[$worker_num][WORKER_END] - $worker_array[$worker_num][WORKER_START],
+                 $worker_array[$worker_num][WORKER_STOP_REASON],
+                 (defined $finished_time ? time() - $finished_time : undef));
+    say("DEBUG: Worker [$worker_num] with (process) exit status " .
+        "'$exit_status' and verdict '$verdict' reaped.") if Auxiliary::script_debug("T4");
+
+    # Prevent that some historic + fixed but evil bug can ever happen again.
+    if (not defined $verdict_collected) {
+        Carp::cluck("INTERNAL ERROR: verdict_collected is undef.");
+        emergency_exit(STATUS_INTERNAL_ERROR, "ERROR: This must not happen.");
+    }
+
+    my $target_prefix     = $workdir . "/" . Basics::lfill0($verdict_collected,
+                                                               RQG_NO_LENGTH);
+    my $saved_log         = $target_prefix     . "/rqg.log";
+    $worker_array[$worker_num][WORKER_LOG] = $saved_log;
+    my $saved_job         = $target_prefix     . "/rqg.job";
+    my $drop_workdir      = ($verdict eq Verdict::RQG_VERDICT_IGNORE_STOPPED or
+                             ($discard_logs and
+                              ($verdict eq Verdict::RQG_VERDICT_IGNORE           or
+                               $verdict eq Verdict::RQG_VERDICT_IGNORE_STATUS_OK or
+                               $verdict eq Verdict::RQG_VERDICT_IGNORE_UNWANTED    )));
+    $worker_array[$worker_num][WORKER_LOG] = "<deleted>" if $drop_workdir;
+    # Before the RQG workdir gets moved or dropped.
+    RRTraces::register($rqg_workdir, $verdict, $target_prefix);
+
+    # Write ahead log before moving or dropping the RQG workdir. So a result gets never lost
+    # even if we die in between. The marker tells resume_campaign that the RQG run is registered.
+    if (Checkpoint::is_enabled()) {
+        my $marker = $rqg_workdir . "/" . RQG_WAL_MARKER;
+        unlink($marker);
+        if (STATUS_OK != Basics::make_file($marker, (Checkpoint::get_wal_sequence() + 1) . "\t" .
+                                                    ($drop_workdir ? '' : $target_prefix))) {
+            emergency_exit(STATUS_ENVIRONMENT_FAILURE,
+                "ERROR: Writing the marker '$marker' failed.");
+        }
+    }
+    if (STATUS_OK != Checkpoint::append_wal(result_record($worker_num))) {
+        emergency_exit(STATUS_ENVIRONMENT_FAILURE,
+            "ERROR: Writing into the write ahead log failed.");
+    }
+
+    $iso_ts = isoTimestamp();
+
+    # Note:
+    # The next routine is required because the standard failure handling is to make
+    # an emergency_exit and not just some simple exit.
+    sub drop_directory {
+        my ($directory) = @_;
+        if (-d $directory) {
+            if(not File::Path::rmtree($directory)) {
+                say("ERROR: Removal of the directory '$directory' failed. : $!.");
+                emergency_exit(STATUS_ENVIRONMENT_FAILURE,
+                    "ERROR: This must not happen.");
+            }
+        }
+    }
+
+    if ($verdict eq Verdict::RQG_VERDICT_IGNORE           or
+        $verdict eq Verdict::RQG_VERDICT_IGNORE_STATUS_OK or
+        $verdict eq Verdict::RQG_VERDICT_IGNORE_STOPPED   or
+        $verdict eq Verdict::RQG_VERDICT_IGNORE_UNWANTED    ) {
+        if ($verdict eq Verdict::RQG_VERDICT_IGNORE_STOPPED) {
+            $stopped++;
+            # Do nothing with $order_array[$order_id][ORDER_EFFORTS*]
+            drop_directory($rqg_workdir);
+        } else {
+            if ($discard_logs) {
+                drop_directory($rqg_workdir);
+            } else {
+                # WARNING: The "move" does not work across filesystems.
+                if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target_prefix)) {
+                    emergency_exit(STATUS_ENVIRONMENT_FAILURE,
+                        "ERROR: This must not happen.");
+                }
+            }
+        }
+        $verdict_ignore++;
+    } elsif ($verdict eq Verdict::RQG_VERDICT_INTEREST or
+             $verdict eq Verdict::RQG_VERDICT_REPLAY     ) {
+        # WARNING: The "move" does not work across filesystems.
+        if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target_prefix)) {
+            emergency_exit(STATUS_ENVIRONMENT_FAILURE,
+                "ERROR: This must not happen.");
+        }
+        say("DEBUG: '$rqg_workdir' moved to '$target_prefix'");
+        if ($dryrun) {
+            # We fake a RQG run and therefore some archive cannot exist.
+        } else {
+            if (-e $target_prefix . "/" . Archiver::ARCHIVE_PENDING) {
+                # The RQG worker has only preserved the remainings.
+                Archiver::enqueue($target_prefix);
+            } elsif (not grep { -e $_ } glob($target_prefix . "/archive.*")) {
+                if (not $archive_warning_emitted) {
+                    say("WARN: Some archive does not exist. This might be " .
+                        "intentional or a mistake. Further warnings of this kind " .
+                        "will be suppressed.");
+                    $archive_warning_emitted = 1;
+                }
+            }
+        }
+        if ($verdict eq Verdict::RQG_VERDICT_INTEREST) {
+            $verdict_interest++;
+        } else {
+            $verdict_replay++;
+        }
+    } elsif ($verdict eq Verdict::RQG_VERDICT_INIT) {
+        # The RQG worker was definitely not the 'victim' of a stop_worker because
+        # that gets marked as RQG_VERDICT_STOPPED.
+        # The RQG runner
+        # - took over (->RQG_PHASE_START)
+        # - did something
+        # - disappeared before having reached a verdict
+        # Most likely
+        #   "ill" command line snip (generated by Simplifier/Combinator/...)
+        #   which was not "accepted" by RQG runner (unknown or missing parameter).
+        # Less likely
+        #   Failure in environment (Example: Missing file) wrong (Example: croak)
+        #   handled by RQG core.
+        #   Perl aborts because of heavy failure in RQG core.
+        # We might have a RQG log which maybe explains why the run failed so early.
+        # We do not have an archive of remaining data and its also quite unlikely
+        # that any remaining data would be valuable.
+        # Letting the rqg_batch process generate an archive is a too big danger
+        # (death during archiving or too long busy with just that) for control.
+        # WARNING: The "move" does not work across filesystems.
+        if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target_prefix)) {
+            emergency_exit(STATUS_ENVIRONMENT_FAILURE,
+                "ERROR: This must not happen.");
+        }
+        $verdict_init++;
+        say("WARN: The final Verdict in '$saved_log' is RQG_VERDICT_INIT.");
+        # Maybe touch ORDER_EFFORTS_INVESTED or ORDER_EFFORTS_LEFT
+    } else {
+        emergency_exit(STATUS_CRITICAL_FAILURE,
+            "INTERNAL ERROR: Final Verdict '$verdict' is not treated/unknown. " .
+            "This should not happen.");
+    }
+    $verdict_collected++;
+    unlink($target_prefix . "/" . RQG_WAL_MARKER) if not $drop_workdir;
+    foreach my $dir (Local::get_rqg_fast_dir . $rqg_appendix,
+                     Local::get_rqg_slow_dir . $rqg_appendix) {
+        drop_directory($dir);
+    }
+
+} # End sub handle_finished_worker
+
+sub result_record {
+# Return the record describing the result of the RQG run of the worker $worker_num.
+# Its the list of arguments for Combinator/Simplifier::register_result.
+    my ($worker_num) = @_;
+    my $total_runtime = $worker_array[$worker_num][WORKER_END] -
+                        $worker_array[$worker_num][WORKER_START];
+    if (-1 == $worker_array[$worker_num][WORKER_START]) {
+        # A RQG run died in Phase init -> Verdict will be init too.
+        # Real life example:
+        # I edited rqg.pl and made there a mistake in perl syntax.
+        $total_runtime = 0;
+    }
+    my $extra_info = $worker_array[$worker_num][WORKER_V_INFO];
+    if (defined $worker_array[$worker_num][WORKER_STOP_REASON]) {
+        $extra_info = $worker_array[$worker_num][WORKER_STOP_REASON];
+        say("DEBUG: order_id " . $worker_array[$worker_num][WORKER_ORDER_ID] . " Reporting " .
+            "WORKER_STOP_REASON instead of WORKER_V_INFO.") if Auxiliary::script_debug("B4");
+    }
+    return ($worker_num,
+            $worker_array[$worker_num][WORKER_ORDER_ID],
+            $worker_array[$worker_num][WORKER_VERDICT],
+            $extra_info,
+            $worker_array[$worker_num][WORKER_LOG],
+            $total_runtime,
+            $worker_array[$worker_num][WORKER_EXTRA1],
+            $worker_array[$worker_num][WORKER_EXTRA2],
+            $worker_array[$worker_num][WORKER_EXTRA3],
+            $worker_array[$worker_num][WORKER_COMMAND]);
+}
+
 
 sub check_exit_file {
     my ($exit_file) = @_;
@@ -1463,7 +1554,7 @@ sub make_infrastructure {
 # failure -- undef
 #
 
-    ($workdir) = @_;
+    ($workdir, my $resume) = @_;
     # my ($run_id, $symlink_name) = @_;
 
     my $snip_all     = "for batches of RQG runs";
@@ -1472,6 +1563,17 @@ sub make_infrastructure {
     # Files for bookkeeping of all the RQG runs somehow finished
     # ---------------------------------------------------------
     $result_file = $workdir . "/result.txt";
+    $setup_file  = $workdir . "/setup.txt";
+    if ($resume) {
+        # Go on with appending to the files of the campaign to be resumed.
+        foreach my $file ($result_file, $setup_file) {
+            if (not -f $file) {
+                say("ERROR: The file '$file' of the campaign to be resumed does not exist.");
+                safe_exit(STATUS_ENVIRONMENT_FAILURE);
+            }
+        }
+        return STATUS_OK;
+    }
     if (STATUS_OK != Basics::make_file($result_file, undef)) {
         safe_exit(STATUS_ENVIRONMENT_FAILURE);
     } else {
@@ -2103,8 +2205,13 @@ sub append_string_to_file {
     }
 }
 
+# During the replay of the write ahead log on resume the lines for result.txt and setup.txt
+# were already written by the previous rqg_batch.pl process.
+our $resume_replay = 0;
+
 sub write_result {
     my ($line) = @_;
+    return if $resume_replay;
     if (not defined $line) {
         Carp::cluck("INTERNAL ERROR: line is undef.");
         my $status = STATUS_INTERNAL_ERROR;
@@ -2120,6 +2227,7 @@ sub write_result {
 
 sub write_setup {
     my ($line) = @_;
+    return if $resume_replay;
     if (not defined $line) {
         Carp::cluck("INTERNAL ERROR: line is undef.");
         my $status = STATUS_INTERNAL_ERROR;
@@ -2182,44 +2290,8 @@ sub process_finished_runs {
             # not defined   | RQG Worker is active or inactive
             #               | Nothing to do
             my ($status,$action);
-            my $total_runtime = $worker_array[$worker_num][WORKER_END] -
-                                $worker_array[$worker_num][WORKER_START];
-            if (-1 == $worker_array[$worker_num][WORKER_START]) {
-                # A RQG run died in Phase init -> Verdict will be init too.
-                # Real life example:
-                # I edited rqg.pl and made there a mistake in perl syntax.
-                $total_runtime = 0;
-            }
-            my $extra_info = $worker_array[$worker_num][WORKER_V_INFO];
-            if (defined $worker_array[$worker_num][WORKER_STOP_REASON]) {
-                $extra_info = $worker_array[$worker_num][WORKER_STOP_REASON];
-                say("DEBUG: order_id $order_id Reporting WORKER_STOP_REASON instead of " .
-                    "WORKER_V_INFO.") if Auxiliary::script_debug("B4");
-            }
-            my @result_record = (
-                    $worker_num,
-                    $worker_array[$worker_num][WORKER_ORDER_ID],
-                    $worker_array[$worker_num][WORKER_VERDICT],
-                    $extra_info,
-                    $worker_array[$worker_num][WORKER_LOG],
-                    $total_runtime,
-                    $worker_array[$worker_num][WORKER_EXTRA1],
-                    $worker_array[$worker_num][WORKER_EXTRA2],
-                    $worker_array[$worker_num][WORKER_EXTRA3],
-                    $worker_array[$worker_num][WORKER_COMMAND],
-            );
-            if      ($batch_type eq BATCH_TYPE_COMBINATOR) {
-                $action = Combinator::register_result(@result_record);
-                # Maintaining the setup file is done im Combinator::register_result.
-            } elsif ($batch_type eq BATCH_TYPE_RQG_SIMPLIFIER) {
-                $action = Simplifier::register_result(@result_record);
-            } else {
-                emergency_exit(STATUS_CRITICAL_FAILURE,
-                    "INTERNAL ERROR: The batch type '$batch_type' is unknown. ");
-            }
-            # For debugging
-            # dump_try_hashes();
-            update_extra_info_hash($verdict . ' -- ' . $extra_info);
+            # handle_finished_worker has written the result already into the write ahead log.
+            $action = register_result_record(result_record($worker_num));
             # FIXME maybe:
             # If Simplifier and we go with archiving and we have already an archive from some
             # previous run which hit the problem than delete that archive (but not its log).
@@ -2267,13 +2339,35 @@ sub process_finished_runs {
     }
 } # End of sub process_finished_runs
 
+sub register_result_record {
+    my (@result_record) = @_;
+    my $action;
+    if      ($batch_type eq BATCH_TYPE_COMBINATOR) {
+        $action = Combinator::register_result(@result_record);
+        # Maintaining the setup file is done im Combinator::register_result.
+    } elsif ($batch_type eq BATCH_TYPE_RQG_SIMPLIFIER) {
+        $action = Simplifier::register_result(@result_record);
+    } else {
+        emergency_exit(STATUS_CRITICAL_FAILURE,
+            "INTERNAL ERROR: The batch type '$batch_type' is unknown. ");
+    }
+    # For debugging
+    # dump_try_hashes();
+    update_extra_info_hash($result_record[2] . ' -- ' . $result_record[3]);
+    return $action;
+}
+
 sub help_archiving {
     print(
     "\nSorry, under construction and partially different or not yet implemented.\n\n"              .
     "Default\n"                                                                                    .
     "      What you get in case you do not assign some corresponding --<parameter>=<value>.\n"     .
-    "  will be taken according to their setting with absolute path or relative to the current "    .
-    "Description currently missing. Sorry.\n");
+    "      The remainings of RQG runs with the verdict '" . Verdict::RQG_VERDICT_REPLAY . "' or '"    .
+    Verdict::RQG_VERDICT_INTEREST . "' get archived\n"                                           .
+    "      by the RQG worker with xz.\n"                                                          .
+    "--noarchiving\n"                                                                              .
+    "      No archiving at all.\n");
+    Archiver::help();
 }
 
 sub free_memory {
@@ -2290,6 +2384,297 @@ sub free_memory {
     %try_exhausted_hash = ();
 }
 
+#---------------------------------------------------------------------------------------------------
+# Checkpoint and resume
+# ---------------------
+# The state of the order management gets written periodic into some checkpoint
+# (see lib/Checkpoint.pm). The results registered after the last checkpoint are in the write
+# ahead log. In case the rqg_batch.pl process dies than a new rqg_batch.pl process started with
+# --resume=<runid> rebuilds the state from the checkpoint + write ahead log + the remainings of
+# RQG runs in the workdir and goes on.
+
+sub checkpoint_state {
+    return {
+        order_array        => \@order_array,
+        try_queue          => \@try_queue,
+        try_all_hash       => \%try_all_hash,
+        try_first_hash     => \%try_first_hash,
+        try_replayer_hash  => \%try_replayer_hash,
+        try_over_bl_hash   => \%try_over_bl_hash,
+        try_over_hash      => \%try_over_hash,
+        try_never_hash     => \%try_never_hash,
+        try_exhausted_hash => \%try_exhausted_hash,
+        out_of_ideas       => \$out_of_ideas,
+        extra_info_hash    => \%extra_info_hash,
+        verdict_init       => \$verdict_init,
+        verdict_replay     => \$verdict_replay,
+        verdict_interest   => \$verdict_interest,
+        verdict_ignore     => \$verdict_ignore,
+        stopped            => \$stopped,
+        verdict_collected  => \$verdict_collected,
+    };
+}
+
+sub write_checkpoint {
+# Write a checkpoint if forced or the checkpoint interval has elapsed.
+# Has to be called only after process_finished_runs because a reaped RQG worker whose result
+# is not yet registered would get lost.
+    my ($force, $complete) = @_;
+
+    return if not $force and not Checkpoint::checkpoint_due();
+    my @in_flight;
+    for my $worker_num (1..$workers_max) {
+        next if -1 == $worker_array[$worker_num][WORKER_PID];
+        push @in_flight, [ $worker_num, [ @{$worker_array[$worker_num]} ] ];
+    }
+    if (STATUS_OK != Checkpoint::write_checkpoint(\@in_flight, $complete)) {
+        say("WARN: Writing the checkpoint failed. The previous checkpoint stays valid.");
+    }
+}
+
+sub read_cmdline {
+# Return the command line of the process $pid with the arguments separated by ' '
+# or undef if the process is already gone.
+    my ($pid) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $cmdline_fh;
+    if (not open($cmdline_fh, '<', "/proc/$pid/cmdline")) {
+        say("WARN: $who_am_i Open file '/proc/$pid/cmdline' failed : $!") if not $!{ENOENT};
+        return undef;
+    }
+    local $/;
+    my $cmdline = <$cmdline_fh>;
+    close($cmdline_fh);
+    return undef if not defined $cmdline;
+    $cmdline =~ s{\0}{ }g;
+    return $cmdline;
+}
+
+sub unqueue_order {
+# Remove $order_id from where get_order would have picked it.
+    my ($order_id) = @_;
+    if (exists $try_first_hash{$order_id}) {
+        delete $try_first_hash{$order_id};
+        return;
+    }
+    foreach my $index (0..$#try_queue) {
+        if (defined $try_queue[$index] and $try_queue[$index] == $order_id) {
+            splice(@try_queue, $index, 1);
+            return;
+        }
+    }
+}
+
+sub read_rqg_job {
+# Get (order_id, memo1, memo2, memo3, cl_snip) from the rqg.job file of some RQG run.
+    my ($rqg_job) = @_;
+    my $content = Auxiliary::getFileSlice($rqg_job, 10000000);
+    return undef if not defined $content;
+    my @values;
+    foreach my $pattern ('OrderID: ', 'Memo1:   ', 'Memo2:   ', 'Memo3:   ', 'Cl_Snip: ') {
+        my $value;
+        $value = $1 if $content =~ m{^$pattern(.*)$}m;
+        $value = undef if defined $value and $value eq '<undef>';
+        push @values, $value;
+    }
+    return @values;
+}
+
+sub resume_campaign {
+# Rebuild the state of the campaign from the checkpoint + write ahead log of the previous
+# rqg_batch.pl process which used the same workdir.
+# Has to be called after Combinator::init or Simplifier::init and set_workers_range.
+# Aborts via safe_exit if the campaign cannot be resumed.
+
+    my $who_am_i = Basics::who_am_i;
+
+    my $checkpoint = Checkpoint::read_checkpoint();
+    if (not defined $checkpoint) {
+        say("ERROR: $who_am_i Resuming the campaign is impossible.");
+        safe_exit(STATUS_ENVIRONMENT_FAILURE);
+    }
+    if ($checkpoint->{complete}) {
+        say("ERROR: $who_am_i The campaign was already completed. Nothing to resume.");
+        safe_exit(STATUS_ENVIRONMENT_FAILURE);
+    }
+    my $old_pid = $checkpoint->{pid};
+    if (defined $old_pid and kill(0, $old_pid)) {
+        my $cmdline = read_cmdline($old_pid);
+        if (defined $cmdline and $cmdline =~ m{rqg_batch}) {
+            say("ERROR: $who_am_i The previous rqg_batch.pl process (pid $old_pid) is still " .
+                "alive.");
+            safe_exit(STATUS_ENVIRONMENT_FAILURE);
+        }
+    }
+    if (STATUS_OK != Checkpoint::restore_state($checkpoint)) {
+        say("ERROR: $who_am_i Restoring the state from the checkpoint failed.");
+        safe_exit(STATUS_ENVIRONMENT_FAILURE);
+    }
+    say("INFO: $who_am_i State of the campaign from " . isoTimestamp($checkpoint->{time}) .
+        " restored.");
+
+    # 1. Results registered after the checkpoint was written.
+    #    The counters get maintained like in handle_finished_worker.
+    my @records = Checkpoint::read_wal($checkpoint->{wal_sequence});
+    $resume_replay = 1;
+    foreach my $record (@records) {
+        my $verdict = $record->[2];
+        if      ($verdict eq Verdict::RQG_VERDICT_REPLAY)   {
+            $verdict_replay++;
+        } elsif ($verdict eq Verdict::RQG_VERDICT_INTEREST) {
+            $verdict_interest++;
+        } elsif ($verdict eq Verdict::RQG_VERDICT_INIT)     {
+            $verdict_init++;
+        } else {
+            $verdict_ignore++;
+            $stopped++ if $verdict eq Verdict::RQG_VERDICT_IGNORE_STOPPED;
+        }
+        $verdict_collected++;
+        my $action = register_result_record(@$record);
+        if (defined $action and $action eq REGISTER_END and 2 > $give_up) {
+            $give_up = 2;
+        }
+    }
+    $resume_replay = 0;
+    say("INFO: $who_am_i " . scalar(@records) . " result(s) from the write ahead log " .
+        "registered.");
+
+    # Never reuse the name of some already existing directory of a finished RQG run.
+    if (not opendir(WORKDIR, $workdir)) {
+        say("ERROR: $who_am_i Opening the directory '$workdir' failed : $!");
+        safe_exit(STATUS_ENVIRONMENT_FAILURE);
+    }
+    my @entries = readdir(WORKDIR);
+    closedir(WORKDIR);
+    foreach my $entry (@entries) {
+        next if $entry !~ m{^[0-9]{6}$} or not -d $workdir . "/" . $entry;
+        $verdict_collected = $entry + 1 if $entry >= $verdict_collected;
+    }
+
+    # 2. RQG runs which were in work when the previous rqg_batch.pl died.
+    #    The RQG workers could have survived. Stop them because they use the same resources
+    #    (ports, vardirs) like the RQG workers to be started.
+    my (undef, $major_runid) = Local::get_runid();
+    if (opendir(PROC_DIR, "/proc")) {
+        foreach my $pid (grep { m{^[0-9]+$} } readdir(PROC_DIR)) {
+            my $cmdline = read_cmdline($pid);
+            next if not defined $cmdline;
+            if ($cmdline =~ m{--major_runid=$major_runid\s+--minor_runid=[0-9]+}) {
+                my $process_group = getpgrp($pid);
+                say("INFO: $who_am_i Stopping the surviving RQG worker process group " .
+                    "$process_group.");
+                kill '-9', $process_group;
+            }
+        }
+        closedir(PROC_DIR);
+    }
+    my %in_flight;
+    foreach my $entry (@{$checkpoint->{in_flight}}) {
+        $in_flight{$entry->[0]} = $entry->[1];
+    }
+    # worker_num -> order_id of the RQG runs which are in the WAL or got adopted
+    my %accounted;
+    map { $accounted{$_->[0]}{$_->[1]} = 1 } @records;
+    my $adopted = 0;
+    foreach my $worker_num (sort { $a <=> $b } grep { m{^[1-9][0-9]*$} } @entries) {
+        my $rqg_workdir = $workdir . "/" . $worker_num;
+        next if not -d $rqg_workdir;
+        my $marker = $rqg_workdir . "/" . RQG_WAL_MARKER;
+        if (-f $marker) {
+            my ($sequence, $target) = split(/\t/, Auxiliary::getFileSlice($marker, 10000), -1);
+            if (defined $sequence and $sequence =~ m{^[0-9]+$} and
+                $sequence <= Checkpoint::get_wal_sequence()) {
+                # The result is in the WAL but the RQG workdir was neither moved nor dropped.
+                if (defined $target and $target ne '' and not -e $target) {
+                    if (STATUS_OK != Basics::rename_dir($rqg_workdir, $target)) {
+                        safe_exit(STATUS_ENVIRONMENT_FAILURE);
+                    }
+                    unlink($target . "/" . RQG_WAL_MARKER);
+                    say("INFO: $who_am_i '$rqg_workdir' of some registered RQG run moved to " .
+                        "'$target'.");
+                } else {
+                    drop_directory($rqg_workdir);
+                    say("INFO: $who_am_i '$rqg_workdir' of some registered RQG run dropped.");
+                }
+                foreach my $dir (Local::get_rqg_fast_dir . "/" . $worker_num,
+                                 Local::get_rqg_slow_dir . "/" . $worker_num) {
+                    drop_directory($dir);
+                }
+                next;
+            }
+            # The previous rqg_batch.pl died before the WAL record was written.
+            unlink($marker);
+        }
+        my ($order_id, $memo1, $memo2, $memo3, $cl_snip) = read_rqg_job($rqg_workdir . "/rqg.job");
+        if (not defined $order_id or $worker_num > $workers_max) {
+            say("WARN: $who_am_i The remainings of some RQG run in '$rqg_workdir' cannot be " .
+                "assigned to some order. Removing them.");
+            drop_directory($rqg_workdir);
+            next;
+        }
+        my $phase = Auxiliary::get_rqg_phase($rqg_workdir);
+        $phase = '<undef>' if not defined $phase;
+        if ($phase eq Auxiliary::RQG_PHASE_FINISHED) {
+            # The RQG runner has finished but the verdict was not computed.
+            my $command = "perl " . $Local::rqg_home . "/verdict.pl --workdir=$rqg_workdir > " .
+                          "$rqg_workdir/rqg_matching.log 2>&1";
+            $command = Auxiliary::prepare_command_for_system($command);
+            system($command);
+            if (0 != $?) {
+                say("WARN: $who_am_i ->" . $command . "<- failed. The RQG run will be repeated.");
+                $phase = '<verdict failed>';
+            } else {
+                unlink("$rqg_workdir/rqg_matching.log");
+            }
+        }
+
+        my $old_entry = $in_flight{$worker_num};
+        @free_worker_queue = grep { $_ != $worker_num } @free_worker_queue;
+        $worker_array[$worker_num][WORKER_PID]      = -1;
+        $worker_array[$worker_num][WORKER_ORDER_ID] = $order_id;
+        $worker_array[$worker_num][WORKER_EXTRA1]   = $memo1;
+        $worker_array[$worker_num][WORKER_EXTRA2]   = $memo2;
+        $worker_array[$worker_num][WORKER_EXTRA3]   = $memo3;
+        if (defined $old_entry and $old_entry->[WORKER_ORDER_ID] == $order_id) {
+            $worker_array[$worker_num][WORKER_START]   = $old_entry->[WORKER_START];
+            $worker_array[$worker_num][WORKER_COMMAND] = $old_entry->[WORKER_COMMAND];
+        } else {
+            # The RQG run was started after the checkpoint was written.
+            $worker_array[$worker_num][WORKER_START]   = (stat($rqg_workdir . "/rqg.job"))[9];
+            $worker_array[$worker_num][WORKER_COMMAND] = $cl_snip;
+            # The restored state has the order still queued. Otherwise it would be run again.
+            unqueue_order($order_id);
+        }
+        if ($phase ne Auxiliary::RQG_PHASE_FINISHED  and
+            $phase ne Auxiliary::RQG_PHASE_ARCHIVING and
+            $phase ne Auxiliary::RQG_PHASE_COMPLETE      ) {
+            $worker_array[$worker_num][WORKER_STOP_REASON] = STOP_REASON_RESUME;
+        }
+        say("INFO: $who_am_i RQG run with OrderID $order_id in '$rqg_workdir' and phase " .
+            "'$phase' adopted.");
+        # Writes the corresponding entry in the WAL.
+        handle_finished_worker($worker_num, 0);
+        $accounted{$worker_num}{$order_id} = 1;
+        $adopted++;
+    }
+    # Registers the adopted RQG runs.
+    process_finished_runs();
+    say("INFO: $who_am_i $adopted RQG run(s) which were in work adopted.");
+
+    # 3. RQG runs which were in work when the checkpoint was written but left neither a
+    #    RQG workdir nor a result. They have to be repeated.
+    foreach my $worker_num (sort { $a <=> $b } keys %in_flight) {
+        my $order_id = $in_flight{$worker_num}->[WORKER_ORDER_ID];
+        next if not defined $order_id or exists $accounted{$worker_num}{$order_id};
+        add_to_try_first($order_id);
+        say("INFO: $who_am_i The RQG run with OrderID $order_id of worker $worker_num left no " .
+            "traces. The order gets queued again.");
+    }
+
+    write_checkpoint(1, 0);
+} # End sub resume_campaign
+
 my $rqg_log_length;
 sub get_rqg_log_length {
     my ($workdir) = @_;
@@ -0,0 +1,305 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+
+package BatchAgent;
+
+# Purpose
+# -------
+# Let rqg_batch.pl (the coordinator, order management in Batch.pm) run RQG runs on other hosts.
+# On every host used an agent (rqg_batch_agent.pl) performs the RQG run and streams the
+# changes of the work phase, the exit status and the files of the RQG run back.
+# Verdict computation and bookkeeping stay with rqg_batch.pl.
+#
+# Transport
+# ---------
+# The RQG worker (child process of rqg_batch.pl) starts per RQG run one agent
+#    ssh -o BatchMode=yes <host> perl <RQG_HOME>/rqg_batch_agent.pl
+# or for the host 'local' (testing, no ssh)
+#    perl <RQG_HOME>/rqg_batch_agent.pl
+# and talks with it via the stdin/stdout of the agent.
+# Stopping the RQG worker (SIGKILL of its process group) kills the ssh client. The agent detects
+# the EOF on stdin and kills the RQG run.
+#
+# Protocol (one message per line, files are sent raw after their announcement)
+# --------
+# Agent                               | Coordinator
+# ------------------------------------+--------------------------------------------------------
+# HELLO <version>                     |
+#                                     | RUN <major_runid> <minor_runid> <runner> <options>
+# PHASE <phase>                       |
+# ...                                 |
+# EXIT <exit status of the runner>    |
+# FILE <name> <size> + <size> bytes   |
+# ...                                 |
+# FILES_DONE                          |
+#                                     | ARCHIVE
+# FILE <name> <size> + <size> bytes   |
+# ARCHIVE_DONE <status>               |
+#                                     | END
+# BYE                                 |
+# ARCHIVE is optional.
+#
+# Requirements
+# ------------
+# RQG_HOME, the basedirs and all files (grammars, ...) used must have the same path on all hosts.
+# Every host needs its own local.cfg.
+# The agent uses agent_<worker number> instead of <worker number> for the names of its RQG
+# workdir and vardirs. So an agent on the host of rqg_batch.pl does not clash with the RQG worker.
+#
+
+use strict;
+use IPC::Open2;
+use File::Basename;
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+use Local;
+
+use constant AGENT_PROTOCOL_VERSION => 1;
+use constant AGENT_SCRIPT           => 'rqg_batch_agent.pl';
+use constant AGENT_HOST_LOCAL       => 'local';
+use constant AGENT_LOG              => 'rqg_agent.log';
+
+# worker number -> host name
+my @worker_host;
+# Number of RQG workers running on the box of rqg_batch.pl
+my $workers_local;
+
+sub check_and_set_agents {
+# Assign the RQG workers with the numbers <workers_local> + 1 and higher to the hosts.
+#
+# Return values
+# - success  number of RQG workers on other hosts
+# - failure  undef
+    my ($agent_list, $workers) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    $workers_local = $workers;
+    my $worker_num = $workers_local;
+    foreach my $agent (@$agent_list) {
+        if ($agent !~ m{^([^:\s]+):([1-9][0-9]*)$}) {
+            say("ERROR: $who_am_i The value '$agent' assigned to agent is not of the form " .
+                "<host>:<number of RQG workers>.");
+            help();
+            return undef;
+        }
+        my ($host, $slots) = ($1, $2);
+        foreach (1..$slots) {
+            $worker_num++;
+            $worker_host[$worker_num] = $host;
+        }
+        say("INFO: $who_am_i $slots RQG workers run on the host '$host'.");
+    }
+    return $worker_num - $workers_local;
+}
+
+sub is_remote {
+    my ($worker_num) = @_;
+    return defined $worker_host[$worker_num] ? 1 : 0;
+}
+
+sub get_host {
+    my ($worker_num) = @_;
+    return $worker_host[$worker_num];
+}
+
+#---------------------------------------------------------------------------------------------------
+# Message and file transfer. Used by the coordinator and the agent.
+
+sub send_message {
+    my ($fh, $message) = @_;
+    return (print $fh $message . "\n") ? STATUS_OK : STATUS_FAILURE;
+}
+
+sub read_message {
+# Return the message or undef if the other side is gone.
+    my ($fh) = @_;
+    my $line = <$fh>;
+    return undef if not defined $line;
+    chomp $line;
+    return $line;
+}
+
+sub send_file {
+    my ($fh, $file) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (not open(SEND_FILE, '<', $file)) {
+        say("ERROR: $who_am_i Open file '$file' failed : $!");
+        return STATUS_FAILURE;
+    }
+    binmode SEND_FILE;
+    my $size = -s $file;
+    send_message($fh, "FILE " . File::Basename::basename($file) . " " . $size);
+    my $buffer;
+    my $left = $size;
+    while ($left > 0) {
+        my $got = read(SEND_FILE, $buffer, ($left > 1048576 ? 1048576 : $left));
+        if (not $got) {
+            # The file was truncated in between. Pad so that the other side stays in sync.
+            $buffer = "\0" x $left;
+            $got    = $left;
+        }
+        print $fh $buffer;
+        $left -= $got;
+    }
+    close(SEND_FILE);
+    return STATUS_OK;
+}
+
+sub receive_file {
+# Read <size> bytes from $fh into $target_dir/<name>.
+    my ($fh, $target_dir, $name, $size) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $target = $target_dir . "/" . $name;
+    if (not open(RECEIVE_FILE, '>', $target)) {
+        say("ERROR: $who_am_i Open file '$target' failed : $!");
+        return STATUS_FAILURE;
+    }
+    binmode RECEIVE_FILE;
+    my $buffer;
+    my $left = $size;
+    while ($left > 0) {
+        my $got = read($fh, $buffer, ($left > 1048576 ? 1048576 : $left));
+        if (not $got) {
+            say("ERROR: $who_am_i The agent disappeared during the transfer of '$name'.");
+            close(RECEIVE_FILE);
+            return STATUS_FAILURE;
+        }
+        print RECEIVE_FILE $buffer;
+        $left -= $got;
+    }
+    close(RECEIVE_FILE);
+    return STATUS_OK;
+}
+
+#---------------------------------------------------------------------------------------------------
+# Coordinator side. Gets called within the RQG worker (child process of rqg_batch.pl).
+# One RQG worker process handles exact one RQG run == one agent.
+
+my $agent_pid;
+
+sub run_job {
+# Start the agent, let it perform the RQG run and mirror phases and files into $rqg_workdir.
+#
+# Return values
+# STATUS_OK                  -- The RQG run finished and its files are in $rqg_workdir
+# STATUS_ENVIRONMENT_FAILURE -- Trouble with the agent
+    my ($worker_num, $rqg_workdir, $major_runid, $runner, $options) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $host = $worker_host[$worker_num];
+    my $agent_command = "perl " . Local::get_rqg_home() . "/" . AGENT_SCRIPT;
+    if ($host ne AGENT_HOST_LOCAL) {
+        $agent_command = "ssh -o BatchMode=yes $host " . $agent_command;
+    }
+    # The agent and ssh write their messages to stderr.
+    $agent_command .= " 2>>" . $rqg_workdir . "/" . AGENT_LOG;
+    $agent_pid = open2(\*AGENT_OUT, \*AGENT_IN, $agent_command);
+    binmode AGENT_OUT;
+    binmode AGENT_IN;
+    AGENT_IN->autoflush(1);
+
+    my $hello = read_message(\*AGENT_OUT);
+    if (not defined $hello or $hello ne "HELLO " . AGENT_PROTOCOL_VERSION) {
+        say("ERROR: $who_am_i The agent on '$host' did not answer with the expected greeting.");
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    # The agent has taken over. This is what rqg_batch.pl waits for.
+    Auxiliary::set_rqg_phase($rqg_workdir, Auxiliary::RQG_PHASE_START);
+    send_message(\*AGENT_IN, "RUN $major_runid $worker_num $runner $options");
+
+    my $exit_status;
+    while (1) {
+        my $message = read_message(\*AGENT_OUT);
+        if (not defined $message) {
+            say("ERROR: $who_am_i The agent on '$host' disappeared.");
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+        if      ($message =~ m{^PHASE (\S+)$}) {
+            Auxiliary::set_rqg_phase($rqg_workdir, $1);
+        } elsif ($message =~ m{^EXIT (\S+)$}) {
+            $exit_status = $1;
+        } elsif ($message =~ m{^FILE (\S+) ([0-9]+)$}) {
+            return STATUS_ENVIRONMENT_FAILURE
+                if STATUS_OK != receive_file(\*AGENT_OUT, $rqg_workdir, $1, $2);
+        } elsif ($message eq 'FILES_DONE') {
+            last;
+        } else {
+            say("ERROR: $who_am_i Unexpected message '$message' from the agent on '$host'.");
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+    }
+    say("DEBUG: $who_am_i RQG run on '$host' exited with $exit_status.")
+        if Auxiliary::script_debug("W2");
+    return STATUS_OK;
+}
+
+sub fetch_archive {
+# Let the agent archive the remainings of the RQG run and fetch the archive.
+#
+# Return values
+# STATUS_OK      -- Success
+# STATUS_FAILURE -- No success
+    my ($rqg_workdir) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    send_message(\*AGENT_IN, "ARCHIVE");
+    while (1) {
+        my $message = read_message(\*AGENT_OUT);
+        if (not defined $message) {
+            say("ERROR: $who_am_i The agent disappeared during archiving.");
+            return STATUS_FAILURE;
+        }
+        if      ($message =~ m{^FILE (\S+) ([0-9]+)$}) {
+            return STATUS_FAILURE
+                if STATUS_OK != receive_file(\*AGENT_OUT, $rqg_workdir, $1, $2);
+        } elsif ($message =~ m{^ARCHIVE_DONE (\S+)$}) {
+            return ($1 == STATUS_OK) ? STATUS_OK : STATUS_FAILURE;
+        } else {
+            say("ERROR: $who_am_i Unexpected message '$message' from the agent.");
+            return STATUS_FAILURE;
+        }
+    }
+}
+
+sub end_job {
+# Let the agent cleanup and wait till it is gone.
+    send_message(\*AGENT_IN, "END");
+    my $message = read_message(\*AGENT_OUT);
+    close(AGENT_IN);
+    close(AGENT_OUT);
+    waitpid($agent_pid, 0);
+    return (defined $message and $message eq 'BYE') ? STATUS_OK : STATUS_FAILURE;
+}
+
+sub help {
+    print("\nHELP about the rqg_batch.pl option 'agent'.\n"                                       .
+          "--agent=<host>:<n>\n"                                                                 .
+          "    Run in addition <n> RQG workers on the host <host>. Can be assigned several times.\n" .
+          "    The RQG runs get performed by " . AGENT_SCRIPT . " started via\n"                   .
+          "        ssh -o BatchMode=yes <host> perl <RQG_HOME>/" . AGENT_SCRIPT . "\n"                .
+          "    The host '" . AGENT_HOST_LOCAL . "' means: Start the agent without ssh on the "       .
+          "current box.\n"                                                                      .
+          "    RQG_HOME, the basedirs and all files used must have the same path on all hosts.\n"  .
+          "    Every host needs its own local.cfg.\n"                                             .
+          "    The verdict gets computed by rqg_batch.pl. Archives get fetched from the host.\n"   .
+          "    The resource control of rqg_batch.pl checks only the current box.\n");
+}
+
+1;
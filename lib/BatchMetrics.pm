@@ -0,0 +1,280 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+
+package BatchMetrics;
+
+# Purpose
+# -------
+# Live metrics of some rqg_batch.pl run in the Prometheus text exposition format.
+# - <workdir>/metrics.prom gets rewritten every metrics_interval seconds. Can be picked up by the
+#   textfile collector of the node_exporter or simply read by humans.
+# - If metrics_port is assigned than the metrics are also served via HTTP on
+#   127.0.0.1:<metrics_port>/metrics . The requests are served within the main loop of
+#   rqg_batch.pl. So the answer might be delayed by up to a few seconds.
+#
+
+use strict;
+use IO::Socket::INET;
+use IO::Select;
+use Time::HiRes;
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+use ResourceControl;
+
+use constant METRICS_FILE              => 'metrics.prom';
+use constant METRICS_INTERVAL_DEFAULT  => 15;
+
+my $metrics_file;
+my $metrics_interval;
+my $metrics_server;
+my $last_write = 0;
+my $start_time;
+# runs_per_hour counts only the RQG runs finished by the current rqg_batch.pl process.
+my $rate_start_time;
+my $rate_start_collected = 0;
+
+# Counters about finished RQG runs. Kept in the checkpoint.
+# verdict -> number of RQG runs
+my %runs_hash;
+# verdict -> sum of runtimes of the RQG runs in s
+my %runtime_hash;
+# stop reason -> number of RQG runs stopped
+my %stop_hash;
+# Time between the RQG runner reaching the phase 'finished' and the verdict being registered
+my $verdict_latency_sum   = 0;
+my $verdict_latency_count = 0;
+
+sub check_and_set_metrics {
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- wrong value assigned or the port is not usable
+    my ($workdir, $interval, $port) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (3 != scalar @_ or not defined $workdir) {
+        my $status = STATUS_INTERNAL_ERROR;
+        Carp::cluck("INTERNAL ERROR: $who_am_i Exact three parameters(workdir, interval, port) " .
+                    "need to get assigned and workdir must be defined. " .
+                    Basics::exit_status_text($status));
+        safe_exit($status);
+    }
+    $start_time      = time();
+    $rate_start_time = $start_time;
+    $interval        = METRICS_INTERVAL_DEFAULT if not defined $interval;
+    if ($interval !~ m{^[0-9]+$}) {
+        say("ERROR: $who_am_i The value '$interval' assigned to metrics_interval is not a non " .
+            "negative integer.");
+        help();
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $metrics_interval = $interval;
+    $metrics_file     = $workdir . "/" . METRICS_FILE;
+    if (0 == $metrics_interval) {
+        say("INFO: $who_am_i metrics_interval is 0. No metrics file will be written.");
+    } else {
+        say("INFO: $who_am_i Metrics get written every $metrics_interval" . "s to " .
+            "'$metrics_file'.");
+    }
+    if (defined $port) {
+        if ($port !~ m{^[1-9][0-9]*$} or $port > 65535) {
+            say("ERROR: $who_am_i The value '$port' assigned to metrics_port is not a valid port.");
+            help();
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+        $metrics_server = IO::Socket::INET->new(LocalAddr => '127.0.0.1',
+                                                LocalPort => $port,
+                                                Proto     => 'tcp',
+                                                Listen    => 5,
+                                                ReuseAddr => 1,
+                                                Blocking  => 0);
+        if (not defined $metrics_server) {
+            say("ERROR: $who_am_i Listening on 127.0.0.1:$port failed : $@");
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+        say("INFO: $who_am_i Metrics get served on http://127.0.0.1:$port/metrics .");
+    }
+    return STATUS_OK;
+}
+
+sub checkpoint_state {
+    return {
+        runs_hash             => \%runs_hash,
+        runtime_hash          => \%runtime_hash,
+        stop_hash             => \%stop_hash,
+        verdict_latency_sum   => \$verdict_latency_sum,
+        verdict_latency_count => \$verdict_latency_count,
+    };
+}
+
+sub resumed {
+# To be called after the state of the campaign to be resumed was restored.
+# The RQG runs finished before the resume must not count for runs_per_hour.
+    $rate_start_time      = time();
+    $rate_start_collected = $Batch::verdict_collected;
+}
+
+sub register_run {
+# To be called for every reaped RQG worker.
+# $latency is undef if the RQG runner never reached the phase 'finished'.
+    my ($verdict, $runtime, $stop_reason, $latency) = @_;
+
+    $runs_hash{$verdict}++;
+    $runtime_hash{$verdict} += $runtime;
+    $stop_hash{$stop_reason}++ if defined $stop_reason;
+    if (defined $latency and $latency >= 0) {
+        $verdict_latency_sum += $latency;
+        $verdict_latency_count++;
+    }
+}
+
+sub render {
+# Return the metrics as text.
+    my $text = '';
+    my $metric = sub {
+        my ($name, $type, $help_text, @samples) = @_;
+        $text .= "# HELP rqg_batch_$name $help_text\n# TYPE rqg_batch_$name $type\n";
+        while (@samples) {
+            my ($labels, $value) = (shift @samples, shift @samples);
+            next if not defined $value;
+            $text .= "rqg_batch_$name" . ($labels eq '' ? '' : "{$labels}") . " $value\n";
+        }
+    };
+
+    my $active = Batch::count_active_workers();
+    $metric->('workers_active', 'gauge', 'RQG workers with a running RQG run.', '', $active);
+    $metric->('workers_free',   'gauge', 'RQG workers without RQG run.',
+              '', $Batch::workers_max - $active);
+    $metric->('workers_limit',  'gauge', 'Load range of RQG workers.',
+              'bound="max"', $Batch::workers_max, 'bound="mid"', $Batch::workers_mid,
+              'bound="min"', $Batch::workers_min);
+
+    my $readings = ResourceControl::get_readings();
+    my @status_samples;
+    foreach my $status (ResourceControl::LOAD_INCREASE(), ResourceControl::LOAD_KEEP(),
+                        ResourceControl::LOAD_DECREASE(), ResourceControl::LOAD_GIVE_UP()) {
+        push @status_samples, "status=\"$status\"",
+             ((defined $readings->{load_status} and $readings->{load_status} eq $status) ? 1 : 0);
+    }
+    $metric->('load_status', 'gauge', 'Last load status reported by ResourceControl.',
+              @status_samples);
+    $metric->('load_decisions_total', 'counter', 'Load decisions made by ResourceControl.',
+              'decision="increase"', $readings->{load_increase_count},
+              'decision="keep"',     $readings->{load_keep_count},
+              'decision="decrease"', $readings->{load_decrease_count});
+    $metric->('memory_mb', 'gauge', 'RAM and swap in MB.',
+              'kind="total"',          $readings->{mem_total},
+              'kind="estimated_free"', $readings->{mem_est_free},
+              'kind="swap_total"',     $readings->{swap_total},
+              'kind="swap_used"',      $readings->{swap_used});
+    $metric->('dir_free_mb', 'gauge', 'Free space in MB.',
+              'dir="vardir"',  $readings->{vardir_free},
+              'dir="slowdir"', $readings->{slowdir_free},
+              'dir="workdir"', $readings->{workdir_free});
+    $metric->('dir_used_percent', 'gauge', 'Used space of the filesystem in %.',
+              'dir="vardir"',  $readings->{vardir_percent},
+              'dir="slowdir"', $readings->{slowdir_percent});
+    $metric->('cpu_percent', 'gauge', 'CPU usage of the box in %.',
+              'mode="idle"',   $readings->{cpu_idle},
+              'mode="iowait"', $readings->{cpu_iowait},
+              'mode="system"', $readings->{cpu_system},
+              'mode="user"',   $readings->{cpu_user});
+
+    $metric->('verdicts_total', 'counter', 'RQG runs per final verdict (rqg_batch.pl counting).',
+              'verdict="replay"',   $Batch::verdict_replay,
+              'verdict="interest"', $Batch::verdict_interest,
+              'verdict="ignore"',   $Batch::verdict_ignore,
+              'verdict="init"',     $Batch::verdict_init,
+              'verdict="stopped"',  $Batch::stopped);
+    my $elapsed      = time() - $start_time;
+    my $rate_elapsed = time() - $rate_start_time;
+    $metric->('runs_per_hour', 'gauge', 'Finished RQG runs per hour since start or resume.',
+              '', sprintf("%.2f", $rate_elapsed ?
+                  ($Batch::verdict_collected - $rate_start_collected) * 3600 / $rate_elapsed : 0));
+    $metric->('run_seconds_sum', 'counter', 'Sum of runtimes of the RQG runs per verdict.',
+              map { ("verdict=\"$_\"", $runtime_hash{$_}) } sort keys %runtime_hash);
+    $metric->('run_seconds_count', 'counter', 'Number of RQG runs per verdict.',
+              map { ("verdict=\"$_\"", $runs_hash{$_}) } sort keys %runs_hash);
+    $metric->('stopped_total', 'counter', 'RQG runs stopped by rqg_batch.pl per reason.',
+              map { ("reason=\"$_\"", $stop_hash{$_}) } sort keys %stop_hash);
+    $metric->('verdict_latency_seconds_sum', 'counter',
+              'Time between RQG runner finished and verdict registered.',
+              '', $verdict_latency_sum);
+    $metric->('verdict_latency_seconds_count', 'counter',
+              'Number of RQG runs in verdict_latency_seconds_sum.',
+              '', $verdict_latency_count);
+    $metric->('runtime_seconds', 'gauge', 'Runtime of rqg_batch.pl.', '', $elapsed);
+    return $text;
+}
+
+sub update {
+# To be called in the main loops of rqg_batch.pl.
+# Write the metrics file if due or forced and answer pending HTTP requests.
+    my ($force) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (defined $metrics_file and 0 < $metrics_interval and
+        ($force or time() - $last_write >= $metrics_interval)) {
+        # Readers must never see some half written file.
+        my $metrics_tmp = $metrics_file . ".tmp";
+        if (STATUS_OK == Basics::make_file($metrics_tmp, render())) {
+            rename($metrics_tmp, $metrics_file);
+        } else {
+            say("WARN: $who_am_i Writing '$metrics_tmp' failed.");
+        }
+        $last_write = time();
+    }
+    return if not defined $metrics_server;
+    while (my $client = $metrics_server->accept()) {
+        # Do not hang if some client connects and sends nothing or no complete line.
+        # So read non blocking and give up after 0.5s.
+        $client->blocking(0);
+        my $select   = IO::Select->new($client);
+        my $request  = '';
+        my $deadline = Time::HiRes::time() + 0.5;
+        while ($request !~ m{\n}) {
+            my $wait = $deadline - Time::HiRes::time();
+            last if $wait <= 0 or not $select->can_read($wait);
+            my $got = sysread($client, $request, 1024, length($request));
+            last if not $got;
+        }
+        $client->blocking(1);
+        if (defined $request and $request =~ m{^GET /(metrics)? }) {
+            my $body = render();
+            print $client "HTTP/1.0 200 OK\r\n"                                  .
+                          "Content-Type: text/plain; version=0.0.4\r\n"          .
+                          "Content-Length: " . length($body) . "\r\n\r\n" . $body;
+        } else {
+            print $client "HTTP/1.0 404 Not Found\r\n\r\n";
+        }
+        close($client);
+    }
+}
+
+sub help {
+    print("\nHELP about the rqg_batch.pl options 'metrics_interval' and 'metrics_port'.\n"        .
+          "--metrics_interval=<n>\n"                                                           .
+          "    Rewrite every <n> seconds the file <workdir>/" . METRICS_FILE . " containing\n"   .
+          "    metrics (workers, load range, ResourceControl readings, verdicts, runtimes, ...)\n" .
+          "    in the Prometheus text format. 0 disables the file.\n"                           .
+          "    (Default) " . METRICS_INTERVAL_DEFAULT . "\n"                                   .
+          "--metrics_port=<port>\n"                                                            .
+          "    Serve the metrics in addition via HTTP on 127.0.0.1:<port>/metrics .\n"          .
+          "    (Default) No HTTP endpoint.\n");
+}
+
+1;
@@ -0,0 +1,299 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+
+package Checkpoint;
+
+# Purpose
+# -------
+# Make the order management state of some rqg_batch.pl run crash safe so that a campaign can
+# be resumed after the rqg_batch.pl process died (OOM killer, box reboot, ssh session lost).
+#
+# Files within the workdir of the rqg_batch.pl run
+# ------------------------------------------------
+# checkpoint.sto -- Storable image of the state of all registered modules + the RQG runs which
+#                   were in work at checkpoint time. Written to checkpoint.sto.tmp first and
+#                   than renamed. So checkpoint.sto is all time complete.
+# checkpoint.wal -- Write ahead log. One line per result of some RQG run which gets registered
+#                   after the last checkpoint. Gets emptied after every checkpoint.
+#
+# The modules (Batch, Combinator, Simplifier, ...) register references to their variables.
+# Storable makes deep copies of the referenced data and a restore copies the data back into
+# these variables.
+#
+
+use strict;
+use Storable;
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+
+use constant CHECKPOINT_FILE             => 'checkpoint.sto';
+use constant CHECKPOINT_WAL              => 'checkpoint.wal';
+use constant CHECKPOINT_VERSION          => 1;
+use constant CHECKPOINT_INTERVAL_DEFAULT => 60;
+
+my $checkpoint_file;
+my $wal_file;
+my $checkpoint_interval;
+my $last_checkpoint = 0;
+my $wal_sequence    = 0;
+
+# Name of the module -> (name of the variable -> reference to the variable)
+my %state_hash;
+
+sub check_and_set_checkpoint {
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- wrong value assigned to checkpoint_interval
+    my ($workdir, $interval) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (2 != scalar @_ or not defined $workdir) {
+        my $status = STATUS_INTERNAL_ERROR;
+        Carp::cluck("INTERNAL ERROR: $who_am_i Exact two parameters(workdir, interval) need to " .
+                    "get assigned and workdir must be defined. " .
+                    Basics::exit_status_text($status));
+        safe_exit($status);
+    }
+    $interval = CHECKPOINT_INTERVAL_DEFAULT if not defined $interval;
+    if ($interval !~ m{^[0-9]+$}) {
+        say("ERROR: $who_am_i The value '$interval' assigned to checkpoint_interval is not " .
+            "a non negative integer.");
+        help();
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $checkpoint_interval = $interval;
+    $checkpoint_file     = $workdir . "/" . CHECKPOINT_FILE;
+    $wal_file            = $workdir . "/" . CHECKPOINT_WAL;
+    if (0 == $checkpoint_interval) {
+        say("INFO: $who_am_i checkpoint_interval is 0. No checkpoints will be written.");
+    } else {
+        say("INFO: $who_am_i Checkpoints get written every $checkpoint_interval" . "s to " .
+            "'$checkpoint_file'.");
+    }
+    return STATUS_OK;
+}
+
+sub is_enabled {
+    return (defined $checkpoint_interval and 0 < $checkpoint_interval) ? 1 : 0;
+}
+
+sub get_checkpoint_file {
+    return $checkpoint_file;
+}
+
+sub get_wal_sequence {
+# The sequence number of the last record in the write ahead log.
+# append_wal will use get_wal_sequence() + 1 for the next record.
+    return $wal_sequence;
+}
+
+sub register_state {
+    my ($name, $refs) = @_;
+    $state_hash{$name} = $refs;
+}
+
+sub checkpoint_due {
+    return 0 if not is_enabled();
+    return (time() - $last_checkpoint >= $checkpoint_interval) ? 1 : 0;
+}
+
+sub write_checkpoint {
+# Write the state of all registered modules + the assigned information about the RQG runs in
+# work into the checkpoint file and empty the write ahead log.
+#
+# Return values
+# STATUS_OK                  -- success or checkpointing not enabled
+# STATUS_ENVIRONMENT_FAILURE -- writing failed, the previous checkpoint + WAL are still valid
+    my ($in_flight, $complete) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    return STATUS_OK if not is_enabled();
+
+    my $checkpoint = {
+        version      => CHECKPOINT_VERSION,
+        time         => time(),
+        pid          => $$,
+        wal_sequence => $wal_sequence,
+        complete     => ($complete ? 1 : 0),
+        in_flight    => $in_flight,
+        state        => \%state_hash,
+    };
+    my $checkpoint_tmp = $checkpoint_file . ".tmp";
+    eval { Storable::nstore($checkpoint, $checkpoint_tmp) };
+    if ($@) {
+        say("ERROR: $who_am_i Writing the checkpoint '$checkpoint_tmp' failed : $@");
+        unlink($checkpoint_tmp);
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    if (not rename($checkpoint_tmp, $checkpoint_file)) {
+        say("ERROR: $who_am_i Renaming '$checkpoint_tmp' to '$checkpoint_file' failed : $!");
+        unlink($checkpoint_tmp);
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    # All entries in the WAL are covered by the checkpoint now.
+    # In case we die before emptying it than the entries get skipped because of their sequence.
+    if (STATUS_OK != Basics::make_file($wal_file, undef)) {
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $last_checkpoint = time();
+    say("DEBUG: $who_am_i Checkpoint written (wal_sequence $wal_sequence).")
+        if Auxiliary::script_debug("B3");
+    return STATUS_OK;
+}
+
+sub read_checkpoint {
+# Return values
+# - success  reference to the checkpoint
+# - failure  undef
+    my $who_am_i = Basics::who_am_i;
+
+    if (not -f $checkpoint_file) {
+        say("ERROR: $who_am_i The checkpoint file '$checkpoint_file' does not exist.");
+        return undef;
+    }
+    my $checkpoint = eval { Storable::retrieve($checkpoint_file) };
+    if ($@ or not defined $checkpoint) {
+        say("ERROR: $who_am_i Reading the checkpoint file '$checkpoint_file' failed : $@");
+        return undef;
+    }
+    if (not defined $checkpoint->{version} or CHECKPOINT_VERSION != $checkpoint->{version}) {
+        say("ERROR: $who_am_i The checkpoint file '$checkpoint_file' has an unsupported " .
+            "version.");
+        return undef;
+    }
+    return $checkpoint;
+}
+
+sub restore_state {
+# Copy the content of the checkpoint back into the variables of the registered modules.
+#
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- the checkpoint does not fit to the registered modules
+    my ($checkpoint) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $saved_state = $checkpoint->{state};
+    foreach my $name (sort keys %state_hash) {
+        if (not exists $saved_state->{$name}) {
+            say("ERROR: $who_am_i The checkpoint contains no state for '$name'.");
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+        foreach my $var (sort keys %{$state_hash{$name}}) {
+            my $live  = $state_hash{$name}->{$var};
+            my $saved = $saved_state->{$name}->{$var};
+            if (not defined $saved) {
+                say("WARN: $who_am_i The checkpoint contains no value for '${name}::$var'. " .
+                    "Keeping the current value.");
+                next;
+            }
+            if      (ref $live eq 'SCALAR' or ref $live eq 'REF') {
+                $$live = $$saved;
+            } elsif (ref $live eq 'ARRAY') {
+                @$live = @$saved;
+            } elsif (ref $live eq 'HASH') {
+                %$live = %$saved;
+            } else {
+                my $status = STATUS_INTERNAL_ERROR;
+                Carp::cluck("INTERNAL ERROR: $who_am_i '${name}::$var' is registered with the " .
+                            "unsupported reference type '" . ref($live) . "'. " .
+                            Basics::exit_status_text($status));
+                safe_exit($status);
+            }
+        }
+    }
+    $wal_sequence    = $checkpoint->{wal_sequence};
+    $last_checkpoint = time();
+    return STATUS_OK;
+}
+
+# The fields of some WAL entry are separated by tab. undef gets stored as '\u'.
+sub wal_encode {
+    my ($value) = @_;
+    return '\u' if not defined $value;
+    $value =~ s{\\}{\\\\}g;
+    $value =~ s{\t}{\\t}g;
+    $value =~ s{\n}{\\n}g;
+    return $value;
+}
+
+sub wal_decode {
+    my ($value) = @_;
+    return undef if $value eq '\u';
+    my %unescape = ('\\' => '\\', 't' => "\t", 'n' => "\n");
+    $value =~ s{\\(.)}{$unescape{$1}}g;
+    return $value;
+}
+
+sub append_wal {
+# Append some result record before it gets registered.
+#
+# Return values
+# STATUS_OK                  -- success or checkpointing not enabled
+# STATUS_ENVIRONMENT_FAILURE -- write failed
+    my (@record) = @_;
+
+    return STATUS_OK if not is_enabled();
+    $wal_sequence++;
+    my $line = join("\t", $wal_sequence, map { wal_encode($_) } @record) . "\n";
+    if (not -f $wal_file) {
+        return STATUS_ENVIRONMENT_FAILURE if STATUS_OK != Basics::make_file($wal_file, undef);
+    }
+    return Basics::append_string_to_file($wal_file, $line);
+}
+
+sub read_wal {
+# Return the records from the WAL which are not covered by the checkpoint.
+# An incomplete last line (rqg_batch.pl died during writing) gets ignored.
+    my ($after_sequence) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my @records;
+    return @records if not -f $wal_file;
+    if (not open(WAL_FILE, '<', $wal_file)) {
+        say("ERROR: $who_am_i Open file '$wal_file' failed : $!");
+        return @records;
+    }
+    while (my $line = <WAL_FILE>) {
+        last if $line !~ s{\n$}{};
+        my ($sequence, @fields) = split(/\t/, $line, -1);
+        next if $sequence <= $after_sequence;
+        push @records, [ map { wal_decode($_) } @fields ];
+        $wal_sequence = $sequence;
+    }
+    close(WAL_FILE);
+    return @records;
+}
+
+sub help {
+    print("\nHELP about the rqg_batch.pl options 'resume' and 'checkpoint_interval'.\n"              .
+          "--checkpoint_interval=<n>\n"                                                          .
+          "    Write every <n> seconds the order management state of the campaign into the file\n"  .
+          "    <workdir>/" . CHECKPOINT_FILE . ". Every result of some RQG run registered between\n" .
+          "    two checkpoints gets logged before into <workdir>/" . CHECKPOINT_WAL . ".\n"         .
+          "    0 disables checkpoints.\n"                                                          .
+          "    (Default) " . CHECKPOINT_INTERVAL_DEFAULT . "\n"                                  .
+          "--resume=<runid>\n"                                                                   .
+          "    Continue the campaign with the workdir <results_dir from local.cfg>/<runid> after\n" .
+          "    the rqg_batch.pl process died. The call must be otherwise the same as before.\n"    .
+          "    RQG runs which finished while no rqg_batch.pl was running get a verdict and are\n"  .
+          "    registered. RQG runs which did not finish get repeated.\n"                        .
+          "    The previous rqg_batch.pl process must be no more alive.\n");
+}
+
+1;
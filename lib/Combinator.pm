@@ -838,5 +838,24 @@ sub register_result {
 
 } # End sub register_result
 
+sub checkpoint_state {
+# References to the variables which change during the campaign. Needed for resume after
+# some death of rqg_batch.pl. See lib/Checkpoint.pm.
+    return {
+        order_array          => \@order_array,
+        left_over_trials     => \$left_over_trials,
+        prng                 => \$prng,
+        next_order_id        => \$next_order_id,
+        trial_counter        => \$trial_counter,
+        next_comb_id         => \$next_comb_id,
+        trial_num            => \$trial_num,
+        comb_counter         => \$comb_counter,
+        generate_calls       => \$generate_calls,
+        order_id_now         => \$order_id_now,
+        arrival_number       => \$arrival_number,
+        have_initiated_abort => \$have_initiated_abort,
+    };
+}
+
 1;
 
@@ -44,6 +44,7 @@ use GenTest_e::IPC::Channel;
 use GenTest_e::IPC::Process;
 use GenTest_e::ErrorFilter;
 use GenTest_e::Grammar;
+use GenTest_e::Random;
 
 use POSIX;
 use Time::HiRes;
@@ -173,6 +174,11 @@ sub do_init {
         $ENV{RQG_DEBUG} = 1 if $self->config->debug;
 
         $self->initSeed();
+        if (defined $self->config->property('prng') and
+            not GenTest_e::Random::setDefaultAlgorithm($self->config->property('prng'))) {
+            say("WARN: GenTest_e::App::GenTest_e::do_init: The PRNG algorithm '" .
+                $self->config->property('prng') . "' is not supported. Will use the default.");
+        }
 
         # FIXME:
         # We only initialize here.
@@ -225,6 +231,10 @@ sub doGenTest {
     # This might last quite long on some heavy loaded box.
     # Hence we do it now before computing when worker threads should start their activity.
 #   my @log_files_to_report;
+    # The MetaDataCacher, the threads and the reporters share the schema metadata via this file.
+    my $metadata_snapshot = tmpdir() . "metadata.sto";
+    unlink($metadata_snapshot, $metadata_snapshot . ".lock");
+    GenTest_e::Executor::setMetaDataSnapshot($metadata_snapshot);
     foreach my $i (0..2) {
         # FIXME:
         # IMHO MetaDataCaching for different servers is questionable.
@@ -374,6 +384,8 @@ sub doGenTest {
     my $reporter_pid = $self->reportingProcess();
 
     ### Start worker children ###
+    # Load the dictionaries now so that all workers share their pages.
+    GenTest_e::Random::preloadDictionaries();
     my %worker_pids;   # Hash with pairs: OS pid -- Task of that process inside RQG.
 
     if ($self->config->threads > 0) {
@@ -882,7 +894,7 @@ sub workerProcess {
     my $ctrl_c = 0;
     local $SIG{INT} = sub { $ctrl_c = 1 };
 
-    $self->generator()->setSeed($self->config->seed() + $worker_id);
+    $self->generator()->setSeed($self->config->seed(), $worker_id);
     $self->generator()->setThreadId($worker_id);
 
     my @executors;
@@ -900,6 +912,7 @@ sub workerProcess {
         $executor->setId($i + 1);
         $executor->setRole($worker_role);
         $executor->setTask(GenTest_e::Executor::EXECUTOR_TASK_THREAD);
+        $executor->setPsCache($self->config->property('ps-cache'));
         push @executors, $executor;
     }
 
@@ -952,6 +965,15 @@ sub workerProcess {
         undef $executor;
     }
 
+    # rqg.pl merges the files of all workers.
+    my $coverage_dir = $self->config->property('rule-coverage');
+    if (defined $coverage_dir and $self->generator()->can('writeCoverage')) {
+        my $coverage_file = $coverage_dir . "/" .
+                            GenTest_e::Generator::FromGrammar::COVERAGE_FILE_PREFIX() . $worker_id;
+        say("WARN: $who_am_i Writing the rule coverage file '$coverage_file' failed.")
+            if STATUS_OK != $self->generator()->writeCoverage($coverage_file);
+    }
+
     # Forcefully deallocate the Mixer so that Validator destructors are called
     undef $mixer;
     undef $self->[GT_QUERY_FILTERS];
@@ -1000,7 +1022,8 @@ sub doGenData {
                server_id            => $i,
                notnull              => $self->config->notnull,
                rows                 => $self->config->rows,
-               varchar_length       => $self->config->property('varchar-length')
+               varchar_length       => $self->config->property('varchar-length'),
+               parallel             => $self->config->property('gendata-parallel')
             )->run();
         }
         last if STATUS_CRITICAL_FAILURE <= $gendata_result;
@@ -1025,7 +1048,8 @@ sub doGenData {
                server_id            => $i,
                notnull              => $self->config->notnull,
                rows                 => $self->config->rows,
-               varchar_length       => $self->config->property('varchar-length')
+               varchar_length       => $self->config->property('varchar-length'),
+               parallel             => $self->config->property('gendata-parallel')
             )->run();
         } elsif ($self->config->gendata() eq 'None') {
             # Do nothing
@@ -1047,7 +1071,8 @@ sub doGenData {
                server_id            => $i,
                short_column_names   => $self->config->short_column_names,
                strict_fields        => $self->config->strict_fields,
-               notnull              => $self->config->notnull
+               notnull              => $self->config->notnull,
+               parallel             => $self->config->property('gendata-parallel')
             )->run();
         }
         last if STATUS_CRITICAL_FAILURE <= $gendata_result;
@@ -1187,7 +1212,12 @@ sub initGenerator {
         varchar_length  => $self->config->property('varchar-length'),
         mask            => $self->config->mask,
         mask_level      => $self->config->property('mask-level'),
-        annotate_rules  => $self->config->property('annotate-rules')
+        annotate_rules  => $self->config->property('annotate-rules'),
+        coverage        => defined $self->config->property('rule-coverage'),
+        adaptive_weights => $self->config->property('adaptive-weights'),
+        adaptive_trace  => $self->config->property('adaptive-weights-trace'),
+        adaptive_replay => $self->config->property('adaptive-weights-replay'),
+        generate_ahead  => $self->config->property('generate-ahead')
     );
 
     if (not defined $self->generator()) {
@@ -29,6 +29,7 @@ use GenTest_e;
 use GenTest_e::Constants;
 use GenTest_e::Random;
 use GenTest_e::Executor;
+use GenTest_e::App::GendataParallel;
 
 use Data::Dumper;
 
@@ -81,6 +82,7 @@ use constant GD_SQLTRACE                => 9;
 use constant GD_NOTNULL                 => 10;
 use constant GD_SHORT_COLUMN_NAMES      => 11;
 use constant GD_STRICT_FIELDS           => 12;
+use constant GD_PARALLEL                => 13;
 
 sub new {
     my $class = shift;
@@ -98,6 +100,7 @@ sub new {
         'short_column_names'  => GD_SHORT_COLUMN_NAMES,
         'strict_fields'       => GD_STRICT_FIELDS,
         'server_id'           => GD_SERVER_ID,
+        'parallel'            => GD_PARALLEL,
         'sqltrace'            => GD_SQLTRACE},@_);
 
     if (not defined $self->[GD_SEED]) {
@@ -170,25 +173,19 @@ sub short_column_names {
 }
 
 
+sub parallel {
+    return $_[0]->[GD_PARALLEL] || 1;
+}
+
 sub strict_fields {
     return $_[0]->[GD_STRICT_FIELDS];
 }
 
 
-sub run {
+sub newExecutor {
+# Return ($status, $executor) for some new connection to the server prepared for Gendata.
     my ($self) = @_;
 
-    # Begin marker for tools which extract the SQL's.
-    say("INFO: Starting GenTest_e::App::Gendata");
-
-    my $spec_file = $self->spec_file();
-
-    my $prng = GenTest_e::Random->new(
-        seed => $self->seed(),
-        varchar_length => $self->varchar_length()
-    );
-    Carp::cluck("WARN: FIXME varchar_length is undef") if not defined $self->varchar_length();
-
     my $executor = GenTest_e::Executor->newFromDSN($self->dsn());
     # Set the number to which server we will connect.
     # This number is
@@ -204,6 +201,37 @@ sub run {
     my $status = $executor->init();
     return $status if $status != STATUS_OK;
 
+    if ($executor->type == DB_MYSQL) {
+        my $result = $executor->execute("SET SQL_MODE= CONCAT(\@\@sql_mode,',NO_ENGINE_SUBSTITUTION')");
+        my $status = $result->status;
+        return $status if $status != STATUS_OK;
+    }
+    if ((defined $self->engine() and $self->engine() ne '') and
+        ($executor->type == DB_MYSQL or $executor->type == DB_DRIZZLE)) {
+        my $result = $executor->execute("SET DEFAULT_STORAGE_ENGINE= '" . $self->engine() . "'");
+        my $status = $result->status;
+        return $status if $status != STATUS_OK;
+    }
+    return (STATUS_OK, $executor);
+}
+
+sub run {
+    my ($self) = @_;
+
+    # Begin marker for tools which extract the SQL's.
+    say("INFO: Starting GenTest_e::App::Gendata");
+
+    my $spec_file = $self->spec_file();
+
+    my $prng = GenTest_e::Random->new(
+        seed => $self->seed(),
+        varchar_length => $self->varchar_length()
+    );
+    Carp::cluck("WARN: FIXME varchar_length is undef") if not defined $self->varchar_length();
+
+    my ($status, $executor) = $self->newExecutor();
+    return $status if $status != STATUS_OK;
+
 #
 # The specification file is actually a perl script, so we read it by
 # eval()-ing it
@@ -232,18 +260,6 @@ sub run {
         }
     }
 
-    if ($executor->type == DB_MYSQL) {
-        my $result = $executor->execute("SET SQL_MODE= CONCAT(\@\@sql_mode,',NO_ENGINE_SUBSTITUTION')");
-        my $status = $result->status;
-        return $status if $status != STATUS_OK;
-    }
-    if ((defined $self->engine() and $self->engine() ne '') and
-        ($executor->type == DB_MYSQL or $executor->type == DB_DRIZZLE)) {
-        my $result = $executor->execute("SET DEFAULT_STORAGE_ENGINE= '" . $self->engine() . "'");
-        my $status = $result->status;
-        return $status if $status != STATUS_OK;
-    }
-
     if (defined $schemas) {
         # The zz/spec_file contains stuff like   $schemas = [ 'test1' , 'test2' ];
         push(@schema_perms, @$schemas);
@@ -515,18 +531,9 @@ sub run {
         $table->[TABLE_SQL] = join(' ' , grep { defined $_ and $_ ne '' } @table_copy);
     }	
 
-    foreach my $schema (@schema_perms) {
-        my $result = $executor->execute("CREATE SCHEMA /*!IF NOT EXISTS*/ $schema");
-        my $status = $result->status;
-        return $status if $status != STATUS_OK;
-        $executor->sqltrace($self->sqltrace);
-        if (not defined $executor->currentSchema($schema)) {
-            say("ERROR: The call of currentSchema failed. Will return STATUS_CRITICAL_FAILURE.");
-            return STATUS_CRITICAL_FAILURE;
-        }
-
-    foreach my $table_id (0..$#tables) {
-        my $table = $tables[$table_id];
+    # Create and fill one table in the current schema. Return the status.
+    my $gen_table = sub {
+        my ($executor, $prng, $schema, $table) = @_;
         my @table_copy = @$table;
         my @fields_copy = @fields;
 
@@ -598,7 +605,7 @@ sub run {
                 return $status;
             } else {
                 # We have no table.
-                next;
+                return STATUS_OK;
             }
         }
 
@@ -770,6 +777,55 @@ sub run {
                 $status = $result->status;
                 return $status if $status != STATUS_OK;
             }
+        return STATUS_OK;
+    };
+
+    if ($self->parallel() > 1 and scalar @schema_perms * scalar @tables > 1) {
+        # Create the schemas first. The tables get than created and filled by parallel
+        # connections. Every table uses its own PRNG stream.
+        foreach my $schema (@schema_perms) {
+            my $result = $executor->execute("CREATE SCHEMA /*!IF NOT EXISTS*/ $schema");
+            my $status = $result->status;
+            return $status if $status != STATUS_OK;
+        }
+        my @jobs = map { my $schema = $_; map { [ $schema, $_ ] } (0..$#tables) } @schema_perms;
+        my $status = GenTest_e::App::GendataParallel::run("Gendata:", $self->parallel(),
+            scalar @jobs,
+            sub { return $self->newExecutor() },
+            sub {
+                my ($executor, $job_id) = @_;
+                my ($schema, $table_id) = @{$jobs[$job_id]};
+                if (not defined $executor->currentSchema($schema)) {
+                    say("ERROR: The call of currentSchema failed. Will return STATUS_CRITICAL_FAILURE.");
+                    return STATUS_CRITICAL_FAILURE;
+                }
+                my $prng = GenTest_e::Random->new(
+                    seed           => $self->seed(),
+                    stream         => $job_id + 1,
+                    varchar_length => $self->varchar_length()
+                );
+                return $gen_table->($executor, $prng, $schema, $tables[$table_id]);
+            });
+        return $status if $status != STATUS_OK;
+        # The serial variant ends with the last schema being the current one.
+        if (not defined $executor->currentSchema($schema_perms[-1])) {
+            say("ERROR: The call of currentSchema failed. Will return STATUS_CRITICAL_FAILURE.");
+            return STATUS_CRITICAL_FAILURE;
+        }
+    } else {
+        foreach my $schema (@schema_perms) {
+            my $result = $executor->execute("CREATE SCHEMA /*!IF NOT EXISTS*/ $schema");
+            my $status = $result->status;
+            return $status if $status != STATUS_OK;
+            $executor->sqltrace($self->sqltrace);
+            if (not defined $executor->currentSchema($schema)) {
+                say("ERROR: The call of currentSchema failed. Will return STATUS_CRITICAL_FAILURE.");
+                return STATUS_CRITICAL_FAILURE;
+            }
+            foreach my $table_id (0..$#tables) {
+                my $status = $gen_table->($executor, $prng, $schema, $tables[$table_id]);
+                return $status if $status != STATUS_OK;
+            }
         }
     }
 
@@ -26,8 +26,10 @@ use GenTest_e;
 use GenTest_e::Constants;
 use GenTest_e::Random;
 use GenTest_e::Executor;
+use GenTest_e::App::GendataParallel;
 
 use Data::Dumper;
+use File::Temp;
 
 use constant GDS_DEFAULT_DSN => 'dbi:mysql:host=127.0.0.1:port=9306:user=root:database=test';
 
@@ -40,10 +42,21 @@ use constant GDS_ROWS => 5;
 use constant GDS_VARCHAR_LENGTH => 6;
 use constant GDS_VCOLS => 7;
 use constant GDS_SERVER_ID => 8;
+use constant GDS_PARALLEL => 9;
 
 use constant GDS_DEFAULT_ROWS => [0, 1, 20, 100, 1000, 0, 1, 20, 100];
 use constant GDS_DEFAULT_NAMES => ['t1', 't2', 't3', 't4', 't5', 't6', 't7', 't8', 't9'];
 
+# Rows per multi-row INSERT
+use constant GDS_INSERT_ROWS => 500;
+# Rows or bytes per LOAD DATA LOCAL INFILE, whatever is reached first
+use constant GDS_LOAD_DATA_ROWS  => 100000;
+use constant GDS_LOAD_DATA_BYTES => 16777216;
+# Errors which show that LOAD DATA LOCAL INFILE is not available and nothing was loaded.
+# 1148 ER_NOT_ALLOWED_COMMAND, 2068 CR_LOAD_DATA_LOCAL_INFILE_REJECTED,
+# 4166 ER_LOAD_INFILE_CAPABILITY_DISABLED
+use constant GDS_LOAD_DATA_REFUSED => { 1148 => 1, 2068 => 1, 4166 => 1 };
+
 my $prng;
 
 sub new {
@@ -59,6 +72,7 @@ sub new {
         'rows' => GDS_ROWS,
         'varchar_length' => GDS_VARCHAR_LENGTH,
         'vcols' => GDS_VCOLS,
+        'parallel' => GDS_PARALLEL,
     },@_);
 
     if (not defined $self->[GDS_DSN]) {
@@ -104,12 +118,12 @@ sub varcharLength {
     return $_[0]->[GDS_VARCHAR_LENGTH] || 1;
 }
 
-sub run {
-    my ($self) = @_;
-
-    say("INFO: Starting GenTest_e::App::GendataAdvanced");
+sub parallel {
+    return $_[0]->[GDS_PARALLEL] || 1;
+}
 
-    $prng = GenTest_e::Random->new( seed => 0 );
+sub newExecutor {
+    my ($self) = @_;
 
     my $executor = GenTest_e::Executor->newFromDSN($self->dsn());
     if ($executor->type != DB_MYSQL) {
@@ -120,6 +134,17 @@ sub run {
     $executor->setRole("GendataAdvanced");
     $executor->setTask(GenTest_e::Executor::EXECUTOR_TASK_GENDATA);
     $executor->init();
+    return (STATUS_OK, $executor);
+}
+
+sub run {
+    my ($self) = @_;
+
+    say("INFO: Starting GenTest_e::App::GendataAdvanced");
+
+    $prng = GenTest_e::Random->new( seed => 0 );
+
+    my (undef, $executor) = $self->newExecutor();
 
     my $names = GDS_DEFAULT_NAMES;
     my $rows;
@@ -130,10 +155,24 @@ sub run {
         $rows = GDS_DEFAULT_ROWS;
     }
 
-    foreach my $i (0..$#$names) {
-        my $gen_table_result = $self->gen_table($executor, $names->[$i], $rows->[$i], $prng);
-        say("DEBUG: gen_table_result->$gen_table_result<-");
-        return $gen_table_result if $gen_table_result != STATUS_OK;
+    if ($self->parallel() > 1) {
+        # Every table uses its own PRNG stream. The random_* subs use the file scoped $prng
+        # which is per process.
+        my $status = GenTest_e::App::GendataParallel::run("GendataAdvanced:", $self->parallel(),
+            scalar @$names,
+            sub { return $self->newExecutor() },
+            sub {
+                my ($executor, $i) = @_;
+                $prng = GenTest_e::Random->new( seed => 0, stream => $i + 1 );
+                return $self->gen_table($executor, $names->[$i], $rows->[$i], $prng);
+            });
+        return $status if $status != STATUS_OK;
+    } else {
+        foreach my $i (0..$#$names) {
+            my $gen_table_result = $self->gen_table($executor, $names->[$i], $rows->[$i], $prng);
+            say("DEBUG: gen_table_result->$gen_table_result<-");
+            return $gen_table_result if $gen_table_result != STATUS_OK;
+        }
     }
 
     $executor->execute("SET SQL_MODE= CONCAT(\@\@sql_mode,',NO_ENGINE_SUBSTITUTION')")
@@ -514,8 +553,25 @@ sub gen_table {
         $executor->execute("ALTER TABLE $name ADD " . ($prng->uint16(0,5) ? 'INDEX' : 'UNIQUE') . "(". join(',',@cols) . ")");
     }
 
-    my @values;
-
+    # LOAD DATA LOCAL INFILE is much faster than INSERT. We fall back to INSERT if the server or
+    # client refuse it. $load_data gets set to 0 by load_rows in that case.
+    my $load_data = 1;
+    my @rows;
+    my $batch_bytes = 0;
+
+    # Non unique indexes and foreign keys need no checks during the load. The unique checks must
+    # stay because INSERT IGNORE and LOAD DATA ... IGNORE depend on them.
+    $executor->execute("SET \@gendata_foreign_key_checks = \@\@foreign_key_checks");
+    $executor->execute("SET SESSION foreign_key_checks = 0");
+    $executor->execute("ALTER TABLE $name DISABLE KEYS");
+
+    # INSERT gets decoded in the charset of the connection. LOAD DATA needs to be told.
+    my $charset_result = $executor->execute("SELECT \@\@character_set_client");
+    my $charset = ($charset_result->status() == STATUS_OK and defined $charset_result->data()) ?
+                  $charset_result->data()->[0]->[0] : undef;
+    $load_data = 0 if not defined $charset;
+
+    my $status = STATUS_OK;
     $executor->execute("START TRANSACTION");
     foreach my $row (1..$size) {
 
@@ -613,20 +669,116 @@ sub gen_table {
                 }
             }
             push @row_values, $val;
+            $batch_bytes += length($val);
         }
         # $rnd_int1, $rnd_int2, $rnd_date, $rnd_date, $rnd_time, $rnd_time, $rnd_datetime, $rnd_datetime, $rnd_varchar, $rnd_varchar)
-        push @values, "\n(" . join(',',@row_values).")";
-
-        ## We do one insert per 500 rows for speed
-        if ($row % 500 == 0 || $row == $size) {
-            my $insert_result = $executor->execute("
-            INSERT IGNORE INTO $name (" . join(",",@column_list).") VALUES" . join(",",@values));
-            return $insert_result->status() if $insert_result->status() != STATUS_OK;
-            @values = ();
+        push @rows, \@row_values;
+
+        if ($row == $size or
+            ($load_data ? (scalar @rows >= GDS_LOAD_DATA_ROWS or $batch_bytes >= GDS_LOAD_DATA_BYTES)
+                        : scalar @rows >= GDS_INSERT_ROWS)) {
+            $status = $load_data ?
+                      $self->load_rows($executor, $name, \@column_list, \%columns, \@rows,
+                                       $charset, \$load_data) :
+                      $self->insert_rows($executor, $name, \@column_list, \@rows);
+            last if $status != STATUS_OK;
+            @rows        = ();
+            $batch_bytes = 0;
         }
     }
-    $executor->execute("COMMIT");
+    # Whatever happened the session must not stay with foreign_key_checks = 0 and so on.
+    $executor->execute($status == STATUS_OK ? "COMMIT" : "ROLLBACK");
+
+    $executor->execute("ALTER TABLE $name ENABLE KEYS");
+    $executor->execute("SET SESSION foreign_key_checks = \@gendata_foreign_key_checks");
+    return $status;
+}
+
+sub insert_rows {
+    my ($self, $executor, $name, $column_list, $rows) = @_;
+
+    ## We do one insert per GDS_INSERT_ROWS rows for speed
+    for (my $first = 0; $first <= $#$rows; $first += GDS_INSERT_ROWS) {
+        my $last = $first + GDS_INSERT_ROWS - 1;
+        $last = $#$rows if $last > $#$rows;
+        my $insert_result = $executor->execute("
+            INSERT IGNORE INTO $name (" . join(",",@$column_list).") VALUES" .
+            join(",", map { "\n(" . join(',', @$_) . ")" } @{$rows}[$first..$last]));
+        return $insert_result->status() if $insert_result->status() != STATUS_OK;
+    }
     return STATUS_OK;
 }
 
+sub load_rows {
+# Write the rows as CSV into some file and let the server read it via LOAD DATA LOCAL INFILE.
+# The values arrive as SQL literals like INSERT needs them and get converted here. So the
+# data generated is the same for both ways.
+# If LOAD DATA gets refused than the rows get inserted and $$load_data is set to 0.
+    my ($self, $executor, $name, $column_list, $columns, $rows, $charset, $load_data) = @_;
+
+    # The tmpdir of the RQG run is in its vardir. So files kept for the SQL trace get archived
+    # or removed together with the vardir.
+    my ($fh, $file) = File::Temp::tempfile("gendata_" . $name . "_XXXXXX",
+                                           SUFFIX => '.csv', DIR => tmpdir(), UNLINK => 0);
+    if (not defined $fh) {
+        say("WARN: GendataAdvanced: Unable to create a file for LOAD DATA. Will use INSERT.");
+        $$load_data = 0;
+        return $self->insert_rows($executor, $name, $column_list, $rows);
+    }
+    binmode($fh);
+    foreach my $row_values (@$rows) {
+        print $fh join(',', map { load_data_field($_) } @$row_values) . "\n";
+    }
+    if (not close($fh)) {
+        say("WARN: GendataAdvanced: Unable to write '$file' for LOAD DATA: $!. Will use INSERT.");
+        unlink($file);
+        $$load_data = 0;
+        return $self->insert_rows($executor, $name, $column_list, $rows);
+    }
+
+    # BIT columns cannot be loaded from b'...' or from digits. Go via user variables.
+    my @targets;
+    my @bit_sets;
+    foreach my $cname (@$column_list) {
+        if ($columns->{$cname}->[0] eq 'BIT') {
+            push @targets,  '@' . $cname;
+            push @bit_sets, "$cname = CAST(\@$cname AS UNSIGNED)";
+        } else {
+            push @targets,  $cname;
+        }
+    }
+    my $load_result = $executor->execute("LOAD DATA LOCAL INFILE '$file' IGNORE INTO TABLE $name " .
+                            "CHARACTER SET $charset " .
+                            "FIELDS TERMINATED BY ',' OPTIONALLY ENCLOSED BY '\"' ESCAPED BY '\\\\' " .
+                            "LINES TERMINATED BY '\\n' (" . join(',', @targets) . ")" .
+                            (scalar @bit_sets ? " SET " . join(', ', @bit_sets) : ''));
+    # Keep the file if the SQL trace is written. Otherwise the trace could be not replayed.
+    unlink($file) if not $self->sqltrace;
+    if ($load_result->status() != STATUS_OK) {
+        if (defined $load_result->err() and GDS_LOAD_DATA_REFUSED->{$load_result->err()}) {
+            say("INFO: GendataAdvanced: LOAD DATA LOCAL INFILE is not available (" .
+                $load_result->err() . "). Will use INSERT.");
+            $$load_data = 0;
+            return $self->insert_rows($executor, $name, $column_list, $rows);
+        }
+        return $load_result->status();
+    }
+    return STATUS_OK;
+}
+
+sub load_data_field {
+# Convert the SQL literal to a field of the LOAD DATA file.
+    my ($val) = @_;
+    return '\N' if $val eq 'NULL';
+    if ($val =~ m{^'(.*)'$}s) {
+        # The backslash escapes of SQL strings mean the same in the file. Only '' and the
+        # enclosing " need a translation.
+        my $string = $1;
+        $string =~ s{(\\.|'')|"}{defined $1 ? ($1 eq "''" ? "'" : $1) : '\\"'}gse;
+        return '"' . $string . '"';
+    }
+    return oct('0b' . $1) if $val =~ m{^b'([01]*)'$};
+    return $val;
+}
+
 1;
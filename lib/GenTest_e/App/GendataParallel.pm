@@ -0,0 +1,100 @@
+# Copyright (c) 2024 MariaDB plc
+# Use is subject to license terms.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+# USA
+#
+
+# Purpose:
+# Run the jobs of Gendata, GendataSimple or GendataAdvanced (one job per table) in parallel
+# child processes. Every child has its own connection to the server.
+#
+# The children get the jobs in a fixed round robin order
+#    child 0 -- job 0, job n, job 2n, ...
+# and the jobs draw from PRNG streams derived from the seed and the job number.
+# So the data generated does not depend on timing or on the number of children.
+#
+# The alarm for max_gd_duration is armed in the RQG runner, which is the parent process.
+# In case it kicks in than the servers get killed and the children exit with the error
+# of their next SQL.
+
+package GenTest_e::App::GendataParallel;
+
+use strict;
+use IO::Handle;
+use GenTest_e;
+use GenTest_e::Constants;
+
+sub run {
+# $who       -- Some text to be used for messages
+# $parallel  -- Maximum number of child processes
+# $job_count -- Number of jobs
+# $connect   -- sub returning ($status, $executor), called once per child
+# $job       -- sub($executor, $job_id) returning the status of that job
+# Return the worst status of all jobs.
+    my ($who, $parallel, $job_count, $connect, $job) = @_;
+
+    $parallel = $job_count if $parallel > $job_count;
+    say("INFO: $who Running $job_count jobs in $parallel processes.");
+
+    my %child_pids;
+    foreach my $child_id (0..$parallel - 1) {
+        # Whatever buffered output would be else printed by the parent and the children.
+        STDOUT->flush();
+        STDERR->flush();
+        my $pid = fork();
+        if (not defined $pid) {
+            my $status = STATUS_ENVIRONMENT_FAILURE;
+            say("ERROR: $who fork failed: $!. " . Basics::return_status_text($status));
+            # The children already running are needed for the remaining jobs anyway.
+            kill 'KILL', keys %child_pids;
+            waitpid($_, 0) foreach keys %child_pids;
+            return $status;
+        }
+        if ($pid == 0) {
+            my ($status, $executor) = $connect->();
+            if ($status == STATUS_OK) {
+                for (my $job_id = $child_id; $job_id < $job_count; $job_id += $parallel) {
+                    my $job_status = $job->($executor, $job_id);
+                    $status = $job_status if $job_status > $status;
+                    last if $status != STATUS_OK;
+                }
+                $executor->disconnect() if $executor->can('disconnect');
+            }
+            # safe_exit does not flush buffered output.
+            STDOUT->flush();
+            STDERR->flush();
+            safe_exit($status);
+        }
+        $child_pids{$pid} = $child_id;
+    }
+
+    my $status = STATUS_OK;
+    foreach my $pid (keys %child_pids) {
+        waitpid($pid, 0);
+        my $child_status;
+        if ($? & 127) {
+            $child_status = STATUS_ENVIRONMENT_FAILURE;
+            say("ERROR: $who The Gendata process $child_pids{$pid} was killed by signal " .
+                ($? & 127) . ".");
+        } else {
+            $child_status = $? >> 8;
+        }
+        $status = $child_status if $child_status > $status;
+    }
+    say("INFO: $who All jobs finished. Status: " . status2text($status) . "($status)");
+    return $status;
+}
+
+1;
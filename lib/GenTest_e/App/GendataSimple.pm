@@ -26,6 +26,7 @@ use GenTest_e;
 use GenTest_e::Constants;
 use GenTest_e::Random;
 use GenTest_e::Executor;
+use GenTest_e::App::GendataParallel;
 
 use Data::Dumper;
 
@@ -40,6 +41,7 @@ use constant GDS_ROWS           => 5;
 use constant GDS_VARCHAR_LENGTH => 6;
 use constant GDS_VCOLS          => 7;
 use constant GDS_SERVER_ID      => 8;
+use constant GDS_PARALLEL       => 9;
 
 use constant GDS_DEFAULT_ROWS   => [0, 1, 20, 100, 1000, 0, 1, 20, 100];
 use constant GDS_DEFAULT_NAMES  => ['A', 'B', 'C', 'D', 'E', 'AA', 'BB', 'CC', 'DD'];
@@ -57,6 +59,7 @@ sub new {
         'varchar_length' => GDS_VARCHAR_LENGTH,
         'vcols'          => GDS_VCOLS,
         'server_id'      => GDS_SERVER_ID,
+        'parallel'       => GDS_PARALLEL,
    },@_);
 
    if (not defined $self->[GDS_DSN]) {
@@ -102,11 +105,12 @@ sub varcharLength {
    return $_[0]->[GDS_VARCHAR_LENGTH] || 1;
 }
 
-sub run {
-   my ($self) = @_;
+sub parallel {
+   return $_[0]->[GDS_PARALLEL] || 1;
+}
 
-   say("INFO: Starting GenTest_e::App::GendataSimple");
-   my $prng = GenTest_e::Random->new( seed => 0 );
+sub newExecutor {
+   my ($self) = @_;
 
    my $executor = GenTest_e::Executor->newFromDSN($self->dsn());
    # Set the number to which server we will connect.
@@ -116,6 +120,16 @@ sub run {
    $executor->setRole("GendataSimple");
    $executor->setTask(GenTest_e::Executor::EXECUTOR_TASK_GENDATA);
    $executor->init();
+   return (STATUS_OK, $executor);
+}
+
+sub run {
+   my ($self) = @_;
+
+   say("INFO: Starting GenTest_e::App::GendataSimple");
+   my $prng = GenTest_e::Random->new( seed => 0 );
+
+   my (undef, $executor) = $self->newExecutor();
 
    my $names = GDS_DEFAULT_NAMES;
    my $rows;
@@ -126,9 +140,22 @@ sub run {
       $rows = GDS_DEFAULT_ROWS;
    }
 
-   foreach my $i (0..$#$names) {
-      my $gen_table_result = $self->gen_table($executor, $names->[$i], $rows->[$i], $prng);
-      return $gen_table_result if $gen_table_result != STATUS_OK;
+   if ($self->parallel() > 1) {
+      # Every table uses its own PRNG stream.
+      my $status = GenTest_e::App::GendataParallel::run("GendataSimple:", $self->parallel(),
+         scalar @$names,
+         sub { return $self->newExecutor() },
+         sub {
+            my ($executor, $i) = @_;
+            my $prng = GenTest_e::Random->new( seed => 0, stream => $i + 1 );
+            return $self->gen_table($executor, $names->[$i], $rows->[$i], $prng);
+         });
+      return $status if $status != STATUS_OK;
+   } else {
+      foreach my $i (0..$#$names) {
+         my $gen_table_result = $self->gen_table($executor, $names->[$i], $rows->[$i], $prng);
+         return $gen_table_result if $gen_table_result != STATUS_OK;
+      }
    }
 
    # Need to create a dummy substituion for non-portable DUAL
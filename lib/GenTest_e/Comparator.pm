@@ -25,15 +25,14 @@ use strict;
 use GenTest_e;
 use GenTest_e::Constants;
 use GenTest_e::Result;
+use GenTest_e::Executor;
 
 #
-# In order to compare two data sets that may be sorted differently, we convert each row into a string,
-# then sort the rows and convert them into one gigantic string. Such string representation is no longer
-# dependent on sort order so can be compared safely.
-#
-# A O(N) algorithm that would avoid sorting is to use a hash representation of each data set. e.g. $hash{"A,B,C"} = 2
-# if there were two rows containing "A,B,C". If two hashes contain the same keys with the same values, the two initial
-# data sets were identical
+# In order to compare two data sets that may be sorted differently, we convert each row into a string
+# and count the rows per string in a hash. e.g. $hash{"A<col>B<col>C"} = 2 if there were two rows
+# containing A, B and C. If both data sets give the same counts, they were identical.
+# This is O(N) and avoids sorting and building one gigantic string per data set.
+# dumpDiff still sorts because diff needs the rows in the same order.
 #
 
 1;
@@ -52,6 +51,13 @@ sub compare {
 		my $resultset2 = $resultsets[$i+1];
 		if ($resultset1->status() != $resultset2->status()) {
 			return STATUS_ERROR_MISMATCH;
+		} elsif (defined $resultset1->digest() or defined $resultset2->digest()) {
+			# Result sets fetched as digest (EXECUTOR_FLAG_DIGEST_DATA)
+			my $digest1 = $resultset1->digest() || GenTest_e::Result::digestOfData($resultset1->data());
+			my $digest2 = $resultset2->digest() || GenTest_e::Result::digestOfData($resultset2->data());
+			return STATUS_LENGTH_MISMATCH if $digest1->{rows} != $digest2->{rows};
+			return STATUS_CONTENT_MISMATCH
+				if GenTest_e::Result::digestText($digest1) ne GenTest_e::Result::digestText($digest2);
 		} elsif (
 			(not defined $resultset1->data()) &&					# Only for DML statements
 			($resultset1->affectedRows() != $resultset2->affectedRows())
@@ -61,17 +67,59 @@ sub compare {
 			my $data1 = $resultset1->data();
 			my $data2 = $resultset2->data();
 			return STATUS_LENGTH_MISMATCH if $#$data1 != $#$data2;
-            # Original throws perl error messages in case $_ is neither undef nor numeric.
-			# my $data1_sorted = join('<row>', sort map { join('<col>', map { defined $_ ? ($_ != 0 ? sprintf("%.4f", $_) : $_) : 'NULL' } @$_) } @$data1);
-			# my $data2_sorted = join('<row>', sort map { join('<col>', map { defined $_ ? ($_ != 0 ? sprintf("%.4f", $_) : $_) : 'NULL' } @$_) } @$data2);
-			my $data1_sorted = join('<row>', sort map { join('<col>', map { defined $_ ? $_ : 'NULL' } @$_) } @$data1);
-			my $data2_sorted = join('<row>', sort map { join('<col>', map { defined $_ ? $_ : 'NULL' } @$_) } @$data2);
-			return STATUS_CONTENT_MISMATCH if $data1_sorted ne $data2_sorted;
+			return STATUS_CONTENT_MISMATCH if not sameRows($data1, $data2);
 		}
 	}
 	return STATUS_OK;
 }
 
+sub rowKey {
+	return join('<col>', map { defined $_ ? $_ : 'NULL' } @{$_[0]});
+}
+
+sub sameRows {
+# Return 1 if $data1 and $data2 contain the same rows with the same multiplicity and 0 otherwise.
+	my ($data1, $data2) = @_;
+	my %count;
+	$count{rowKey($_)}++ foreach (@{$data1 || []});
+	foreach my $row (@{$data2 || []}) {
+		return 0 if not $count{rowKey($row)}--;
+	}
+	return 0 if grep { $_ != 0 } values %count;
+	return 1;
+}
+
+sub sameKeys {
+# Return 1 if the hashes $hash1 and $hash2 have the same keys and 0 otherwise.
+	my ($hash1, $hash2) = @_;
+	return 0 if scalar(keys %$hash1) != scalar(keys %$hash2);
+	foreach my $key (keys %$hash2) {
+		return 0 if not exists $hash1->{$key};
+	}
+	return 1;
+}
+
+sub materialize {
+# Result sets fetched as digest have no data to show a diff for.
+# Return the results of running the SELECT once more with full fetch or the results as they are.
+# The content of the tables might have changed meanwhile. So the diff might differ.
+    my ($executors, $results) = @_;
+
+    return $results if not grep { defined $_->digest() } @$results;
+    return $results if $results->[0]->query() !~ m{^(?:\s|\(|/\*.*?\*/)*(?:SELECT|WITH)\b}sio;
+
+    say("INFO: Executing the query once more for getting the complete result sets.");
+    my @full_results;
+    foreach my $i (0..$#$results) {
+        my $executor = $executors->[$i];
+        my $flags = $executor->flags();
+        $executor->setFlags($flags & ~EXECUTOR_FLAG_DIGEST_DATA);
+        push @full_results, $executor->execute($results->[$i]->query());
+        $executor->setFlags($flags);
+    }
+    return \@full_results;
+}
+
 sub dumpDiff {
     my @results = @_;
 
@@ -38,6 +38,7 @@ require Exporter;
     EXECUTOR_FLAG_SILENT
     EXECUTOR_FLAG_PERFORMANCE
     EXECUTOR_FLAG_HASH_DATA
+    EXECUTOR_FLAG_DIGEST_DATA
 
     EXECUTOR_TASK
 );
@@ -45,6 +46,8 @@ require Exporter;
 use strict;
 use Carp;
 use Data::Dumper;
+use Fcntl qw(:flock);
+use Storable ();
 use GenTest_e;
 use GenTest_e::Constants;
 
@@ -79,6 +82,11 @@ use constant EXECUTOR_TASK                   => 23;
 # Used for better messages.
 # Gendata , GendataSimple, ... , Thread1, ...., Reporter....
 use constant EXECUTOR_ROLE                   => 24;
+# Maximum number of server side prepared statements per connection kept for reuse.
+# undef or 0 -- Send the statements as text (default)
+use constant EXECUTOR_PS_CACHE               => 25;
+# The state of the statement sent by executeAsync or its result.
+use constant EXECUTOR_IN_FLIGHT              => 26;
 
 use constant FETCH_METHOD_AUTO               => 0;
 use constant FETCH_METHOD_STORE_RESULT       => 1;
@@ -87,6 +95,8 @@ use constant FETCH_METHOD_USE_RESULT         => 2;
 use constant EXECUTOR_FLAG_SILENT            => 1;
 use constant EXECUTOR_FLAG_PERFORMANCE       => 2;
 use constant EXECUTOR_FLAG_HASH_DATA         => 4;
+# Fetch the result sets of SELECTs unbuffered and keep only a digest (see GenTest_e::Result).
+use constant EXECUTOR_FLAG_DIGEST_DATA       => 8;
 
 # We go with some fine grained differentiation.
 # (1) Raise SESSION max_statement_time and other timeouts whenever small values could cause a fail
@@ -109,7 +119,25 @@ use constant EXECUTOR_TASK_REPORTER          => 2; # (1), (2), (3), (4)
 use constant EXECUTOR_TASK_CHECKER           => 3; # (1), (2), (3), (4), (5)
 use constant EXECUTOR_TASK_UNKNOWN           => 4;
 
+# Schema metadata per metaDataKey
+# -------------------------------
+# %global_schema_cache   -- the metadata
+# %global_schema_version -- number of refreshes which led to the metadata
+# %global_schema_checked -- per schema the time of its last refresh
+# %global_schema_dirty   -- per schema 1 if DDL of the current process changed it since the
+#                           last refresh
+# In case setMetaDataSnapshot was called than the processes of the RQG run share the metadata
+# via the snapshot file. Only one process at a time refreshes, the others load the result.
 my %global_schema_cache;
+my %global_schema_version;
+my %global_schema_checked;
+my %global_schema_dirty;
+my $metadata_snapshot;
+my $metadata_snapshot_stat;   # dev:ino:mtime:size of the snapshot file when last looked at
+
+# A schema refreshed less than that many seconds ago is not refreshed again unless DDL of the
+# current process changed it.
+use constant METADATA_RECHECK_INTERVAL       => 1;
 
 1;
 
@@ -125,7 +153,8 @@ sub new {
         'fetch_method'   => EXECUTOR_FETCH_METHOD,
         'end_time'       => EXECUTOR_END_TIME,
         'task'           => EXECUTOR_TASK,
-        'role'           => EXECUTOR_ROLE
+        'role'           => EXECUTOR_ROLE,
+        'ps_cache'       => EXECUTOR_PS_CACHE
    }, @_);
 
    $executor->[EXECUTOR_FETCH_METHOD] = FETCH_METHOD_AUTO
@@ -239,6 +268,32 @@ sub end_time {
     return $_[0]->[EXECUTOR_END_TIME];
 }
 
+# Asynchronous execution
+# ----------------------
+# executeAsync sends the query and returns without waiting, reap returns the result.
+# At most one query per executor is in flight. Executors without asynchronous API run the
+# query already in executeAsync.
+
+sub executeAsync {
+    my ($executor, $query, $execution_flags) = @_;
+    $executor->[EXECUTOR_IN_FLIGHT] = $executor->execute($query, $execution_flags);
+}
+
+sub reap {
+    my ($executor) = @_;
+    my $result = $executor->[EXECUTOR_IN_FLIGHT];
+    $executor->[EXECUTOR_IN_FLIGHT] = undef;
+    return $result;
+}
+
+sub psCache {
+    return $_[0]->[EXECUTOR_PS_CACHE];
+}
+
+sub setPsCache {
+    $_[0]->[EXECUTOR_PS_CACHE] = $_[1];
+}
+
 sub set_end_time {
     $_[0]->[EXECUTOR_END_TIME] = $_[1];
 }
@@ -375,6 +430,12 @@ sub getCollationMetaData {
 ########### Metadata routines
 
 sub cacheMetaData {
+# $redo
+# - undef            -- use the cached metadata if there are any but refresh the schemas
+#                       changed by DDL of the current process (see observeDDL)
+# - 'redo'           -- refresh the metadata of all schemas
+# - ref to array     -- refresh the metadata of these schemas
+#
 # In case "getSchemaMetaData" or "getCollationMetaData" hit some problem than they return undef
 # and we return STATUS_ENVIRONMENT_FAILURE from here instead of aborting with croak.
 # The latter, abort with 'croak', 'exit' up till Perl error at various places, causes quite often
@@ -409,47 +470,9 @@ sub cacheMetaData {
         }
     }
 
-    if ($redo or not exists $global_schema_cache{$self->dsn()}) {
-        say ("Caching schema metadata for " . $self->dsn());
-
-
-        my $metadata= $self->getSchemaMetaData();
-        if (not defined $metadata) {
-            # The 'cluck' is because we might offer metadata caching multiple times
-            # in future.
-            my $status = STATUS_CRITICAL_FAILURE;
-            Carp::cluck("ERROR: Failed to cache schema metadata. " .
-                        Basics::return_status_text($status));
-            return $status;
-        }
-
-        foreach my $row (@$metadata) {
-            my ($schema, $table, $type, $col, $key, $metatype, $realtype, $maxlength, $table_rows) = @$row;
-            $table_rows= 0 unless defined $table_rows;
-            $meta->{$schema}={} if not exists $meta->{$schema};
-            $meta->{$schema}->{'bigtable'}={} if not exists $meta->{$schema}->{'bigtable'};
-            $meta->{$schema}->{'bigbasetable'}={} if not exists $meta->{$schema}->{'bigbasetable'};
-            $meta->{$schema}->{'smalltable'}={} if not exists $meta->{$schema}->{'smalltable'};
-            $meta->{$schema}->{'smallbasetable'}={} if not exists $meta->{$schema}->{'bigbasetable'};
-            if ($table_rows < 500) {
-                $meta->{$schema}->{'smalltable'}->{$table} = $table_rows;
-                if ($type eq 'table') {
-                    $meta->{$schema}->{'smallbasetable'}->{$table} = $table_rows;
-                }
-            } else {
-                $meta->{$schema}->{'bigtable'}->{$table} = $table_rows;
-                if ($type eq 'table') {
-                    $meta->{$schema}->{'bigbasetable'}->{$table} = $table_rows;
-                }
-            }
-            $meta->{$schema}->{$type}={} if not exists $meta->{$schema}->{$type};
-            $meta->{$schema}->{$type}->{$table}={} if not exists $meta->{$schema}->{$type}->{$table};
-            $meta->{$schema}->{$type}->{$table}->{$col}= [$key,$metatype,$realtype,$maxlength];
-        }
-        $global_schema_cache{$self->dsn()} = $meta;
-    } else {
-        $meta = $global_schema_cache{$self->dsn()};
-    }
+    my $status = $self->cacheSchemaMetaData($redo);
+    return $status if $status != STATUS_OK;
+    $meta = $global_schema_cache{$self->metaDataKey()};
 
     $self->[EXECUTOR_SCHEMA_METADATA] = $meta;
 
@@ -487,6 +510,211 @@ sub cacheMetaData {
     return STATUS_OK;
 }
 
+sub setMetaDataSnapshot {
+# Share the schema metadata between all processes of the RQG run via the file $file.
+# The RQG runner calls this before the processes get forked.
+    ($metadata_snapshot) = @_;
+}
+
+sub metaDataKey {
+# The metadata do not depend on the user. So the MetaDataCacher (user=root), the threads
+# (user=Thread<n>) and the reporters share them.
+    my $key = $_[0]->dsn();
+    $key =~ s{user=[^:;]*}{}io;
+    return $key;
+}
+
+sub lockMetaData {
+# Return the handle holding the lock or undef if there is no snapshot file.
+# The lock gets released when the handle goes out of scope.
+    return undef if not defined $metadata_snapshot;
+    my $lock_fh;
+    if (not open($lock_fh, '>>', $metadata_snapshot . ".lock") or not flock($lock_fh, LOCK_EX)) {
+        say("WARN: Unable to lock the metadata snapshot '$metadata_snapshot': $!");
+        return undef;
+    }
+    return $lock_fh;
+}
+
+sub loadMetaDataSnapshot {
+# Take the metadata from the snapshot file if they are more recent than the cached ones.
+    my ($key) = @_;
+    return if not defined $metadata_snapshot or not -e $metadata_snapshot;
+    my $snapshot = eval { Storable::retrieve($metadata_snapshot) };
+    return if not defined $snapshot or not defined $snapshot->{$key};
+    return if defined $global_schema_version{$key} and
+              $global_schema_version{$key} >= $snapshot->{$key}->{version};
+    $global_schema_cache{$key}   = $snapshot->{$key}->{meta};
+    $global_schema_version{$key} = $snapshot->{$key}->{version};
+    $global_schema_checked{$key} = $snapshot->{$key}->{checked};
+}
+
+sub storeMetaDataSnapshot {
+# The caller has to hold the lock.
+    my ($key) = @_;
+    return if not defined $metadata_snapshot;
+    my $snapshot;
+    $snapshot = eval { Storable::retrieve($metadata_snapshot) } if -e $metadata_snapshot;
+    $snapshot = {} if not defined $snapshot;
+    $snapshot->{$key} = {
+        version => $global_schema_version{$key},
+        meta    => $global_schema_cache{$key},
+        checked => $global_schema_checked{$key},
+    };
+    # Readers do not lock. So write some other file and rename it.
+    my $snapshot_tmp = $metadata_snapshot . "." . $$;
+    if (not eval { Storable::nstore($snapshot, $snapshot_tmp) } or
+        not rename($snapshot_tmp, $metadata_snapshot)) {
+        say("WARN: Unable to write the metadata snapshot '$metadata_snapshot': $!");
+        unlink($snapshot_tmp);
+    }
+}
+
+sub cacheSchemaMetaData {
+# Refresh the cached schema metadata if required (see cacheMetaData for $redo).
+    my ($self, $redo) = @_;
+
+    my $cache_key = $self->metaDataKey();
+    my $lock_fh = lockMetaData();
+    my $version_before = $global_schema_version{$cache_key};
+    loadMetaDataSnapshot($cache_key);
+
+    my @schemas;              # Empty means all schemas
+    if (not exists $global_schema_cache{$cache_key}) {
+        # Nothing cached, we need all schemas.
+    } elsif (not defined $redo) {
+        @schemas = keys %{$global_schema_dirty{$cache_key} || {}};
+        return STATUS_OK if not @schemas;
+    } elsif (ref $redo eq 'ARRAY') {
+        my $checked = $global_schema_checked{$cache_key} || {};
+        my $dirty   = $global_schema_dirty{$cache_key}   || {};
+        my $now     = time();
+        my %seen;
+        @schemas = grep { not $seen{$_}++ and
+                          ($dirty->{$_} or not defined $checked->{$_} or
+                           $now - $checked->{$_} >= METADATA_RECHECK_INTERVAL) }
+                   (@$redo, keys %$dirty);
+        # Some other process has refreshed these schemas recently.
+        return STATUS_OK if not @schemas;
+    } elsif (defined $global_schema_version{$cache_key} and
+             (not defined $version_before or $global_schema_version{$cache_key} > $version_before)) {
+        # Some other process has refreshed all schemas meanwhile.
+        return STATUS_OK;
+    }
+
+    say("Caching schema metadata for " . $self->dsn() .
+        (@schemas ? " schemas " . join(',', @schemas) : ''));
+
+    my $metadata= $self->getSchemaMetaData(@schemas ? \@schemas : undef);
+    if (not defined $metadata) {
+        # The 'cluck' is because we might offer metadata caching multiple times
+        # in future.
+        my $status = STATUS_CRITICAL_FAILURE;
+        Carp::cluck("ERROR: Failed to cache schema metadata. " .
+                    Basics::return_status_text($status));
+        return $status;
+    }
+
+    # Executors of the current process might still use the old metadata. So do not modify them.
+    my $meta    = {};
+    my $checked = {};
+    my %wanted  = map { $_ => 1 } @schemas;
+    if (@schemas) {
+        $meta    = { %{$global_schema_cache{$cache_key}} };
+        $checked = { %{$global_schema_checked{$cache_key} || {}} };
+        delete @{$meta}{@schemas};
+    }
+    foreach my $row (@$metadata) {
+        my ($schema, $table, $type, $col, $key, $metatype, $realtype, $maxlength, $table_rows) = @$row;
+        next if @schemas and not $wanted{$schema};
+        $table_rows= 0 unless defined $table_rows;
+        $meta->{$schema}={} if not exists $meta->{$schema};
+        $meta->{$schema}->{'bigtable'}={} if not exists $meta->{$schema}->{'bigtable'};
+        $meta->{$schema}->{'bigbasetable'}={} if not exists $meta->{$schema}->{'bigbasetable'};
+        $meta->{$schema}->{'smalltable'}={} if not exists $meta->{$schema}->{'smalltable'};
+        $meta->{$schema}->{'smallbasetable'}={} if not exists $meta->{$schema}->{'bigbasetable'};
+        if ($table_rows < 500) {
+            $meta->{$schema}->{'smalltable'}->{$table} = $table_rows;
+            if ($type eq 'table') {
+                $meta->{$schema}->{'smallbasetable'}->{$table} = $table_rows;
+            }
+        } else {
+            $meta->{$schema}->{'bigtable'}->{$table} = $table_rows;
+            if ($type eq 'table') {
+                $meta->{$schema}->{'bigbasetable'}->{$table} = $table_rows;
+            }
+        }
+        $meta->{$schema}->{$type}={} if not exists $meta->{$schema}->{$type};
+        $meta->{$schema}->{$type}->{$table}={} if not exists $meta->{$schema}->{$type}->{$table};
+        $meta->{$schema}->{$type}->{$table}->{$col}= [$key,$metatype,$realtype,$maxlength];
+    }
+    my $now = time();
+    $checked->{$_} = $now foreach (@schemas ? @schemas : keys %$meta);
+    if (@schemas) {
+        delete @{$global_schema_dirty{$cache_key}}{@schemas} if defined $global_schema_dirty{$cache_key};
+    } else {
+        delete $global_schema_dirty{$cache_key};
+    }
+
+    $global_schema_cache{$cache_key}   = $meta;
+    $global_schema_checked{$cache_key} = $checked;
+    $global_schema_version{$cache_key} = ($global_schema_version{$cache_key} || 0) + 1;
+    storeMetaDataSnapshot($cache_key) if defined $lock_fh;
+
+    return STATUS_OK;
+}
+
+sub observeDDL {
+# Remember the schema changed by the DDL $query. The next refresh of metadata includes it.
+    my ($self, $query) = @_;
+    my $schema;
+    if ($query =~ m{^\s*(?:CREATE|DROP|ALTER)\s+(?:SCHEMA|DATABASE)\s+(?:IF\s+(?:NOT\s+)?EXISTS\s+)?`?(\w+)}io) {
+        $schema = $1;
+    } elsif ($query =~ m{^\s*(?:CREATE|DROP|ALTER|RENAME)\s+(?:\S+\s+)*?(?:TABLE|VIEW|SEQUENCE)\s+(?:IF\s+(?:NOT\s+)?EXISTS\s+)?(?:`?(\w+)`?\.)?}io) {
+        $schema = defined $1 ? $1 : $self->defaultSchema();
+    }
+    $global_schema_dirty{$self->metaDataKey()}->{$schema} = 1 if defined $schema;
+}
+
+sub metaDataDirty {
+# Return 1 if DDL of the current process changed schemas since the last refresh of metadata.
+    my $dirty = $global_schema_dirty{$_[0]->metaDataKey()};
+    return (defined $dirty and %$dirty) ? 1 : 0;
+}
+
+sub metaDataStale {
+# Return 1 if some other process has written more recent metadata to the snapshot file.
+# Costs one stat of the snapshot file as long as it does not change.
+    my ($self) = @_;
+    return 0 if not defined $metadata_snapshot;
+    my @stat = stat($metadata_snapshot);
+    return 0 if not @stat;
+    my $stat = join(':', @stat[0, 1, 9, 7]);
+    return 0 if defined $metadata_snapshot_stat and $metadata_snapshot_stat eq $stat;
+    $metadata_snapshot_stat = $stat;
+    my $cache_key = $self->metaDataKey();
+    loadMetaDataSnapshot($cache_key);
+    return (defined $global_schema_cache{$cache_key} and
+            (not defined $self->[EXECUTOR_SCHEMA_METADATA] or
+             $self->[EXECUTOR_SCHEMA_METADATA] != $global_schema_cache{$cache_key})) ? 1 : 0;
+}
+
+sub refreshSchemaMetaData {
+# Refresh the schemas changed by DDL of the current process and take over what other processes
+# have refreshed meanwhile. Unlike cacheMetaData this runs no SQL beside the metadata query.
+# So it fits for the connection of a worker in the middle of the test.
+    my ($self) = @_;
+    my $status = $self->cacheSchemaMetaData();
+    return $status if $status != STATUS_OK;
+    my $meta = $global_schema_cache{$self->metaDataKey()};
+    if (not defined $self->[EXECUTOR_SCHEMA_METADATA] or
+        $self->[EXECUTOR_SCHEMA_METADATA] != $meta) {
+        $self->[EXECUTOR_SCHEMA_METADATA] = $meta;
+        $self->[EXECUTOR_META_CACHE]      = {};
+    }
+    return STATUS_OK;
+}
+
 sub metaSchemas {
     my ($self) = @_;
     if (not defined $self->[EXECUTOR_META_CACHE]->{SCHEMAS}) {
@@ -512,7 +740,7 @@ sub metaTables {
         unless (scalar(keys %{$meta->{$schema}->{table}}) +
                 scalar(keys %{$meta->{$schema}->{view}})) {
             # Give it another chance, maybe we created data after starting the test
-            $self->cacheMetaData('redo');
+            $self->cacheMetaData([ $schema ]);
             $meta = $self->[EXECUTOR_SCHEMA_METADATA];
         }
         my $tables = [sort (keys %{$meta->{$schema}->{table}}, keys %{$meta->{$schema}->{view}})];
@@ -115,6 +115,12 @@ my @errors = (
 
 my @patterns = map { qr{$_}i } @errors;
 
+# SELECTs which change something when running them. They are always fetched completely because
+# Comparator::materialize runs SELECTs fetched as digest once more for showing a diff.
+my $side_effects_pattern = qr{\b(?:NEXTVAL|LASTVAL|SETVAL|GET_LOCK|RELEASE_LOCK|RELEASE_ALL_LOCKS)\s*\(|
+                              \bNEXT\s+VALUE\s+FOR\b|\bFOR\s+UPDATE\b|\bLOCK\s+IN\s+SHARE\s+MODE\b|
+                              \bINTO\s+(?:@|OUTFILE\b|DUMPFILE\b)|:=}six;
+
 use constant EXECUTOR_MYSQL_AUTOCOMMIT => 20;
 
 #
@@ -1184,8 +1190,208 @@ sub reportError {
 }
 
 
+# Server side prepared statement cache (see EXECUTOR_PS_CACHE)
+# ------------------------------------------------------------
+# The literals of a DML statement get replaced by placeholders. The resulting shape of the
+# statement is prepared once per connection and executed with the literals as bind values.
+# Only integers and strings without backslash get replaced. Everything else stays as is.
+#
+# A string following one of these words is part of the syntax and cannot be a placeholder.
+my %ps_keep_string = map { $_ => 1 } qw(
+    AS B CHARACTER CHARSET COLLATE DATE ESCAPE N PATH SEPARATOR SET TIME TIMESTAMP X);
+# Integers in parentheses following one of these words are a length, precision or scale.
+my %ps_type_word = map { $_ => 1 } qw(
+    BINARY BIT CHAR CHARACTER DATETIME DEC DECIMAL DOUBLE FIXED FLOAT INT INTEGER NCHAR
+    NUMERIC REAL TIME TIMESTAMP VARBINARY VARCHAR);
+# Integers in an ORDER BY or GROUP BY list are column positions. These words end the list.
+my %ps_by_end = map { $_ => 1 } qw(
+    EXCEPT FETCH FOR FROM HAVING INTERSECT INTO LIMIT LOCK OFFSET SELECT UNION WHERE WINDOW);
+# Literals in a select list are part of the column names of the result. These words end the list.
+my %ps_list_end = map { $_ => 1 } qw(
+    EXCEPT FOR FROM GROUP HAVING INTERSECT INTO LIMIT LOCK ORDER UNION WHERE WINDOW);
+# Errors on prepare which mean that the shape can never be prepared.
+my %ps_unsupported = (
+    ER_PARSE_ERROR()    => 1,
+    ER_UNSUPPORTED_PS() => 1,
+);
+
+sub ps_shape {
+# Return the shape of $query and a ref to the list of [ value, SQL type ] to bind
+# or undef if $query has to be sent as text.
+    my ($query) = @_;
+
+    return undef if $query !~ m{^\s*(?:SELECT|INSERT|UPDATE|DELETE|REPLACE)\b}io;
+
+    my $shape = '';
+    my @binds;
+    my $prev_word = '';
+    my $depth = 0;
+    my $type_depth;           # Depth of the open parentheses of a data type
+    my $by_depth;             # Depth of the open ORDER BY or GROUP BY list
+    my @list_depths;          # Depths of the open select lists, 'SELECT 1' has the column '1'
+    my $after_dot = 0;        # The last token was a '.' like in 't1.1' or '1.' so no number
+    pos($query) = 0;
+    while (pos($query) < length($query)) {
+        # Perl checks first if the fixed end like '*/' of a pattern exists somewhere after \G.
+        # Trying these patterns only at a matching start keeps the scan linear.
+        my $lead = substr($query, pos($query), 2);
+        if ($query =~ m{\G(\s+)}gc) {
+            $shape .= $1;
+            next;
+        } elsif ($lead eq '/*' and $query =~ m{\G(/\*[!+M].*?\*/)}sgc) {
+            # Executable comments and optimizer hints
+            $shape .= $1;
+        } elsif ($lead eq '/*' and $query =~ m{\G/\*.*?\*/}sgc) {
+            # Comments like the ' /* E_R ... QNO ... */ ' would make every statement unique.
+            $shape .= ' ';
+            next;
+        } elsif ($query =~ m{\G(?:--\s|#)[^\n]*}gc) {
+            $shape .= ' ';
+            next;
+        } elsif ($lead =~ m{^'} and $query =~ m{\G'((?:[^'\\]|'')*)'}gc) {
+            my $value = $1;
+            if ($ps_keep_string{$prev_word} or $prev_word =~ m{^_} or @list_depths) {
+                $shape .= "'" . $value . "'";
+            } else {
+                $value =~ s{''}{'}g;
+                push @binds, [ $value, DBI::SQL_VARCHAR() ];
+                $shape .= '?';
+            }
+        } elsif ($query =~ m{\G('(?:[^'\\]|''|\\.)*'|"(?:[^"\\]|""|\\.)*"|`(?:[^`]|``)*`)}sgc) {
+            $shape .= $1;
+        } elsif ($query =~ m{\G(\d+(?:\.\d*)?(?:[eE][-+]?\d+)?)(?![\w\$])}gc) {
+            my $number = $1;
+            if ($number =~ m{^\d{1,18}$} and not defined $type_depth and not defined $by_depth
+                and not $after_dot and not @list_depths) {
+                push @binds, [ $number, DBI::SQL_BIGINT() ];
+                $shape .= '?';
+            } else {
+                $shape .= $number;
+            }
+        } elsif ($query =~ m{\G([\w\$]+)}gc) {
+            my $word = $1;
+            $shape .= $word;
+            $word = uc($word);
+            $by_depth = $depth if $word eq 'BY' and $prev_word =~ m{^(?:ORDER|GROUP)$};
+            $by_depth = undef  if defined $by_depth and $depth == $by_depth and
+                                  $ps_by_end{$word};
+            if ($word eq 'SELECT') {
+                push @list_depths, $depth;
+            } elsif (@list_depths and $list_depths[-1] == $depth and $ps_list_end{$word}) {
+                pop @list_depths;
+            }
+            $prev_word = $word;
+            $after_dot = 0;
+            next;
+        } elsif ($query =~ m{\G([;?])}gc) {
+            # Several statements or placeholders already.
+            return undef;
+        } elsif ($query =~ m{\G(.)}sgc) {
+            my $char = $1;
+            if ($char eq '(') {
+                $depth++;
+                $type_depth = $depth if not defined $type_depth and $ps_type_word{$prev_word};
+            } elsif ($char eq ')') {
+                $type_depth = undef if defined $type_depth and $depth == $type_depth;
+                $by_depth   = undef if defined $by_depth   and $depth == $by_depth;
+                pop @list_depths    if @list_depths        and $depth == $list_depths[-1];
+                $depth--;
+            }
+            $shape .= $char;
+        }
+        $prev_word = '';
+        $after_dot = (substr($shape, -1) eq '.');
+    }
+    return ($shape, \@binds);
+}
+
+sub psStatement {
+# Return the server side prepared statement for the shape of $query with the values bound
+# or undef if $query has to be sent as text.
+    my ($executor, $dbh, $query) = @_;
+
+    my ($shape, $binds) = ps_shape($query);
+    return undef if not defined $shape;
+
+    # The cache belongs to the connection. A reconnect starts with an empty one.
+    my $cache = $dbh->{private_rqg_ps_cache};
+    if (not defined $cache) {
+        $cache = { tick => 0, entries => {} };
+        $dbh->{private_rqg_ps_cache} = $cache;
+    }
+    # mysql_use_result gets fixed at prepare.
+    my $key = ($dbh->{mysql_use_result} ? 'U:' : 'S:') . $shape;
+    my $entry = $cache->{entries}->{$key};
+    if (not defined $entry) {
+        my $sth = $dbh->prepare($shape, { mysql_server_prepare => 1 });
+        # Some temporary problem like a missing table. Try again next time.
+        return undef if not defined $sth and not $ps_unsupported{$dbh->err() || 0};
+        my $entries = $cache->{entries};
+        if (scalar(keys %$entries) >= $executor->psCache()) {
+            my ($lru_key) = sort { $entries->{$a}->[1] <=> $entries->{$b}->[1] } keys %$entries;
+            delete $entries->{$lru_key};
+        }
+        # An undef statement handle stands for a shape which cannot be prepared.
+        $entry = [ $sth, 0 ];
+        $entries->{$key} = $entry;
+    }
+    $entry->[1] = ++$cache->{tick};
+    my $sth = $entry->[0];
+    return undef if not defined $sth;
+
+    $sth->finish() if $sth->{Active};
+    foreach my $i (0..$#$binds) {
+        $sth->bind_param($i + 1, $binds->[$i]->[0], $binds->[$i]->[1]);
+    }
+    return $sth;
+}
+
 sub execute {
     my ($executor, $query, $execution_flags) = @_;
+    my $started = $executor->start_execute($query, $execution_flags, 0);
+    return $started if ref($started) ne 'HASH';
+    return $executor->finish_execute($started);
+}
+
+# Asynchronous execution (see GenTest_e::Executor::executeAsync)
+# --------------------------------------------------------------
+# The statement gets sent via the asynchronous API of DBD::mysql. Any use of the connection
+# before reap (dbh) waits for the statement and keeps its result for reap. So the results get
+# processed in the order the statements were sent.
+
+sub executeAsync {
+    my ($executor, $query, $execution_flags) = @_;
+    # Finish whatever is still in flight. Its result would get lost otherwise.
+    $executor->dbh();
+    my $started = $executor->start_execute($query, $execution_flags, 1);
+    $started->{pid} = $$ if ref($started) eq 'HASH';
+    $executor->[GenTest_e::Executor::EXECUTOR_IN_FLIGHT] = $started;
+}
+
+sub reap {
+    my ($executor) = @_;
+    my $started = $executor->[GenTest_e::Executor::EXECUTOR_IN_FLIGHT];
+    $executor->[GenTest_e::Executor::EXECUTOR_IN_FLIGHT] = undef;
+    return $started if ref($started) ne 'HASH';
+    return $executor->finish_execute($started);
+}
+
+sub dbh {
+    my ($executor) = @_;
+    my $started = $executor->[GenTest_e::Executor::EXECUTOR_IN_FLIGHT];
+    # Processes forked meanwhile (generate ahead helper) must not touch the statement.
+    if (ref($started) eq 'HASH' and $started->{pid} == $$) {
+        $executor->[GenTest_e::Executor::EXECUTOR_IN_FLIGHT] = undef;
+        $executor->[GenTest_e::Executor::EXECUTOR_IN_FLIGHT] = $executor->finish_execute($started);
+    }
+    return $executor->[GenTest_e::Executor::EXECUTOR_DBH];
+}
+
+sub start_execute {
+# Do everything up till sending the statement.
+# Return the GenTest_e::Result in case the statement was not sent and otherwise the state
+# required by finish_execute.
+    my ($executor, $query, $execution_flags, $async) = @_;
 
     my $who_am_i = Basics::who_am_i;
     my $status;
@@ -1299,6 +1505,10 @@ sub execute {
    $query = $query . $trace_addition;
 
    $execution_flags = $execution_flags | $executor->flags();
+   my $digest_data = (($execution_flags & EXECUTOR_FLAG_DIGEST_DATA) and
+                      not ($execution_flags & EXECUTOR_FLAG_HASH_DATA) and
+                      $query =~ m{^(?:\s|\(|/\*.*?\*/)*(?:SELECT|WITH)\b}sio and
+                      $query !~ $side_effects_pattern) ? 1 : 0;
 
    # Filter out any /*executor */ comments that do not pertain to this particular Executor/DBI.
    # $executor_id is the number of the server to run against.
@@ -1389,7 +1599,15 @@ sub execute {
     # say("DEBUG: Executor: $trace_addition Before prepare");
     my $start_time = Time::HiRes::time();
     # exp_server_kill($who_am_i, $query);
-    my $sth = $dbh->prepare($query);
+    my $sth;
+    # DBD::mysql does not support server side prepared statements in asynchronous mode.
+    # The result of an asynchronous statement gets always stored.
+    # Result sets folded into a digest get fetched unbuffered.
+    $sth = $executor->psStatement($dbh, $query)
+        if $executor->psCache() and not $async and not $digest_data;
+    $sth = $dbh->prepare($query, ($async       ? { async => 1, mysql_use_result => 0 } :
+                                  $digest_data ? { mysql_use_result => 1 }             : ()))
+        if not defined $sth;
 
     if (not defined $sth) {            # Error on PREPARE
         my $errstr_prepare = $executor->normalizeError($dbh->errstr());
@@ -1410,6 +1628,35 @@ sub execute {
 
     ######## HERE THE QUERY GETS SENT TO THE SERVER ?? ########
     my $affected_rows =  $sth->execute();
+
+    return {
+        query           => $query,
+        execution_flags => $execution_flags,
+        who_am_i        => $who_am_i,
+        executor_role   => $executor_role,
+        dbh             => $dbh,
+        sth             => $sth,
+        trace_addition  => $trace_addition,
+        performance     => $performance,
+        start_time      => $start_time,
+        affected_rows   => $affected_rows,
+        async           => $async,
+        digest_data     => $digest_data,
+    };
+} # End of sub start_execute
+
+sub finish_execute {
+# Wait for the result of the statement sent by start_execute and process it.
+    my ($executor, $started) = @_;
+
+    my ($query, $execution_flags, $who_am_i, $executor_role, $dbh, $sth, $trace_addition,
+        $performance, $start_time) =
+        @{$started}{qw(query execution_flags who_am_i executor_role dbh sth trace_addition
+                       performance start_time)};
+    my $status;
+    my $affected_rows = $started->{affected_rows};
+    # An asynchronous execute returns immediate. It fails only if the statement could not be sent.
+    $affected_rows = $sth->mysql_async_result() if $started->{async} and defined $affected_rows;
     # In case the RQG log contains a
     # DBD::mysql::st execute warning:  at /data/RQG_mleich1/lib/GenTest_e/Executor/MySQL.pm line 1321, <CONF> line 72
     # than we have tried to execute a statement but loast the connection to the server.
@@ -1420,6 +1667,12 @@ sub execute {
 
     my $err =      $sth->err();
     SQLtrace::sqltrace_after_execution($err);
+    # The server has lost the prepared statements of the connection. Prepare them again.
+    delete $dbh->{private_rqg_ps_cache}
+        if defined $err and $err == ER_UNKNOWN_STMT_HANDLER and defined $dbh;
+    # Successful DDL makes the cached metadata of the schema touched outdated.
+    $executor->observeDDL($query)
+        if not defined $err and $query =~ m{^\s*(?:CREATE|DROP|ALTER|RENAME)\s}io;
     my $errstr =   $executor->normalizeError($sth->errstr()) if defined $sth->errstr();
     my $err_type = STATUS_OK;
     if (defined $err) {
@@ -1641,6 +1894,8 @@ sub execute {
         } else {
             my @data;                   #
             my %data_hash;              # Filled if   $execution_flags & EXECUTOR_FLAG_HASH_DATA
+            my $digest;                 # Filled instead of @data if digest_data
+            $digest = GenTest_e::Result::newDigest() if $started->{digest_data};
             my $row_count = 0;
             my $result_status = STATUS_OK;
 
@@ -1650,6 +1905,8 @@ sub execute {
                 $row_count++;
                 if ($execution_flags & EXECUTOR_FLAG_HASH_DATA) {
                     $data_hash{substr(Digest::MD5::md5_hex(@row), 0, 3)}++;
+                } elsif (defined $digest) {
+                    GenTest_e::Result::addToDigest($digest, \@row);
                 } else {
                     push @data, \@row;
                 }
@@ -1662,10 +1919,12 @@ sub execute {
             if (defined $sth->err()) {
                 $result_status = $err2type{$sth->err()};
                 @data = ();
+                $digest = undef;
             } elsif ($row_count > MAX_ROWS_THRESHOLD and
                      $executor->task() == GenTest_e::Executor::EXECUTOR_TASK_THREAD) {
                 my $query_for_print= shorten_message($query);
                 @data = ();
+                $digest = undef;
                 say("Query: $query_for_print returned more than MAX_ROWS_THRESHOLD (" .
                     MAX_ROWS_THRESHOLD() . ") rows. Will kill it ...");
                 $executor->[EXECUTOR_RETURNED_ROW_COUNTS]->{'>MAX_ROWS_THRESHOLD'}++;
@@ -1870,7 +2129,8 @@ sub execute {
                 query           => $query,
                 status          => $result_status,
                 affected_rows   => $affected_rows,
-                data            => \@data,
+                data            => (defined $digest ? undef : \@data),
+                digest          => $digest,
                 start_time      => $start_time,
                 end_time        => $end_time,
                 column_names    => $column_names,
@@ -1955,7 +2215,7 @@ sub execute {
 
     return $result;
 
-} # End of sub execute
+} # End of sub finish_execute
 
 sub version {
     my $executor = shift;
@@ -2289,11 +2549,12 @@ sub getSchemaMetaData {
    ## or undef if hitting an error.
    ## SCHEMAs without tables and also the maybe existing SCHEMA 'rqg' get ignored.
    ## Hence "_database" will never return their name.
+   ## In case $schemas (ref to array) is defined than only the rows for these schemas.
 
     # The caller has to take care that the executor task is set to EXECUTOR_TASK_CACHER.
     # Otherwise we might run come into trouble because of too small max_statement_timeout.
 
-    my ($self) = @_; # $self is an executor.
+    my ($self, $schemas) = @_; # $self is an executor.
 
     my $dbh = $self->dbh;
     # Check if its undef
@@ -2343,7 +2604,10 @@ sub getSchemaMetaData {
              "information_schema.columns USING(table_schema,table_name) LEFT JOIN ".
              "information_schema.statistics USING(table_schema,table_name,column_name) ".
 
-        "WHERE table_schema <> 'rqg' AND table_name <> 'DUMMY'" . $trace_addition ;
+        "WHERE table_schema <> 'rqg' AND table_name <> 'DUMMY'" .
+        (defined $schemas ?
+         " AND table_schema IN (" . join(',', map { $dbh->quote($_) } @$schemas) . ")" : '') .
+        $trace_addition ;
 
    SQLtrace::sqltrace_before_execution($query);
 
@@ -42,6 +42,12 @@ require Exporter;
    GENERATOR_PARTICIPATING_RULES
    GENERATOR_ANNOTATE_RULES
    GENERATOR_RECONNECT
+   GENERATOR_COVERAGE
+   GENERATOR_ADAPTIVE
+   GENERATOR_ADAPTIVE_TRACE
+   GENERATOR_ADAPTIVE_REPLAY
+   GENERATOR_AHEAD
+   GENERATOR_COVERAGE_MAP
 );
 
 use strict;
@@ -62,6 +68,12 @@ use constant GENERATOR_GLOBAL_FRAME        => 12;
 use constant GENERATOR_PARTICIPATING_RULES => 13;       # Stores the list of rules used in the last generated query
 use constant GENERATOR_ANNOTATE_RULES      => 14;
 use constant GENERATOR_RECONNECT           => 15;       # For FromGrammar
+use constant GENERATOR_COVERAGE            => 16;       # rule -> component id -> outcome -> count
+use constant GENERATOR_ADAPTIVE            => 17;       # State of the adaptive weighting
+use constant GENERATOR_ADAPTIVE_TRACE      => 18;       # Directory for writing the weight traces
+use constant GENERATOR_ADAPTIVE_REPLAY     => 19;       # Directory with weight traces to replay
+use constant GENERATOR_AHEAD               => 20;       # State of generating query batches ahead
+use constant GENERATOR_COVERAGE_MAP        => 21;       # rule -> masked component id -> component id
 
 sub new {
    my $class = shift;
@@ -75,7 +87,12 @@ sub new {
       'mask'              => GENERATOR_MASK,
       'mask_level'        => GENERATOR_MASK_LEVEL,
       'varchar_length'    => GENERATOR_VARCHAR_LENGTH,
-      'annotate_rules'    => GENERATOR_ANNOTATE_RULES
+      'annotate_rules'    => GENERATOR_ANNOTATE_RULES,
+      'coverage'          => GENERATOR_COVERAGE,
+      'adaptive_weights'  => GENERATOR_ADAPTIVE,
+      'adaptive_trace'    => GENERATOR_ADAPTIVE_TRACE,
+      'adaptive_replay'   => GENERATOR_ADAPTIVE_REPLAY,
+      'generate_ahead'    => GENERATOR_AHEAD
    }, @_);
 
    return $generator;
@@ -117,9 +134,24 @@ sub maskedGrammar {
    return $_[0]->[GENERATOR_MASKED_GRAMMAR];
 }
 
+sub coverage {
+   return $_[0]->[GENERATOR_COVERAGE];
+}
+
+# 1 if the generator wants the outcome of executing the query via registerOutcome.
+sub wantsOutcome {
+   return (defined $_[0]->[GENERATOR_COVERAGE] or defined $_[0]->[GENERATOR_ADAPTIVE]);
+}
+
 sub setSeed {
+   # $_[2] is the optional number of the PRNG stream (see GenTest_e::Random::setSeed).
    $_[0]->[GENERATOR_SEED] = $_[1];
-   $_[0]->[GENERATOR_PRNG]->setSeed($_[1]) if defined $_[0]->[GENERATOR_PRNG];
+   if (defined $_[0]->[GENERATOR_PRNG]) {
+      $_[0]->[GENERATOR_PRNG]->setSeed($_[1], $_[2]);
+      $_[0]->[GENERATOR_SEED] = $_[0]->[GENERATOR_PRNG]->seed();
+   } elsif (defined $_[2]) {
+      $_[0]->[GENERATOR_SEED] += $_[2];
+   }
 }
 
 sub setThreadId {
@@ -142,4 +174,9 @@ sub setReconnect {
    $_[0]->[GENERATOR_RECONNECT] = $_[1];
 }
 
+sub metaDataChanged {
+   # To be called after the metadata of the executors got refreshed.
+   # Generators caching something derived from the metadata have to drop it.
+}
+
 1;
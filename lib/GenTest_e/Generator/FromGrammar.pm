@@ -34,14 +34,182 @@ use GenTest_e;
 use Cwd;
 use List::Util qw(shuffle); # For some grammars
 use Time::HiRes qw(time);
+use POSIX ();
+use Storable ();
 
 use constant GENERATOR_MAX_OCCURRENCES  => 3500;
-use constant GENERATOR_MAX_LENGTH       => 10000;
+# Limits for the tokens (generated + not yet processed) and bytes of a query.
+use constant GENERATOR_MAX_TOKENS       => 100000;
+use constant GENERATOR_MAX_BYTES        => 67108864;
+
+# Adaptive weighting (see adaptWeights)
+use constant ADAPTIVE_WASTED_DEFAULT => 'STATUS_SEMANTIC_ERROR,1062,1205';
+use constant ADAPTIVE_ALPHA          => 0.05;
+use constant ADAPTIVE_FLOOR          => 0.1;
+use constant ADAPTIVE_SCALE          => 10;
+use constant ADAPTIVE_INTERVAL       => 100;
+use constant ADAPTIVE_TRACE_PREFIX   => 'adaptive_weights.';
+
+# Generate ahead (see nextAhead)
+use constant AHEAD_BARRIER           => "Generate ahead barrier\n";
+use constant AHEAD_BARRIER_ITEMS     => '_connection_id _current_user _pid _tmpfile _tmpnam _tmptable';
+# Package variables which 'next' sets on every call or which are no state of the generation.
+use constant AHEAD_LOCAL_GLOBALS     => 'AUTOLOAD BEGIN EXPORT EXPORT_OK EXPORT_TAGS ISA VERSION ' .
+                                        'executors generator global grammar_rules invariants ' .
+                                        'last_database last_field last_table prng record_picks ' .
+                                        'stack who_am_i';
 
 my $field_pos;
+# 1 within the process generating query batches ahead for some worker.
+my $in_helper = 0;
+# The database handles of the executors the helper must keep but must not use.
+my @detached_handles;
 my $rqg_home = $ENV{'RQG_HOME'};
 my $cwd      = cwd();
 
+# Perl snippets of the grammar ('{ ... }' and '$variable') compiled into anonymous subs.
+# snippet -> [ code ref or undef, compile error or '' ]
+my %compiled_code;
+
+sub compile_code {
+# Compile some Perl snippet of the grammar once per process and return [ code ref, error ].
+# The snippet gets compiled here at file level and not within 'next'. So it sees the package
+# variables $generator, $executors, $prng, $last_table, %invariants, $stack ... set by 'next'.
+# The "no strict" is because grammars could fiddle with undef perl variables.
+# No lexical variables get declared here because the snippets would see them.
+    return $compiled_code{$_[0]} if exists $compiled_code{$_[0]};
+    if (substr($_[0], 0, 1) eq '{') {
+        $compiled_code{$_[0]} = [ eval("no strict;\nsub " . $_[0]) ];
+    } else {
+        $compiled_code{$_[0]} = [ eval("no strict;\nsub {" . $_[0] . ";\n}") ];
+    }
+    $compiled_code{$_[0]}->[1] = $@;
+    return $compiled_code{$_[0]};
+}
+
+sub is_code {
+    my ($item) = @_;
+    return ((substr($item, 0, 1) eq '{' and substr($item, -1, 1) eq '}') or
+            substr($item, 0, 1) eq '$');
+}
+
+# Buffers of the expansion engine (sub expand within next). Reused for every query.
+my @token_buffer;       # The tokens of the query generated so far.
+my @live_positions;     # Indexes of the tokens in @token_buffer which could change if processed again.
+my @frame_parts;        # Per frame: Reference to the parts of the rule component to be expanded.
+my @frame_pos;          # Per frame: Index of the next part to be processed.
+my @frame_queue;        # Per frame: undef or reference to tokens to be processed before the next part.
+my @frame_start;        # Per frame: Begin of the output of the frame within @token_buffer.
+my @frame_rescan;       # Per frame: Begin of the output which the parent frame has to process again.
+my @frame_invariant;    # Per frame: Rule name if the output has to be stored as invariant.
+my $pending_tokens;     # Number of parts and queued tokens of all frames not yet processed.
+my $buffer_bytes;       # Length of the tokens in @token_buffer.
+
+# Rule coverage: Pairs of rule name and component id picked for generating the last query.
+# They get charged with the outcome of the execution via registerOutcome.
+my @picks;
+
+sub is_live {
+# Return 1 if processing the token again by expand could change it or consume random numbers.
+# Some 1 for a token which would stay unchanged costs only CPU.
+    my ($token, $grammar_rules) = @_;
+    return 0 if not defined $token or $token eq ' ' or $token eq uc($token);
+    my $first = substr($token, 0, 1);
+    return 1 if $first eq '_' or $first eq '{' or $first eq '$';
+    return 1 if $token =~ m{^[a-z0-9_]+\[invariant\]}sio;
+    return 1 if exists $grammar_rules->{$token};
+    return 0;
+}
+
+sub push_tokens {
+# Append tokens to the query and check the limits.
+# Return undef or some text describing the limit exceeded.
+    my ($grammar_rules, @tokens) = @_;
+    foreach my $token (@tokens) {
+        push @live_positions, scalar @token_buffer if is_live($token, $grammar_rules);
+        push @token_buffer, $token;
+        $buffer_bytes += length($token) if defined $token;
+    }
+    if (scalar(@token_buffer) + $pending_tokens > GENERATOR_MAX_TOKENS) {
+        return "The query has now more than " . GENERATOR_MAX_TOKENS . " tokens.";
+    }
+    if ($buffer_bytes > GENERATOR_MAX_BYTES) {
+        return "The query has now more than " . GENERATOR_MAX_BYTES . " bytes.";
+    }
+    return undef;
+}
+
+sub cut_tokens {
+# Remove the tokens from position $from on and return them.
+    my ($from) = @_;
+    pop @live_positions while @live_positions and $live_positions[-1] >= $from;
+    my @tokens = splice(@token_buffer, $from);
+    foreach my $token (@tokens) {
+        $buffer_bytes -= length($token) if defined $token;
+    }
+    return @tokens;
+}
+
+sub requeue_tokens {
+# The former recursive implementation processed all tokens of some expansion except the first
+# one again within the parent level. Only live tokens can change. So move the tokens from the
+# first live one on into the queue of the top frame.
+    my ($from) = @_;
+    return if 0 == scalar @live_positions or $live_positions[-1] < $from;
+    my $first = $#live_positions;
+    $first-- while $first > 0 and $live_positions[$first - 1] >= $from;
+    my @tokens = cut_tokens($live_positions[$first]);
+    $frame_queue[-1] = [] if not defined $frame_queue[-1];
+    unshift @{$frame_queue[-1]}, @tokens;
+    $pending_tokens += scalar @tokens;
+}
+
+sub push_frame {
+    my ($parts, $start, $rescan, $invariant_rule) = @_;
+    push @frame_parts,     $parts;
+    push @frame_pos,       0;
+    push @frame_queue,     undef;
+    push @frame_start,     $start;
+    push @frame_rescan,    $rescan;
+    push @frame_invariant, $invariant_rule;
+    $pending_tokens += scalar @$parts;
+}
+
+sub pop_frame {
+    pop @frame_parts;
+    pop @frame_pos;
+    pop @frame_queue;
+    pop @frame_start;
+    pop @frame_rescan;
+    pop @frame_invariant;
+}
+
+sub drop_frame {
+# Throw the output and the parts not yet processed of the top frame away.
+    my ($rule_invariants) = @_;
+    cut_tokens($frame_start[-1]);
+    $pending_tokens -= scalar(@{$frame_parts[-1]}) - $frame_pos[-1];
+    $pending_tokens -= scalar(@{$frame_queue[-1]}) if defined $frame_queue[-1];
+    my $invariant_rule = $frame_invariant[-1];
+    @{$rule_invariants->{$invariant_rule}} = () if defined $invariant_rule;
+    pop_frame();
+}
+
+sub abort_expansion {
+# Throw the query away and free the memory.
+    undef @token_buffer;
+    undef @live_positions;
+    undef @frame_parts;
+    undef @frame_pos;
+    undef @frame_queue;
+    undef @frame_start;
+    undef @frame_rescan;
+    undef @frame_invariant;
+    $pending_tokens = 0;
+    $buffer_bytes   = 0;
+    return \@token_buffer;
+}
+
 sub new {
     my $class     = shift;
     my $generator = $class->SUPER::new(@_);
@@ -76,6 +244,65 @@ sub new {
                                          "query");
         my $maskedTop                          = $top->mask($generator->mask());
         $generator->[GENERATOR_MASKED_GRAMMAR] = $grammar->patch($maskedTop);
+        # Masking drops components of rules. merge_coverage adds up the counters of threads with
+        # different masks and maps them onto the rules of the grammar file. So count per id of
+        # the component in the unmasked rule.
+        if ($generator->[GENERATOR_COVERAGE]) {
+            my $unmasked_rules = $top->rules();
+            my $masked_rules   = $maskedTop->rules();
+            my %coverage_map;
+            foreach my $rule_name (keys %$masked_rules) {
+                next if not exists $unmasked_rules->{$rule_name};
+                # Components with the same text are indistinguishable in the report anyway.
+                my %unmasked_ids;
+                my $components = $unmasked_rules->{$rule_name}->components();
+                foreach my $id (0..$#$components) {
+                    push @{$unmasked_ids{join("\n", @{$components->[$id]})}}, $id;
+                }
+                $coverage_map{$rule_name} = [ map { shift @{$unmasked_ids{join("\n", @$_)}} }
+                                              @{$masked_rules->{$rule_name}->components()} ];
+            }
+            $generator->[GENERATOR_COVERAGE_MAP] = \%coverage_map;
+        }
+    }
+
+    # Compile the Perl snippets now instead of per expansion.
+    # Compile errors get reported when the snippet gets expanded.
+    my $rules = $generator->grammar()->rules();
+    foreach my $rule_name (keys %$rules) {
+        foreach my $component (@{$rules->{$rule_name}->components()}) {
+            foreach my $part (@$component) {
+                compile_code($part) if is_code($part);
+            }
+        }
+    }
+    # The argument 'coverage' is only a switch.
+    $generator->[GENERATOR_COVERAGE] = ($generator->[GENERATOR_COVERAGE] ? {} : undef);
+
+    # The argument 'adaptive_weights' is the comma separated list of outcomes (status names) and
+    # error numbers which count as wasted. '' means ADAPTIVE_WASTED_DEFAULT.
+    if (defined $generator->[GENERATOR_ADAPTIVE]) {
+        my $wasted_list = $generator->[GENERATOR_ADAPTIVE];
+        $wasted_list    = ADAPTIVE_WASTED_DEFAULT if $wasted_list eq '';
+        my %wasted;
+        map { $wasted{$_} = 1 } split(/,/, $wasted_list);
+        $generator->[GENERATOR_ADAPTIVE] = {
+            wasted  => \%wasted,
+            rate    => {},      # rule -> component id -> exponential moving average of wasted
+            base    => {},      # rule -> original weights
+            touched => {},      # rules with outcomes registered since the last adaption
+            replay  => undef,   # [ seq id, rule, weights ] of the trace to replay
+        };
+    }
+
+    # The argument 'generate_ahead' is the number of query batches to generate in advance.
+    $generator->[GENERATOR_AHEAD] = ($generator->[GENERATOR_AHEAD] ?
+                                     { depth => $generator->[GENERATOR_AHEAD] } : undef);
+
+    # Same for the alias tables of rules with weighted components.
+    foreach my $grammar ($generator->grammar(), $generator->[GENERATOR_MASKED_GRAMMAR]) {
+        next if not defined $grammar;
+        map { $_->alias_table() } values %{$grammar->rules()};
     }
 
     return $generator;
@@ -92,6 +319,207 @@ sub participatingRules {
    return $_[0]->[GENERATOR_PARTICIPATING_RULES];
 }
 
+# Rule coverage
+# -------------
+# Enabled via the argument 'coverage' (rqg.pl --rule_coverage).
+# Count per rule and component how often it was picked for some query and what the outcome of
+# executing that query was. The outcome is decided by GenTest_e::Mixer::next.
+# - 'ok'           -- all statements of the query passed
+# - 'crash'        -- the server crashed or was killed
+# - <status name>  -- like STATUS_SEMANTIC_ERROR, the worst status of the statements
+# - 'not_executed' -- the query was empty or got filtered away
+# The workers write the counters into <workdir>/rule_coverage.<thread> and rqg.pl merges them
+# via merge_coverage into <workdir>/rule_coverage.txt.
+
+use constant COVERAGE_FILE_PREFIX => 'rule_coverage.';
+use constant COVERAGE_RAW_FILE    => 'rule_coverage.raw';
+use constant COVERAGE_REPORT_FILE => 'rule_coverage.txt';
+
+sub registerOutcome {
+    my ($generator, $outcome, $err) = @_;
+    my $coverage = $generator->[GENERATOR_COVERAGE];
+    if (defined $coverage) {
+        my $coverage_map = $generator->[GENERATOR_COVERAGE_MAP];
+        for (my $i = 0; $i < $#picks; $i += 2) {
+            my $id = $picks[$i + 1];
+            $id    = $coverage_map->{$picks[$i]}->[$id]
+                if defined $coverage_map and exists $coverage_map->{$picks[$i]};
+            $coverage->{$picks[$i]}->[$id]->{$outcome}++ if defined $id;
+        }
+    }
+    my $adaptive = $generator->[GENERATOR_ADAPTIVE];
+    if (defined $adaptive and not defined $adaptive->{replay}) {
+        my $wasted = ((exists $adaptive->{wasted}->{$outcome}) or
+                      (defined $err and exists $adaptive->{wasted}->{$err})) ? 1 : 0;
+        for (my $i = 0; $i < $#picks; $i += 2) {
+            my $rate = \$adaptive->{rate}->{$picks[$i]}->[$picks[$i + 1]];
+            $$rate   = (defined $$rate ? $$rate : 0) * (1 - ADAPTIVE_ALPHA) +
+                       ADAPTIVE_ALPHA * $wasted;
+            $adaptive->{touched}->{$picks[$i]} = 1;
+        }
+    }
+    $#picks = -1;
+}
+
+# Adaptive weighting
+# ------------------
+# Enabled via the argument 'adaptive_weights' (rqg.pl --adaptive_weights).
+# Components whose queries fail mostly with some "wasted" outcome (like STATUS_SEMANTIC_ERROR
+# or the error 1205 lock wait timeout) get picked less often.
+# - Per component the exponential moving average of "query was wasted" gets maintained.
+# - Every ADAPTIVE_INTERVAL queries the weights of the rules affected get recomputed
+#   weight = original weight * ADAPTIVE_SCALE * max(ADAPTIVE_FLOOR, 1 - average)
+#   So no component gets starved.
+# - The outcomes depend on the server and are not reproducible. Hence every change of weights
+#   gets appended to <adaptive_trace>/adaptive_weights.<thread> as
+#   "<number of queries generated> <rule> <weight>,<weight>,...".
+#   The same seed plus rqg.pl --adaptive_weights_replay=<directory with the traces> generates
+#   the same queries again.
+
+sub adaptWeights {
+# To be called by 'next' before generating the next query.
+    my ($generator, $grammar_rules) = @_;
+    my $adaptive = $generator->[GENERATOR_ADAPTIVE];
+    my $seq_id   = $generator->[GENERATOR_SEQ_ID];
+
+    if (defined $generator->[GENERATOR_ADAPTIVE_REPLAY] and not defined $adaptive->{replay}) {
+        $adaptive->{replay} = [];
+        my $file = $generator->[GENERATOR_ADAPTIVE_REPLAY] . "/" . ADAPTIVE_TRACE_PREFIX .
+                   $generator->threadId();
+        if (open(TRACE, '<', $file)) {
+            while (my $line = <TRACE>) {
+                push @{$adaptive->{replay}}, [ $1, $2, [ split(/,/, $3) ] ]
+                    if $line =~ m{^([0-9]+) (\S+) ([0-9,]+)$};
+            }
+            close(TRACE);
+        } else {
+            say("WARN: GenTest_e::Generator::FromGrammar::adaptWeights: Open '$file' failed : " .
+                "$!. Will go on with the original weights.");
+        }
+    }
+    if (defined $adaptive->{replay}) {
+        while (@{$adaptive->{replay}} and $adaptive->{replay}->[0]->[0] <= $seq_id) {
+            my ($trace_seq_id, $rule_name, $weights) = @{shift @{$adaptive->{replay}}};
+            $grammar_rules->{$rule_name}->setWeights($weights)
+                if exists $grammar_rules->{$rule_name} and $trace_seq_id == $seq_id;
+        }
+        return;
+    }
+
+    return if 0 == $seq_id or 0 != $seq_id % ADAPTIVE_INTERVAL;
+    my $trace = '';
+    foreach my $rule_name (sort keys %{$adaptive->{touched}}) {
+        my $rule       = $grammar_rules->{$rule_name};
+        my $components = $rule->components();
+        next if 2 > scalar @$components;
+        $adaptive->{base}->{$rule_name} = [ map { $rule->weight($_) } (0..$#$components) ]
+            if not exists $adaptive->{base}->{$rule_name};
+        my $base  = $adaptive->{base}->{$rule_name};
+        my $rates = $adaptive->{rate}->{$rule_name};
+        my @weights;
+        foreach my $id (0..$#$components) {
+            my $factor = 1 - (defined $rates->[$id] ? $rates->[$id] : 0);
+            $factor    = ADAPTIVE_FLOOR if $factor < ADAPTIVE_FLOOR;
+            push @weights, int($base->[$id] * ADAPTIVE_SCALE * $factor + 0.5);
+        }
+        my $old_weights = $rule->weights();
+        next if defined $old_weights and join(',', @$old_weights) eq join(',', @weights);
+        $rule->setWeights(\@weights);
+        $trace .= "$seq_id $rule_name " . join(',', @weights) . "\n";
+    }
+    $adaptive->{touched} = {};
+    if ('' ne $trace and defined $generator->[GENERATOR_ADAPTIVE_TRACE]) {
+        my $file = $generator->[GENERATOR_ADAPTIVE_TRACE] . "/" . ADAPTIVE_TRACE_PREFIX .
+                   $generator->threadId();
+        if (-f $file) {
+            Basics::append_string_to_file($file, $trace);
+        } else {
+            chomp $trace;
+            Basics::make_file($file, $trace);
+        }
+    }
+}
+
+sub writeCoverage {
+# Write the counters as lines "<rule> <component id> <outcome> <count>".
+    my ($generator, $file) = @_;
+    my $coverage = $generator->[GENERATOR_COVERAGE];
+    return STATUS_OK if not defined $coverage;
+    my $content = '';
+    foreach my $rule_name (sort keys %$coverage) {
+        my $components = $coverage->{$rule_name};
+        foreach my $id (0..$#$components) {
+            next if not defined $components->[$id];
+            foreach my $outcome (sort keys %{$components->[$id]}) {
+                $content .= "$rule_name $id $outcome " . $components->[$id]->{$outcome} . "\n";
+            }
+        }
+    }
+    return Basics::make_file($file, $content);
+}
+
+sub merge_coverage {
+# Sum up the coverage files of the workers and the counters of previous GenTest rounds and
+# write the report.
+# Return STATUS_OK or STATUS_ENVIRONMENT_FAILURE.
+    my ($workdir, $grammar_file) = @_;
+    my $who_am_i = Basics::who_am_i();
+
+    my %counters;
+    my %outcomes;
+    my @files = glob($workdir . "/" . COVERAGE_FILE_PREFIX . "*");
+    foreach my $file (@files) {
+        next if $file !~ m{\.([0-9]+|raw)$};
+        if (not open(COVERAGE, '<', $file)) {
+            say("ERROR: $who_am_i Open '$file' failed : $!");
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+        while (my $line = <COVERAGE>) {
+            next if $line !~ m{^(\S+) ([0-9]+) (\S+) ([0-9]+)$};
+            $counters{$1}{$2}{$3} += $4;
+            $outcomes{$3} = 1;
+        }
+        close(COVERAGE);
+    }
+    return STATUS_OK if 0 == scalar keys %counters;
+
+    my $grammar = GenTest_e::Grammar->new(grammar_files => [ $grammar_file ]);
+    my @outcome_list = ('ok', grep { $_ ne 'ok' } sort keys %outcomes);
+    my $raw    = '';
+    my $report = "# Picks of rule components and the outcome of executing the queries.\n" .
+                 "# rule component_id picks " . join(" ", @outcome_list) . " component\n";
+    foreach my $rule_name (sort keys %counters) {
+        foreach my $id (sort { $a <=> $b } keys %{$counters{$rule_name}}) {
+            my $entry = $counters{$rule_name}{$id};
+            my $picks = 0;
+            foreach my $outcome (sort keys %$entry) {
+                $raw   .= "$rule_name $id $outcome $entry->{$outcome}\n";
+                $picks += $entry->{$outcome};
+            }
+            my $text = '';
+            if (defined $grammar and defined $grammar->rule($rule_name) and
+                defined $grammar->rule($rule_name)->components()->[$id]) {
+                $text = join('', @{$grammar->rule($rule_name)->components()->[$id]});
+                $text =~ s{\s+}{ }g;
+                $text = substr($text, 0, 60);
+            }
+            $report .= "$rule_name $id $picks " .
+                       join(" ", map { defined $entry->{$_} ? $entry->{$_} : 0 } @outcome_list) .
+                       " ->$text<-\n";
+        }
+    }
+    # The next GenTest round will add its counters to the raw file.
+    if (STATUS_OK != Basics::make_file($workdir . "/" . COVERAGE_RAW_FILE, $raw) or
+        STATUS_OK != Basics::make_file($workdir . "/" . COVERAGE_REPORT_FILE, $report)) {
+        say("ERROR: $who_am_i Writing the rule coverage files failed.");
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    unlink(grep { m{\.[0-9]+$} } @files);
+    say("INFO: $who_am_i Rule coverage written to '" . $workdir . "/" . COVERAGE_REPORT_FILE .
+        "'.");
+    return STATUS_OK;
+}
+
 #
 # Generate a new query. We do this by iterating over the array containing grammar rules and expanding each grammar rule
 # to one of its right-side components . We do that in-place in the array.
@@ -99,6 +527,350 @@ sub participatingRules {
 # Finally, we walk along the array and replace all lowercase keywords with literals and such.
 #
 
+# Generate ahead
+# --------------
+# Enabled via the argument 'generate_ahead' (rqg.pl --generate_ahead=<n>).
+# A helper process forked by the worker generates up to <n> query batches in advance while the
+# worker executes the current one. The helper works on its copy of the generator and of the
+# executors. The database handles of these executors get replaced by some object which fails
+# on any use.
+# Pipes
+# - helper -> worker : Records [ 'B', seq, generation, queries, participating rules, picks ]
+#                      or [ 'X', seq, generation ] if the helper hit a barrier
+#                      or [ 'S', seq, generation, state ] as answer to 'S'
+# - worker -> helper : Lines "<message> <seq of the last batch consumed>\n" with the message
+#                      'N' -- one batch consumed, generate another one
+#                      'R' -- reconnect, throw the batches queued away and start with *_connect
+#                      'S' -- send the state of the generator after the last batch consumed
+#                             and exit
+# The helper keeps per batch not yet consumed a snapshot of the PRNG, sequence id, field
+# position and global frame. So it can go back to the state after the last batch consumed like
+# the worker would be without helper. The package variables the Perl snippets of the grammar
+# could modify are not part of the snapshots. They get sent like they are.
+# Barriers
+# Expansions depending on the state of the worker (connection, pid, temporary files) or on the
+# outcome of previous queries cannot run in the helper.
+# - Grammars containing AHEAD_BARRIER_ITEMS or snippets using $executors or $$ and the adaptive
+#   weighting get generated by the worker without helper.
+# - Anything else (use of the database, eval errors, state which cannot be sent) stops the
+#   helper. The worker takes over the state after the last batch consumed and goes on without
+#   helper.
+# - The helper generates from the metadata of the executors at the time of the fork. The
+#   worker has to call metaDataChanged after refreshing the metadata. This stops the helper in
+#   the same way and the next batch gets generated by a new helper.
+
+sub aheadBarrier {
+# Return undef or some text describing why the worker has to generate the queries itself.
+    my ($generator) = @_;
+    return "adaptive weights are used" if defined $generator->[GENERATOR_ADAPTIVE];
+    my %barrier_items;
+    map { $barrier_items{$_} = 1 } split(/ /, AHEAD_BARRIER_ITEMS);
+    my $grammar = $generator->[GENERATOR_MASKED_GRAMMAR];
+    $grammar    = $generator->[GENERATOR_GRAMMAR] if not defined $grammar;
+    my $rules   = $grammar->rules();
+    foreach my $rule_name (sort keys %$rules) {
+        foreach my $component (@{$rules->{$rule_name}->components()}) {
+            foreach my $part (@$component) {
+                my $item = $part;
+                $item    = $1 if $item =~ m{^([a-z0-9_]+)\[invariant\]}sio;
+                return "the rule '$rule_name' contains '$part'"
+                    if exists $barrier_items{$item} or
+                       (is_code($part) and $part =~ m{\$executors?\b|\$\$}s);
+            }
+        }
+    }
+    return undef;
+}
+
+sub write_record {
+# Return 1 on success and 0 otherwise.
+    my ($fh, $record) = @_;
+    # Storable refuses code references, file handles and similar.
+    my $frozen = eval { Storable::nfreeze($record) };
+    return 0 if not defined $frozen;
+    my $data   = pack('N', length($frozen)) . $frozen;
+    while (length $data) {
+        my $written = syswrite($fh, $data);
+        if (not defined $written) {
+            next if $!{EINTR};
+            return 0;
+        }
+        substr($data, 0, $written) = '';
+    }
+    return 1;
+}
+
+sub read_bytes {
+    my ($fh, $length) = @_;
+    my $data = '';
+    while (length($data) < $length) {
+        my $got = sysread($fh, $data, $length - length($data), length($data));
+        next if not defined $got and $!{EINTR};
+        return undef if not $got;
+    }
+    return $data;
+}
+
+sub read_record {
+# Return the record or undef if the helper is gone.
+    my ($fh) = @_;
+    my $header = read_bytes($fh, 4);
+    return undef if not defined $header;
+    my $frozen = read_bytes($fh, unpack('N', $header));
+    return undef if not defined $frozen;
+    return eval { Storable::thaw($frozen) };
+}
+
+sub send_message {
+# A helper already gone gets noticed when reading the next record.
+    my ($ahead, $message) = @_;
+    local $SIG{PIPE} = 'IGNORE';
+    syswrite($ahead->{writer}, $message . " " . $ahead->{consumed} . "\n");
+}
+
+sub ahead_snapshot {
+# Return a copy of the state of the generator which is cheap enough for taking it per batch.
+    my ($generator) = @_;
+    my $frame = $generator->[GENERATOR_GLOBAL_FRAME];
+    return {
+        prng         => [ map { ref($_) eq 'ARRAY' ? [ @$_ ] : $_ } @{$generator->[GENERATOR_PRNG]} ],
+        seq_id       => $generator->[GENERATOR_SEQ_ID],
+        reconnect    => $generator->[GENERATOR_RECONNECT],
+        global_frame => (defined $frame ? bless({ %$frame }, ref($frame)) : undef),
+        field_pos    => $field_pos,
+    };
+}
+
+sub restore_snapshot {
+    my ($generator, $snapshot) = @_;
+    # $prng of the grammar snippets and the generator have to stay the same object.
+    # The snapshot could be needed again. So copy it.
+    @{$generator->[GENERATOR_PRNG]}      = map { ref($_) eq 'ARRAY' ? [ @$_ ] : $_ }
+                                           @{$snapshot->{prng}};
+    $generator->[GENERATOR_SEQ_ID]       = $snapshot->{seq_id};
+    $generator->[GENERATOR_RECONNECT]    = $snapshot->{reconnect};
+    my $frame = $snapshot->{global_frame};
+    $generator->[GENERATOR_GLOBAL_FRAME] = (defined $frame ? bless({ %$frame }, ref($frame)) :
+                                                             undef);
+    $field_pos                           = $snapshot->{field_pos};
+}
+
+sub ahead_state {
+# Return the state of the generator which 'next' carries from one batch to the next.
+# This covers the package variables the Perl snippets of the grammar could use as well.
+    my ($generator) = @_;
+    my %local_globals;
+    map { $local_globals{$_} = 1 } split(/ /, AHEAD_LOCAL_GLOBALS);
+    my %globals;
+    foreach my $name (keys %GenTest_e::Generator::FromGrammar::) {
+        next if exists $local_globals{$name} or $name =~ m{::$};
+        my $glob = $GenTest_e::Generator::FromGrammar::{$name};
+        next if ref(\$glob) ne 'GLOB';
+        $globals{$name} = [ ${*{$glob}{SCALAR}}, *{$glob}{ARRAY}, *{$glob}{HASH} ];
+    }
+    my $state = ahead_snapshot($generator);
+    $state->{globals} = \%globals;
+    return $state;
+}
+
+sub restore_ahead_state {
+    my ($generator, $state) = @_;
+    restore_snapshot($generator, $state);
+    no strict 'refs';
+    foreach my $name (keys %{$state->{globals}}) {
+        my ($scalar, $array, $hash) = @{$state->{globals}->{$name}};
+        my $full_name = "GenTest_e::Generator::FromGrammar::" . $name;
+        ${$full_name} = $scalar;
+        @{$full_name} = @$array if defined $array;
+        %{$full_name} = %$hash  if defined $hash;
+    }
+}
+
+sub ahead_helper {
+# The main loop of the helper process. Does not return.
+    my ($generator, $executors, $reader, $writer, $depth) = @_;
+    $in_helper  = 1;
+    $SIG{PIPE}  = 'IGNORE';
+    $SIG{INT}   = 'IGNORE';
+    # The connections belong to the worker. So they must not get closed when the handles get
+    # destroyed.
+    foreach my $executor (@$executors) {
+        next if not defined $executor->dbh();
+        $executor->dbh()->{InactiveDestroy} = 1;
+        push @detached_handles, $executor->dbh();
+        $executor->setDbh(bless({}, 'GenTest_e::Generator::FromGrammar::DetachedHandle'));
+    }
+    my ($credits, $gen, $seq) = ($depth, 0, 0);
+    # seq of batch -> snapshot of the generator after generating the batch. 0 is the start.
+    my %snapshots = (0 => ahead_snapshot($generator));
+    my $barrier   = 0;
+    my $buffer    = '';
+    my $rin = '';
+    vec($rin, fileno($reader), 1) = 1;
+    while (1) {
+        # Process the messages of the worker. Wait for some if no credit is left.
+        my $rout;
+        while (select($rout = $rin, undef, undef, (($credits > 0 and not $barrier) ? 0 : undef)) > 0) {
+            POSIX::_exit(0) if not sysread($reader, $buffer, 4096, length($buffer));
+            while ($buffer =~ s{^([NRS]) ([0-9]+)\n}{}) {
+                my ($message, $consumed) = ($1, $2);
+                map { delete $snapshots{$_} if $_ < $consumed } keys %snapshots;
+                if ($message eq 'N') {
+                    $credits++;
+                } elsif ($message eq 'R') {
+                    restore_snapshot($generator, $snapshots{$consumed});
+                    map { delete $snapshots{$_} if $_ > $consumed } keys %snapshots;
+                    $gen++;
+                    $credits = $depth;
+                    $generator->[GENERATOR_RECONNECT] = 1;
+                } else {
+                    restore_snapshot($generator, $snapshots{$consumed});
+                    write_record($writer, [ 'S', $seq, $gen, ahead_state($generator) ]);
+                    POSIX::_exit(0);
+                }
+            }
+        }
+        next if $credits <= 0 or $barrier;
+        $seq++;
+        my $queries = eval { $generator->next($executors) };
+        if (defined $queries and
+            write_record($writer, [ 'B', $seq, $gen, $queries,
+                                    $generator->[GENERATOR_PARTICIPATING_RULES], [ @picks ] ])) {
+            $snapshots{$seq} = ahead_snapshot($generator);
+            $credits--;
+        } else {
+            # The worker generates the batch failing or not sendable again and runs so into the
+            # same problem. Wait for the 'S'.
+            POSIX::_exit(0) if not write_record($writer, [ 'X', $seq, $gen ]);
+            $barrier = 1;
+        }
+    }
+}
+
+sub startAhead {
+    my ($generator, $executors) = @_;
+    my $who_am_i = "GenTest_e::Generator::FromGrammar::startAhead:";
+    my $ahead    = $generator->[GENERATOR_AHEAD];
+    my $role     = "Thread" . $generator->threadId();
+    my ($ctrl_reader, $ctrl_writer, $data_reader, $data_writer);
+    if (not pipe($ctrl_reader, $ctrl_writer) or not pipe($data_reader, $data_writer)) {
+        say("WARN: $who_am_i $role : Creating the pipes failed : $!. Generating without helper.");
+        $ahead->{sync} = 1;
+        return;
+    }
+    binmode($_) foreach ($ctrl_reader, $ctrl_writer, $data_reader, $data_writer);
+    my $pid = fork();
+    if (not defined $pid) {
+        say("WARN: $who_am_i $role : Forking the helper failed : $!. Generating without helper.");
+        $ahead->{sync} = 1;
+        return;
+    }
+    if (0 == $pid) {
+        close($ctrl_writer);
+        close($data_reader);
+        ahead_helper($generator, $executors, $ctrl_reader, $data_writer, $ahead->{depth});
+    }
+    close($ctrl_reader);
+    close($data_writer);
+    $ahead->{pid}       = $pid;
+    $ahead->{reader}    = $data_reader;
+    $ahead->{writer}    = $ctrl_writer;
+    $ahead->{consumed}  = 0;    # seq of the last batch consumed
+    $ahead->{sent_gen}  = 0;    # Number of reconnects sent
+    $ahead->{reconnect} = 0;    # 1 if no batch generated after the last reconnect was consumed
+    # Metadata changes restart the helper frequently. Do not flood the log with that.
+    say("INFO: $who_am_i $role : The helper process $pid generates up to " . $ahead->{depth} .
+        " query batches ahead.") if not $ahead->{restarts};
+}
+
+sub stopAhead {
+# Stop the helper and bring the generator into the state after the last batch consumed.
+# $restart == 1 means that the next batch gets generated by a new helper.
+    my ($generator, $restart) = @_;
+    my $who_am_i = "GenTest_e::Generator::FromGrammar::stopAhead:";
+    my $role     = "Thread" . $generator->threadId();
+    my $ahead    = $generator->[GENERATOR_AHEAD];
+    send_message($ahead, 'S');
+    my $record;
+    do {
+        $record = read_record($ahead->{reader});
+    } while (defined $record and $record->[0] ne 'S');
+    close($ahead->{writer});
+    close($ahead->{reader});
+    kill 'KILL', $ahead->{pid};
+    waitpid($ahead->{pid}, 0);
+    $ahead->{pid} = undef;
+    if (defined $record) {
+        restore_ahead_state($generator, $record->[3]);
+    } else {
+        # The helper died. Nothing left which could tell the state.
+        say("WARN: $who_am_i $role : The helper process died. Going on with the state at its " .
+            "start.");
+        $restart = 0;
+    }
+    $generator->[GENERATOR_RECONNECT] = 1 if $ahead->{reconnect};
+    if ($restart) {
+        $ahead->{restarts}++;
+    } else {
+        $ahead->{sync} = 1;
+        say("INFO: $who_am_i $role : The helper process stopped after " . $ahead->{consumed} .
+            " query batches consumed. Generating without helper.");
+    }
+}
+
+sub metaDataChanged {
+# To be called after the metadata of the executors got refreshed.
+    my ($generator) = @_;
+    my $ahead = $generator->[GENERATOR_AHEAD];
+    $generator->stopAhead(1) if defined $ahead and defined $ahead->{pid} and not $ahead->{sync};
+}
+
+sub nextAhead {
+# Return the next query batch generated by the helper.
+    my ($generator, $executors) = @_;
+    my $ahead = $generator->[GENERATOR_AHEAD];
+    if (not defined $ahead->{pid}) {
+        # A restart happens only if there was no barrier.
+        my $barrier = ($ahead->{restarts} ? undef : $generator->aheadBarrier());
+        if (defined $barrier) {
+            say("INFO: GenTest_e::Generator::FromGrammar::nextAhead: Thread" .
+                $generator->threadId() . " : Generating without helper because $barrier.");
+            $ahead->{sync} = 1;
+        } else {
+            $generator->startAhead($executors);
+        }
+        return $generator->next($executors) if $ahead->{sync};
+    }
+    while (1) {
+        my $record = read_record($ahead->{reader});
+        if (not defined $record or $record->[0] ne 'B') {
+            $generator->stopAhead(0);
+            return $generator->next($executors);
+        }
+        my (undef, $seq, $gen, $queries, $participating_rules, $picks) = @$record;
+        # Generated before the last reconnect.
+        next if $gen < $ahead->{sent_gen};
+        $ahead->{consumed}  = $seq;
+        $ahead->{reconnect} = 0;
+        send_message($ahead, 'N');
+        $generator->[GENERATOR_PARTICIPATING_RULES] = $participating_rules;
+        @picks = @$picks;
+        return $queries;
+    }
+}
+
+sub setReconnect {
+    my ($generator, $value) = @_;
+    my $ahead = $generator->[GENERATOR_AHEAD];
+    if ($value and defined $ahead and defined $ahead->{pid} and not $ahead->{sync}) {
+        send_message($ahead, 'R');
+        $ahead->{sent_gen}++;
+        $ahead->{reconnect} = 1;
+        return;
+    }
+    $generator->SUPER::setReconnect($value);
+}
+
 sub next {
 
     # Original code harvesting a warning like
@@ -107,6 +879,10 @@ sub next {
     # my ($generator, $executors) = @_;
     our ($generator, $executors) = @_;
 
+    return $generator->nextAhead($executors)
+        if defined $generator->[GENERATOR_AHEAD] and not $in_helper and
+           not $generator->[GENERATOR_AHEAD]->{sync};
+
     # Suppress complaints "returns its argument for UTF-16 surrogate".
     # We already know that our UTFs in some grammars are ugly.
     no warnings 'surrogate';
@@ -131,8 +907,13 @@ sub next {
     our $last_table;
     our $last_database;
 
-    my $stack = GenTest_e::Stack::Stack->new();
-    my $global = $generator->globalFrame();
+    # Used in expand
+    our $record_picks = $generator->wantsOutcome();
+    $#picks = -1;
+
+    # our because the compiled Perl snippets of grammars use $stack.
+    our $stack = GenTest_e::Stack::Stack->new();
+    our $global = $generator->globalFrame();
 
     # 2018-11-15 observation (mleich):
     # Masses of ... occured more than ... times. Possible endless loop in grammar. Aborting."
@@ -185,109 +966,69 @@ sub next {
     # Half experimental solution:
     # Try to detect that problem as early as possible and react immediate with
     # 1. Warn about the possible endless loop in grammar
-    # 2. Try to free as much memory (-> @sentence, @expansion) as possible
+    # 2. Try to free as much memory (-> @token_buffer, frames) as possible
     # 3. Return undef which does not get interpreted as statement to be executed.
     # 4. Go on with the test and do not set a status because of the problem.
     #
 
-    our $print_num = 0;
-    sub print_sentence {
-        my ($sentence_ptr) = @_;
-        $print_num++;
-        if (not defined $sentence_ptr) {
-            say("WARNING: $who_am_i print_sentence: sentence_ptr is not defined");
-        } else {
-            # say("DEBUG: $who_am_i \@sentence has " . scalar @{$sentence_ptr} . " elements");
-            # say("DEBUG: $who_am_i $print_num \@sentence: ->" . join(" ", @{$sentence_ptr}) . "<-");
-        }
-    }
-
     sub expand {
-        # Warning:
-        # Expand returns on
-        # - success some not empty array
-        # - failure some empty array
-        #   The old solution was exiting with die or returning undef.
-        #   The latter leads to
-        #       @blabla = undef --> @blabla has one element and that is undef
+        # Expand the rule $starting_rule and return a reference to the tokens of the query.
+        # The reference points to @token_buffer which gets reused by the next call.
         #
-
-        my ($rule_counters, $rule_invariants, @sentence) = @_;
-
-        # How to hunt a Perl warning like
-        #     Deep recursion on subroutine "GenTest_e::Generator::FromGrammar::expand"
-        #     at /work/RQG_mleich3/lib/GenTest_e/Generator/FromGrammar.pm line ....
-        # --------------------------------------------------------------------------
-        # The example code was used for analysis but needs to be deactivated.
-        # Reason:
-        # - "Deep recursion on subroutine" gets reportet as soon as a limit of 100 was exceeded.
-        #   But we prefer to go with our own limit GENERATOR_MAX_OCCURRENCES.
-        # - RQG aborts the test when observing STATUS_RSS_DOUBLED.
-        #   This accelerated the analysis where I used the RQG test simplifier.
-        #   But this harsh reaction does not fit well to RQG testing with certain grammars.
+        # The expansion is iterative and uses an explicit stack of frames. A frame corresponds
+        # to a level of the former recursive implementation (the component of some rule getting
+        # expanded). Tokens get processed depth first and left to right and the tokens of some
+        # expansion get processed again within the parent frame like before. So the queries
+        # generated and the order of calls of the PRNG are the same.
+        # - Failure of some Perl snippet throws the output of the frame containing it away.
+        # - Exceeding one of the limits throws the complete query away.
         #
-        # local $SIG{__WARN__} = sub {
-        #     my $message = shift;
-        #     # Print like perl would print it without the SIG{__WARN__}.
-        #     print($message . "\n");
-        #     if ($message =~ /Deep recursion on subroutine/) {
-        #         # Pick a status >= STATUS_CRITICAL_FAILURE which does not cause that Reporters
-        #         # assume that they have to do further analysis.
-        #         # Negative example:
-        #         # STATUS_CRITICAL_FAILURE, STATUS_SERVER_CRASHED, STATUS_ALARM ...
-        #         # Backtrace kicks in and waits a long timespan for the DB server process dying.
-        #         # STATUS_RSS_DOUBLED does not fit to the problem but it causes a fine reaction.
-        #         my $status = STATUS_RSS_DOUBLED;
-        #         say("ERROR: We have just hit the perl warning. Will return STATUS_RSS_DOUBLED");
-        #         exit $status;
-        #     }
-        # };
-
         # Comment (mleich1)
         # A sentence is an array of words and spaces.
         # They all together form a query which consists of one till several statements.
 
-        my $item_nodash;   # FIXME: This variable belongs to old code and is currently unused.
-                           # Is that right?
-
-        # For debugging
-        if (0) {
-        #   foreach my $sentence_part (@sentence) {
-        #       say("DEBUG: sentence_part ->$sentence_part<-");
-        #   }
-        #   say("DEBUG: sentence_end -------");
-            print_sentence(\@sentence);
-
-        }
+        my ($rule_counters, $rule_invariants, $starting_rule) = @_;
 
         # Define some standard message because patterns matching might need it.
         my $warn_message_part = "WARN: Possible endless loop in grammar. " .
                                 "Will return an empty array.";
 
-        if ($#sentence > GENERATOR_MAX_LENGTH) {
-            say("WARN: $who_am_i Sentence is now longer than " .
-                GENERATOR_MAX_LENGTH() . " symbols.\n" . $warn_message_part);
-            @sentence = ();
-            return ();
-        }
-
-        my $orig_item;
-        for (my $pos = 0; $pos <= $#sentence; $pos++) {
-            $orig_item = $sentence[$pos];
-
-            # For debugging
-            if (0) {
-                say("DEBUG: orig_item ->$orig_item<-");
-                print_sentence(\@sentence);
+        $#token_buffer   = -1;
+        $#live_positions = -1;
+        $pending_tokens  = 0;
+        $buffer_bytes    = 0;
+        push_frame([ $starting_rule ], 0, 0, undef);
+
+        TOKEN: while (@frame_parts) {
+            my $orig_item;
+            if (defined $frame_queue[-1] and @{$frame_queue[-1]}) {
+                $orig_item = shift @{$frame_queue[-1]};
+            } elsif ($frame_pos[-1] <= $#{$frame_parts[-1]}) {
+                $orig_item = $frame_parts[-1]->[$frame_pos[-1]++];
+            } else {
+                # The frame is completely processed.
+                my $invariant_rule = $frame_invariant[-1];
+                @{$rule_invariants->{$invariant_rule}} =
+                    @token_buffer[$frame_start[-1]..$#token_buffer] if defined $invariant_rule;
+                my $rescan = $frame_rescan[-1];
+                pop_frame();
+                requeue_tokens($rescan) if @frame_parts;
+                next TOKEN;
             }
+            $pending_tokens--;
 
-            next if not defined $orig_item;
-            next if $orig_item eq ' ';
-            next if $orig_item eq uc($orig_item);
+            my @expansion = ();
+            if (not defined $orig_item or $orig_item eq ' ' or $orig_item eq uc($orig_item)) {
+                # Take it as is.
+                @expansion = ($orig_item);
+                my $limit_text = push_tokens($grammar_rules, @expansion);
+                next TOKEN if not defined $limit_text;
+                say("WARN: $who_am_i $limit_text\n" . $warn_message_part);
+                return abort_expansion();
+            }
 
             my $item =      $orig_item;
             my $invariant = 0;
-            my @expansion = ();
 
             if ($item =~ m{^([a-z0-9_]+)\[invariant\]}sio) {
                 ($item, $invariant) = ($1, 1);    # $item is for example '_table'
@@ -301,24 +1042,42 @@ sub next {
                 if (++($rule_counters->{$orig_item}) > GENERATOR_MAX_OCCURRENCES) {
                     say("WARN: $who_am_i Rule '$orig_item' occured more " .
                         "than " . GENERATOR_MAX_OCCURRENCES() . " times.\n" . $warn_message_part);
-                    @sentence  = ();
-                    return ();
+                    return abort_expansion();
                 }
 
+                if ($generator->[GENERATOR_ANNOTATE_RULES]) {
+                    @expansion = ("/* rule: $item */ ");
+                }
+                if ($invariant and defined $rule_invariants->{$item}) {
+                    push @expansion, @{$rule_invariants->{$item}};
+                    # All tokens except the first get processed again.
+                    my $rescan = scalar(@token_buffer) + 1;
+                    my $limit_text = push_tokens($grammar_rules, @expansion);
+                    if (not defined $limit_text) {
+                        requeue_tokens($rescan);
+                        next TOKEN;
+                    }
+                    say("WARN: $who_am_i $limit_text\n" . $warn_message_part);
+                    return abort_expansion();
+                }
+                my $start = scalar(@token_buffer) + scalar(@expansion);
+                # Without annotation the first token of the output is not to be processed again.
+                my $rescan = (scalar @expansion ? $start : $start + 1);
                 if ($invariant) {
-                    @{$rule_invariants->{$item}} = expand($rule_counters,$rule_invariants,($item)) unless defined $rule_invariants->{$item};
-                    @expansion = @{$rule_invariants->{$item}};
-                  # if ( 0 == scalar @expansion ) {
-                  #     say("DEBUG: Empty array got 1.");
-                  # }
+                    # Some frame of its own which expands the rule like the former implementation.
+                    push_frame([ $item ], $start, $rescan, $item);
                 } else {
                     # say("DEBUG: item ->$item<-");
-                    @expansion = expand($rule_counters,$rule_invariants,@{$grammar_rules->{$item}->[GenTest_e::Grammar::Rule::RULE_COMPONENTS]->[
-                        $prng->uint16(0, $#{$grammar_rules->{$item}->[GenTest_e::Grammar::Rule::RULE_COMPONENTS]})
-                    ]});
-                }
-                if ($generator->[GENERATOR_ANNOTATE_RULES]) {
-                    @expansion = ("/* rule: $item */ ", @expansion);
+                    my $rule        = $grammar_rules->{$item};
+                    my $components  = $rule->[GenTest_e::Grammar::Rule::RULE_COMPONENTS];
+                    my $id          = $prng->uint16(0, $#$components);
+                    my $alias_table = $rule->[GenTest_e::Grammar::Rule::RULE_ALIAS_TABLE];
+                    # Weighted components. See GenTest_e::Grammar::Rule::alias_table.
+                    $id = $alias_table->[1]->[$id]
+                        if defined $alias_table and
+                           $prng->uint16(0, 0xFFFF) >= $alias_table->[0]->[$id];
+                    push @picks, $item, $id if $record_picks;
+                    push_frame($components->[$id], $start, $rescan, undef);
                 }
 			} else {
                 my $non_mangled_item;
@@ -326,28 +1085,41 @@ sub next {
 					(substr($item,  0, 1) eq '{') &&
 					(substr($item, -1, 1) eq '}')
 				) {
-                    # The "no strict" is because grammars could fiddle with undef perl variables.
-					$item = eval("no strict;\n".$item);		# Code
-					if ($@ ne '') {
-						if ($@ =~ m{at .*? line}o) {
-							say("ERROR: Internal grammar error: $@");
-                            @sentence  = ();
-                            @expansion = ();
+                    my $compiled = compile_code($item);		# Code
+                    my $error    = $compiled->[1];
+                    my $value;
+                    if ($error eq '') {
+                        $value = eval { $compiled->[0]->() };
+                        $error = $@;
+                        die $error if $in_helper and $error eq AHEAD_BARRIER;
+                    }
+					if ($error ne '') {
+						if ($error =~ m{at .*? line}o) {
+							say("ERROR: Internal grammar error: $error");
 							# the original code called here die()
-                            return ();
+                            drop_frame($rule_invariants);
+                            next TOKEN;
 						} else {
-							say("WARN: $who_am_i Eval error of Perl snippet ->" . $item . "<- : $@");
+							say("WARN: $who_am_i Eval error of Perl snippet ->" . $item . "<- : $error");
 							say("WARN: $who_am_i Will return an empty array.");
-                            @sentence  = ();
-                            @expansion = ();
-                            return ();
+                            drop_frame($rule_invariants);
+                            next TOKEN;
 						}
 					}
+                    $item = $value;
 				} elsif (substr($item, 0, 1) eq '$') {
-					$item = eval("no strict;\n".$item.";\n");	# Variable
-                    if ($@ ne '') {
-                        say("WARN: $who_am_i Eval error of Perl snippet ->" . $item . "<- : $@");
+                    my $compiled = compile_code($item);		# Variable
+                    my $error    = $compiled->[1];
+                    my $value;
+                    if ($error eq '') {
+                        $value = eval { $compiled->[0]->() };
+                        $error = $@;
+                        die $error if $in_helper and $error eq AHEAD_BARRIER;
                     }
+                    if ($error ne '') {
+                        say("WARN: $who_am_i Eval error of Perl snippet ->" . $item . "<- : $error");
+                    }
+                    $item = $value;
 				} else {
 
                     # Check for expressions such as _tinyint[invariant]
@@ -367,9 +1139,6 @@ sub next {
                         $invariant = 1;
                     }
 
-                    # For debugging:
-                    # print_sentence(\@sentence);
-
 					my $field_type = (substr($item, 0, 1) eq '_' ? $prng->isFieldType(substr($item, 1)) : undef);
 
 					if ($item eq '_letter') {
@@ -533,10 +1302,12 @@ sub next {
                 }
 
 			}
-			splice(@sentence, $pos, 1, @expansion);
-
+            my $limit_text = push_tokens($grammar_rules, @expansion);
+            next TOKEN if not defined $limit_text;
+            say("WARN: $who_am_i $limit_text\n" . $warn_message_part);
+            return abort_expansion();
         }
-        return @sentence;
+        return \@token_buffer;
     } # end of sub expand
 
 	#
@@ -632,15 +1403,17 @@ sub next {
     $grammar = $generator->[GENERATOR_MASKED_GRAMMAR] if defined $generator->[GENERATOR_MASKED_GRAMMAR];
     $grammar_rules = $grammar->rules();
 
+    $generator->adaptWeights($grammar_rules) if defined $generator->[GENERATOR_ADAPTIVE];
+
     my $starting_rule_for_print = $starting_rule;
     $starting_rule_for_print = "<undef>" if not defined $starting_rule;
     # say("DEBUG: Thread" . $generator->threadId() . " starting_rule '" . $starting_rule_for_print . "'");
 
-    my @sentence = expand(\%rule_counters, \%rule_invariants, ($starting_rule));
+    my $sentence_ref = expand(\%rule_counters, \%rule_invariants, $starting_rule);
 
     $generator->[GENERATOR_SEQ_ID]++;
 
-    my $sentence = join ('', map { defined $_ ? $_ : '' } @sentence);
+    my $sentence = join ('', map { defined $_ ? $_ : '' } @$sentence_ref);
 
     # Remove extra spaces while we are here
     while ($sentence =~ s/\.\s/\./s) {};
@@ -752,3 +1525,17 @@ sub next {
 } # End of sub next
 
 1;
+
+# Replaces the database handles of the executors within the helper generating ahead.
+package GenTest_e::Generator::FromGrammar::DetachedHandle;
+
+our $AUTOLOAD;
+
+sub AUTOLOAD {
+    die GenTest_e::Generator::FromGrammar::AHEAD_BARRIER();
+}
+
+sub DESTROY {
+}
+
+1;
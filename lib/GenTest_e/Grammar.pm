@@ -34,15 +34,37 @@ use GenTest_e::Grammar::Rule;
 use GenTest_e::Random;
 
 use Data::Dumper;
+use Digest::SHA;
+use File::Basename;
+use Storable;
 
 use constant GRAMMAR_RULES    => 0;
 use constant GRAMMAR_FILES    => 1;
 use constant GRAMMAR_STRING   => 2;
 use constant GRAMMAR_FLAGS    => 3;
+use constant GRAMMAR_CACHE    => 4;
 
 use constant GRAMMAR_FLAG_COMPACT_RULES         => 1;
 use constant GRAMMAR_FLAG_SKIP_RECURSIVE_RULES  => 2;
 
+# Parsed grammars get cached in the directory assigned via the environment variable
+# RQG_GRAMMAR_CACHE. An empty value disables the cache.
+# Default: <TMPDIR or /tmp>/rqg_grammar_cache_<uid>
+# The directory must be owned by the current user and have the mode 0700. Otherwise some other
+# user could plant files which get deserialized. Caching is disabled in that case.
+# The constructor argument grammar_cache => 0 disables the cache for grammars parsed only once.
+# Every process storing some new entry removes the least recently used entries above
+# GRAMMAR_CACHE_MAX_ENTRIES. The Simplifier generates many grammars.
+# The key of some cache entry is the SHA-256 of the grammar string after expanding the #include
+# directives, the grammar flags and GRAMMAR_CACHE_FORMAT.
+# Any change of the parser or of the layout of the rule objects must increase
+# GRAMMAR_CACHE_FORMAT. Otherwise outdated cache entries would get used.
+use constant GRAMMAR_CACHE_ENV     => 'RQG_GRAMMAR_CACHE';
+use constant GRAMMAR_CACHE_FORMAT  => 2;
+use constant GRAMMAR_CACHE_MAX_ENTRIES => 1000;
+my $cache_warning_emitted = 0;
+my $cache_pruned          = 0;
+
 # Value 1 produces
 # - a lot debug output
 # - files t*.tyy in current working directory
@@ -58,7 +80,8 @@ sub new {
         'grammar_files'        => GRAMMAR_FILES,
         'grammar_string'       => GRAMMAR_STRING,
         'grammar_flags'        => GRAMMAR_FLAGS,
-        'grammar_rules'        => GRAMMAR_RULES
+        'grammar_rules'        => GRAMMAR_RULES,
+        'grammar_cache'        => GRAMMAR_CACHE
     }, @_);
 
 
@@ -145,6 +168,37 @@ sub dump_transformed_grammar {
     }
 }
 
+sub cache_file {
+# Return
+# - the name of the cache file for the grammar string and flags assigned
+# - undef if the cache is disabled or the cache directory is not usable
+    my ($grammar_string, $grammar_flags) = @_;
+
+    # The debug mode wants to see all transformations.
+    return undef if $script_debug;
+    my $cache_dir = $ENV{&GRAMMAR_CACHE_ENV};
+    if (not defined $cache_dir) {
+        $cache_dir = (defined $ENV{'TMPDIR'} ? $ENV{'TMPDIR'} : '/tmp') . "/rqg_grammar_cache_$<";
+    }
+    return undef if $cache_dir eq '';
+    if (not -d $cache_dir) {
+        # Concurrent RQG runs might create the directory at the same time.
+        mkdir($cache_dir, 0700);
+        return undef if not -d $cache_dir;
+    }
+    my @stat = lstat($cache_dir);
+    if (not @stat or not -d _ or $stat[4] != $< or ($stat[2] & 07777) != 0700) {
+        say("WARN: The grammar cache directory '$cache_dir' is not owned by the current user " .
+            "or has not the mode 0700. Grammar caching is disabled.")
+            if not $cache_warning_emitted++;
+        return undef;
+    }
+    my $key = Digest::SHA::sha256_hex(join("\n", GRAMMAR_CACHE_FORMAT,
+                                      (defined $grammar_flags ? $grammar_flags : ''),
+                                      $grammar_string));
+    return $cache_dir . "/" . $key . ".rules";
+}
+
 sub parseFromString {
     my ($grammar, $grammar_string) = @_;
 
@@ -201,6 +255,22 @@ sub parseFromString {
     }}mie) {};
     dump_transformed_grammar ($grammar_string, 2, 'expanding includes.');
 
+    my $cache_file;
+    $cache_file = cache_file($grammar_string, $grammar->[GRAMMAR_FLAGS])
+        if not defined $grammar->[GRAMMAR_CACHE] or $grammar->[GRAMMAR_CACHE];
+    if (defined $cache_file and -f $cache_file) {
+        # A damaged or foreign cache file is no reason to fail. Just parse again.
+        my $cached_rules = eval { Storable::retrieve($cache_file) };
+        if (defined $cached_rules and ref($cached_rules) eq 'HASH' and
+            exists $cached_rules->{'query'}) {
+            $grammar->[GRAMMAR_RULES]  = $cached_rules;
+            $grammar->[GRAMMAR_STRING] = $grammar->toString();
+            # The modification time tells prune_cache when the entry was used last.
+            utime(undef, undef, $cache_file);
+            return STATUS_OK;
+        }
+    }
+
     my $aux_separator  = "§_aux_separator_§\n";
     my $rule_separator = "§_rule_separator_§\n";
     my $comp_separator = "§_comp_separator_§\n";
@@ -290,6 +360,8 @@ sub parseFromString {
                               "after egalization inside of rules.");
 
     our %rules;
+    # Leftovers of some previous parse in the same process must not show up in this grammar.
+    %rules = ();
 
     # Redefining grammars might want to *add* something to an existing rule
     # rather than replace them. For now we recognize additions only to init queries
@@ -498,6 +570,7 @@ sub parseFromString {
 
         my @components;
         my %components;
+        my @weights;
 
         my $components_string = $rules{$rule_name};
         say("DEBUG: 1 rule '$rule_name' components_string at begin ==>\n" .
@@ -576,6 +649,11 @@ sub parseFromString {
 
         foreach my $component_string (@component_strings) {
 
+            my $weight = 1;
+            if ($component_string =~ s{${\GenTest_e::Grammar::Rule::WEIGHT_PATTERN}}{}) {
+                $weight = $1;
+            }
+
             # Remove repeating whitespaces
             # ----------------------------
             # Effect 1:
@@ -677,16 +755,19 @@ sub parseFromString {
                 "into parts ==>\n" . join("\n<==>\n", @component_parts) . "\n<=") if $script_debug;
 
             push @components, \@component_parts;
+            push @weights, $weight;
         }
 
         my $rule = GenTest_e::Grammar::Rule->new(
             name       => $rule_name,
-            components => \@components
+            components => \@components,
+            weights    => ((grep { 1 != $_ } @weights) ? \@weights : undef)
         );
         $rules{$rule_name} = $rule;
     }
 
-    $grammar->[GRAMMAR_RULES] = \%rules;
+    # Own copy because %rules gets reused by the next parse.
+    $grammar->[GRAMMAR_RULES] = { %rules };
 
     my $final_string = $grammar->toString();
 
@@ -718,10 +799,39 @@ sub parseFromString {
         exit;
     }
 
+    if (defined $cache_file) {
+        # Concurrent RQG runs might store the same grammar. The rename is atomic.
+        my $cache_tmp = $cache_file . ".tmp" . $$;
+        if (eval { Storable::nstore($grammar->[GRAMMAR_RULES], $cache_tmp) }) {
+            unlink($cache_tmp) if not rename($cache_tmp, $cache_file);
+        } else {
+            unlink($cache_tmp);
+        }
+        prune_cache(File::Basename::dirname($cache_file)) if not $cache_pruned++;
+    }
+
     return STATUS_OK;
 
 } # End of sub parseFromString
 
+sub prune_cache {
+# Remove the least recently used entries of the cache directory above GRAMMAR_CACHE_MAX_ENTRIES.
+    my ($cache_dir) = @_;
+    return if not opendir(CACHE_DIR, $cache_dir);
+    my @entries = grep { m{\.rules$} } readdir(CACHE_DIR);
+    closedir(CACHE_DIR);
+    return if GRAMMAR_CACHE_MAX_ENTRIES >= scalar @entries;
+    my %mtime;
+    foreach my $entry (@entries) {
+        my $mtime = (stat($cache_dir . "/" . $entry))[9];
+        $mtime{$entry} = $mtime if defined $mtime;
+    }
+    my @oldest_first = sort { $mtime{$a} <=> $mtime{$b} } keys %mtime;
+    # Concurrent processes might remove the same entries. No problem.
+    unlink($cache_dir . "/" . $_)
+        foreach (@oldest_first[0 .. $#oldest_first - GRAMMAR_CACHE_MAX_ENTRIES]);
+}
+
 sub rule {
     return $_[0]->[GRAMMAR_RULES]->{$_[1]};
 }
@@ -788,19 +898,8 @@ sub top_rule_list {
 
     # rule_name is key in %$rules
     foreach my $rule_name (keys %{$rules}) {
-        if      ($rule_name eq 'query') {
-            $top_rule_hash{$rule_name} = 1;
-        } elsif ($rule_name =~ m{^thread[1-9][0-9]*$}) {
-            $top_rule_hash{$rule_name} = 2;
-        } elsif ($rule_name eq "query_connect" or $rule_name eq "thread_connect") {
-            $top_rule_hash{$rule_name} = 3;
-        } elsif ($rule_name =~ m{^thread[1-9][0-9]*_connect$}) {
-            $top_rule_hash{$rule_name} = 4;
-        } elsif ($rule_name eq "query_init") {
-            $top_rule_hash{$rule_name} = 5;
-        } elsif ($rule_name =~ m{^thread[1-9][0-9]*_init$}) {
-            $top_rule_hash{$rule_name} = 6;
-        }
+        my $reverse_weight = is_top_rule($rule_name);
+        $top_rule_hash{$rule_name} = $reverse_weight if defined $reverse_weight;
     }
     my $num_elements1 = scalar(keys(%top_rule_hash));
     if (0 == $num_elements1) {
@@ -825,6 +924,135 @@ sub top_rule_list {
     return @top_rule_list;
 }
 
+sub is_top_rule {
+# Return undef if the rule is no top level rule and otherwise the reverse weight of the rule
+# used for ordering the top_rule_list.
+# "thread", "thread_connect" and "thread_init" are the same like "query", "query_connect" and
+# "query_init" for the generator (see GenTest_e/Generator/FromGrammar.pm).
+    my ($rule_name) = @_;
+    if      ($rule_name eq 'query' or $rule_name eq 'thread') {
+        return 1;
+    } elsif ($rule_name =~ m{^thread[1-9][0-9]*$}) {
+        return 2;
+    } elsif ($rule_name eq "query_connect" or $rule_name eq "thread_connect") {
+        return 3;
+    } elsif ($rule_name =~ m{^thread[1-9][0-9]*_connect$}) {
+        return 4;
+    } elsif ($rule_name eq "query_init" or $rule_name eq "thread_init") {
+        return 5;
+    } elsif ($rule_name =~ m{^thread[1-9][0-9]*_init$}) {
+        return 6;
+    }
+    return undef;
+}
+
+sub analyze {
+
+# Static analysis of the rule graph.
+# Return a reference to a hash with
+#   min_length      -- rule name -> minimum number of terminals in some expansion of the rule
+#                      or undef if every expansion of the rule is endless
+#   unreachable     -- list of rules which cannot be reached from any top level rule
+#   all_recursive   -- list of rules where every component references the rule itself
+#   non_terminating -- list of reachable rules where every expansion is endless
+#
+# Notes
+# -----
+# - A rule in non_terminating means that the generator will fail with
+#   'Possible endless loop in grammar.' as soon as it enters that rule. The grammar simplifier
+#   uses that for throwing away candidate grammars without spending a RQG run on them.
+# - Perl snippets count as terminals. But their code might return the name of some rule which
+#   gets than expanded. Hence names of rules mentioned in snippets count as references when
+#   computing the reachability.
+# - Top level rules for threads which will be never used (thread5 and threads=2) count as
+#   reachable because GenTest_e/Grammar.pm does not "know" the number of threads to be used.
+#
+
+    my $grammar = shift;
+    my $rules   = $grammar->rules();
+
+    # rule name -> list of [ number of terminals, names of referenced rules ... ] per component
+    my %graph;
+    # rule name -> list of rule names mentioned in Perl snippets
+    my %snippet_references;
+    my @all_recursive;
+    foreach my $rule_name (sort keys %$rules) {
+        my @alternatives;
+        my $recursive_components = 0;
+        my $components = $rules->{$rule_name}->components();
+        foreach my $component (@$components) {
+            my $terminals = 0;
+            my @references;
+            foreach my $part (@$component) {
+                my $item = $part;
+                $item = $1 if $item =~ m{^([a-z0-9_]+)\[invariant\]}sio;
+                if (exists $rules->{$item}) {
+                    push @references, $item;
+                } elsif ($item =~ m{\S}s) {
+                    $terminals++;
+                    if ((substr($item, 0, 1) eq '{' and substr($item, -1, 1) eq '}') or
+                        substr($item, 0, 1) eq '$') {
+                        push @{$snippet_references{$rule_name}},
+                             grep { exists $rules->{$_} } ($item =~ m{([a-z0-9_]+)}gio);
+                    }
+                }
+            }
+            $recursive_components++ if grep { $_ eq $rule_name } @references;
+            push @alternatives, [ $terminals, @references ];
+        }
+        push @all_recursive, $rule_name
+            if 0 < scalar @$components and $recursive_components == scalar @$components;
+        $graph{$rule_name} = \@alternatives;
+    }
+
+    # Fixpoint iteration. The lengths only shrink and are never negative.
+    my %min_length;
+    my $changed = 1;
+    while ($changed) {
+        $changed = 0;
+        foreach my $rule_name (sort keys %graph) {
+            my $rule_min;
+            ALTERNATIVE:
+            foreach my $alternative (@{$graph{$rule_name}}) {
+                my ($length, @references) = @$alternative;
+                foreach my $reference (@references) {
+                    next ALTERNATIVE if not defined $min_length{$reference};
+                    $length += $min_length{$reference};
+                }
+                $rule_min = $length if not defined $rule_min or $length < $rule_min;
+            }
+            if (defined $rule_min and
+                (not defined $min_length{$rule_name} or $rule_min < $min_length{$rule_name})) {
+                $min_length{$rule_name} = $rule_min;
+                $changed = 1;
+            }
+        }
+    }
+
+    my %reachable;
+    my @todo = grep { is_top_rule($_) } keys %graph;
+    while (@todo) {
+        my $rule_name = shift @todo;
+        next if $reachable{$rule_name};
+        $reachable{$rule_name} = 1;
+        foreach my $alternative (@{$graph{$rule_name}}) {
+            my (undef, @references) = @$alternative;
+            push @todo, grep { not $reachable{$_} } @references;
+        }
+        if (defined $snippet_references{$rule_name}) {
+            push @todo, grep { not $reachable{$_} } @{$snippet_references{$rule_name}};
+        }
+    }
+
+    return {
+        min_length      => \%min_length,
+        unreachable     => [ grep { not $reachable{$_} } sort keys %graph ],
+        all_recursive   => \@all_recursive,
+        non_terminating => [ grep { $reachable{$_} and not defined $min_length{$_} }
+                             sort keys %graph ],
+    };
+}
+
 
 sub deleteRule {
     delete $_[0]->[GRAMMAR_RULES]->{$_[1]};
@@ -849,9 +1077,11 @@ sub cloneRule {
         unshift @new_components , \@new_component_parts ;
     }
 
+    my $weights  = $grammar->[GRAMMAR_RULES]->{$old_rule_name}->weights();
     my $new_rule = GenTest_e::Grammar::Rule->new(
         name       => $new_rule_name,
-        components => \@new_components
+        components => \@new_components,
+        weights    => (defined $weights ? [ @$weights ] : undef)
     );
     $grammar->[GRAMMAR_RULES]->{$new_rule_name} = $new_rule;
 
@@ -986,8 +1216,13 @@ sub mask {
     foreach my $rulename (sort keys %$rules) {
         my $rule = $self->rule($rulename);
         my @newComponents;
-        foreach my $x (@{$rule->components()}) {
-            push @newComponents, $x if (1 << ($i++)) & $mask16;
+        my @newWeights;
+        my $components = $rule->components();
+        foreach my $id (0..$#$components) {
+            if ((1 << ($i++)) & $mask16) {
+                push @newComponents, $components->[$id];
+                push @newWeights, $rule->weight($id);
+            }
             if ($i % 16 == 0) {
                 # We need more bits!
                 $i = 0;
@@ -1003,7 +1238,9 @@ sub mask {
             $newRule = $rule;
         } else {
             $newRule= GenTest_e::Grammar::Rule->new(name       => $rulename,
-                                                  components => \@newComponents);
+                                                  components => \@newComponents,
+                                                  weights    => (defined $rule->weights() ?
+                                                                 \@newWeights : undef));
         }
         $newRuleset{$rulename} = $newRule;
 
@@ -23,13 +23,26 @@ use strict;
 
 use constant RULE_NAME          => 0;
 use constant RULE_COMPONENTS    => 1;
+# undef or a reference to an array with the weights of the components (same index)
+use constant RULE_WEIGHTS       => 2;
+# undef or [ reference to array of thresholds, reference to array of aliases ]
+use constant RULE_ALIAS_TABLE   => 3;
+
+# A component starting with '/*+weight=<n>*/' gets picked <n> times more often than a component
+# with weight 1 (default). Example:
+# query:
+#     /*+weight=10*/ select |
+#     /*+weight=2*/  update |
+#     ddl                   ;
+use constant WEIGHT_PATTERN     => qr{^/\*\+weight=([1-9][0-9]*)\*/ *};
 
 # When printing a grammar or a rule than all components of a rule should begin with this indent.
 use constant COMPONENT_INDENT   => '    ';
 
 my %args = (
     'name'        => RULE_NAME,
-    'components'  => RULE_COMPONENTS
+    'components'  => RULE_COMPONENTS,
+    'weights'     => RULE_WEIGHTS
 );
 
 sub new {
@@ -58,6 +71,77 @@ sub components {
 
 sub setComponents {
     $_[0]->[RULE_COMPONENTS] = $_[1];
+    $_[0]->[RULE_WEIGHTS]    = $_[2];
+    $_[0]->[RULE_ALIAS_TABLE] = undef;
+}
+
+sub weights {
+    return $_[0]->[RULE_WEIGHTS];
+}
+
+sub setWeights {
+    $_[0]->[RULE_WEIGHTS]     = $_[1];
+    $_[0]->[RULE_ALIAS_TABLE] = undef;
+    $_[0]->alias_table();
+}
+
+sub weight {
+    my ($rule, $component_id) = @_;
+    return 1 if not defined $rule->[RULE_WEIGHTS];
+    return $rule->[RULE_WEIGHTS]->[$component_id];
+}
+
+sub weight_prefix {
+# Return the annotation to be put in front of the component string.
+    my ($rule, $component_id) = @_;
+    my $weight = $rule->weight($component_id);
+    return (1 == $weight) ? '' : '/*+weight=' . $weight . '*/ ';
+}
+
+sub alias_table {
+# Walker's alias method for picking a component according to the weights in O(1).
+# Computed once per rule (Vose's variant) and than kept in the rule object.
+# Picking a component:
+#     $id = <random in 0 .. number of components - 1>
+#     $id = $aliases->[$id] if <random in 0 .. 65535> >= $thresholds->[$id]
+# The thresholds are scaled to 16 bit because GenTest_e::Random::uint16 delivers that.
+# Return undef if all components have the weight 1. Than picking $id is sufficient.
+    my $rule = shift;
+    return $rule->[RULE_ALIAS_TABLE] if defined $rule->[RULE_ALIAS_TABLE];
+    my $weights = $rule->[RULE_WEIGHTS];
+    return undef if not defined $weights;
+
+    my $count = scalar @$weights;
+    my $total = 0;
+    map { $total += $_ } @$weights;
+    # scaled weight == weight * count / total. The average is 1.
+    my @scaled = map { $_ * $count / $total } @$weights;
+    my (@thresholds, @aliases, @small, @large);
+    foreach my $id (0..$#scaled) {
+        $aliases[$id] = $id;
+        if ($scaled[$id] < 1) {
+            push @small, $id;
+        } else {
+            push @large, $id;
+        }
+    }
+    while (@small and @large) {
+        my $small_id = pop @small;
+        my $large_id = $large[-1];
+        $thresholds[$small_id] = int($scaled[$small_id] * 0x10000);
+        $aliases[$small_id]    = $large_id;
+        $scaled[$large_id]     = $scaled[$large_id] + $scaled[$small_id] - 1;
+        if ($scaled[$large_id] < 1) {
+            pop @large;
+            push @small, $large_id;
+        }
+    }
+    # Leftovers differ from 1 only by rounding errors.
+    foreach my $id (@small, @large) {
+        $thresholds[$id] = 0x10000;
+    }
+    $rule->[RULE_ALIAS_TABLE] = [ \@thresholds, \@aliases ];
+    return $rule->[RULE_ALIAS_TABLE];
 }
 
 sub unique_components {
@@ -172,7 +256,9 @@ sub toString {
 
     # Warning: An element of @$components is an array and not some string.
     my $string =     $rule->name() . ":\n$component_indent" .
-                           join(" |\n$component_indent", map { join('', @$_) } @$components) . " ;";
+                           join(" |\n$component_indent",
+                                map { $rule->weight_prefix($_) . join('', @{$components->[$_]}) }
+                                    (0..$#$components)) . " ;";
     # Prevent <more than one white space>;EOL
     $string =~ s{ +;$}{ ;}img;
     # Prevent BOL<one white space>;EOL
@@ -39,6 +39,13 @@ use constant MIXER_PROPERTIES      => 4;
 use constant MIXER_END_TIME        => 5;
 use constant MIXER_RESTART_TIMEOUT => 6;
 use constant MIXER_ROLE            => 7;
+# Asynchronous execution (--async_execute)
+# The last query of a batch stays in flight while the generator creates the next batch.
+# DDL and queries following DDL of the same batch run synchronous because the next batch has
+# to be generated from the refreshed metadata.
+# Only for threads without validators, filters and frozen time running against one server.
+use constant MIXER_ASYNC           => 8;
+use constant MIXER_NEXT_QUERIES    => 9;
 
 my %rule_status;
 
@@ -171,6 +178,25 @@ sub new {
         }
     }
 
+    if ($mixer->properties->property('resultset-digest')) {
+        if (grep { not $_->acceptsDigest() } @validators) {
+            say("INFO: " . $mixer->role() . " : Result set digests requested but not possible " .
+                "because some validator needs the rows.");
+        } else {
+            foreach my $executor (@{$mixer->executors()}) {
+                $executor->setFlags($executor->flags() | EXECUTOR_FLAG_DIGEST_DATA);
+            }
+        }
+    }
+
+    $mixer->[MIXER_ASYNC] = ($mixer->properties->property('async-execute') and
+                             1 == scalar @{$mixer->executors()} and 0 == scalar @validators and
+                             not (defined $mixer->filters() and scalar @{$mixer->filters()}) and
+                             not $mixer->properties->freeze_time);
+    say("INFO: " . $mixer->role() . " : Asynchronous execution requested but not possible " .
+        "because of validators, filters, freeze_time or more than one server.")
+        if $mixer->properties->property('async-execute') and not $mixer->[MIXER_ASYNC];
+
     say("INFO: " . $mixer->role() . " : Mixer created.");
     return $mixer;
 } # End sub new
@@ -206,9 +232,28 @@ sub next {
         }
     }
 
+    # DDL of the previous queries or of other threads might have created or dropped tables.
+    # Let the next queries be generated from the metadata of the schemas as they are now.
+    foreach my $ex (@$executors) {
+        next if not $ex->metaDataDirty() and not $ex->metaDataStale();
+        my $status = $ex->refreshSchemaMetaData();
+        if ($status != STATUS_OK) {
+            say("ERROR: $who_am_i refreshSchemaMetaData for $mixer_role failed with status $status.");
+            return $status;
+        }
+        $mixer->generator()->metaDataChanged();
+    }
+
     say("DEBUG: $who_am_i Before generating the next queries for $mixer_role") if $debug_here;
 
-    my $queries = $mixer->generator()->next($executors);
+    my $queries;
+    if (defined $mixer->[MIXER_NEXT_QUERIES]) {
+        # Generated while the last query of the previous batch was in flight.
+        ($queries) = @{$mixer->[MIXER_NEXT_QUERIES]};
+        $mixer->[MIXER_NEXT_QUERIES] = undef;
+    } else {
+        $queries = $mixer->generator()->next($executors);
+    }
     # For experimenting
     # $queries = undef;
     if (not defined $queries) {
@@ -220,8 +265,12 @@ sub next {
     # Note: Empty queries need to stay allowed because of sophisticated grammars and the simplifier.
 
     my $max_status = STATUS_OK;
+    # Rule coverage: The worst status of all statements executed. undef == nothing executed.
+    my $executed_status;
+    my $executed_err;
 
-    query: foreach my $query (@$queries) {
+    query: foreach my $query_no (0..$#$queries) {
+        my $query = $queries->[$query_no];
         # The check which follows here cannot prevent 100% that the reporter Deadlock could
         # mean to have detected a problem based on  "The duration was far way exceeded".
         # Reasons:
@@ -259,7 +308,19 @@ sub next {
         my $restart_timeout = $mixer->restart_timeout();
 
         EXECUTE_QUERY: foreach my $executor (@$executors) {
-            my $execution_result = $executor->execute($query);
+            my $execution_result;
+            # The generator must not see the outcome of the batch too late.
+            if ($mixer->[MIXER_ASYNC] and $query_no == $#$queries and
+                not defined $mixer->[MIXER_NEXT_QUERIES] and
+                $query !~ m{^\s*(?:CREATE|DROP|ALTER|RENAME)\b}si and
+                not $executor->metaDataDirty() and
+                not $mixer->generator()->wantsOutcome() and not rqg_debug()) {
+                $executor->executeAsync($query);
+                $mixer->[MIXER_NEXT_QUERIES] = [ $mixer->generator()->next($executors) ];
+                $execution_result = $executor->reap();
+            } else {
+                $execution_result = $executor->execute($query);
+            }
 
             if (not defined $execution_result) {
                 my $status = STATUS_INTERNAL_ERROR;
@@ -275,6 +336,10 @@ sub next {
                             "->$query<-.\n" . Basics::return_status_text($status));
                 return $status;
             }
+            if (not defined $executed_status or $result_status > $executed_status) {
+                $executed_status = $result_status;
+                $executed_err    = $execution_result->err();
+            }
             # If the server has crashed but we expect server restarts during the test,
             # we will wait and retry.
             if ($restart_timeout and
@@ -396,6 +461,8 @@ sub next {
                 # Set GENERATOR_RECONNECT to 1 so that the generator looks first for the "*_connect"
                 # rules if being asked for the next QUERY.
                 $mixer->generator()->setReconnect(1);
+                # A batch generated meanwhile does not start with the "*_connect" rules.
+                $mixer->[MIXER_NEXT_QUERIES] = undef;
                 # Take care that
                 # - the current query does not get executed on other servers
                 # - no remaining queries from QUERY or some validator get executed
@@ -460,6 +527,21 @@ sub next {
         }
     } # End of loop called "query"
 
+    if ($mixer->generator()->wantsOutcome()) {
+        my $outcome;
+        if      (not defined $executed_status) {
+            $outcome = 'not_executed';
+        } elsif (STATUS_OK == $executed_status) {
+            $outcome = 'ok';
+        } elsif (STATUS_SERVER_CRASHED == $executed_status or
+                 STATUS_SERVER_KILLED  == $executed_status) {
+            $outcome = 'crash';
+        } else {
+            $outcome = status2text($executed_status);
+        }
+        $mixer->generator()->registerOutcome($outcome, $executed_err);
+    }
+
     #
     # Record the lowest (best) status achieved for all participating rules. The goal
     # is for all rules to generate at least some STATUS_OK queries. If not, the offending
@@ -52,6 +52,7 @@ require Exporter;
 #use strict;
 
 use Carp;
+use Config;
 use GenTest_e;
 use Cwd;
 
@@ -76,12 +77,26 @@ Number Generator, see
 http://en.wikipedia.org/wiki/Linear_congruential_generator For
 efficiency, math is done in integer mode
 
+Alternatively (argument 'algorithm' or setDefaultAlgorithm) xoshiro256**
+can be used, see https://prng.di.unimi.it/ . It needs a perl with 64-bit
+integers. Every step delivers 64 bits which get consumed as four 16-bit
+values. Independent streams (one per worker thread) get derived from
+the same seed by jumping 2^128 steps ahead per stream number.
+The LCG stays the default so that historic seeds reproduce the same
+queries and data.
+
 =cut
 
 use constant RANDOM_SEED            => 0;
 use constant RANDOM_GENERATOR       => 1;
 use constant RANDOM_VARCHAR_LENGTH  => 2;
 use constant RANDOM_STRBUF          => 3;
+use constant RANDOM_ALGORITHM       => 4;   # undef == LCG
+use constant RANDOM_STREAM          => 5;
+use constant RANDOM_CHUNKS          => 6;   # xoshiro256**: 16-bit values not yet consumed
+
+use constant RANDOM_ALGORITHM_LCG      => 'lcg';
+use constant RANDOM_ALGORITHM_XOSHIRO  => 'xoshiro256';
 
 use constant FIELD_TYPE_NUMERIC     => 2;
 use constant FIELD_TYPE_STRING      => 3;
@@ -124,6 +139,12 @@ use constant ASCII_RANGE_END        => 122;
 
 use constant RANDOM_STRBUF_SIZE     => 1024;
 
+# Dictionary index (see dictionary)
+use constant DICT_CACHE_ENV         => 'RQG_DICT_CACHE';
+use constant DICT_INDEX_MAGIC       => 'RQGDICT1';
+use constant DICT_INDEX_HEADER      => 16;
+my $dict_cache_warning_emitted = 0;
+
 use constant JSON_STRUCT_OBJECT     => 0;
 use constant JSON_STRUCT_ARRAY      => 1;
 
@@ -201,6 +222,9 @@ my %name2type = (
 
 my $rqg_home = $ENV{'RQG_HOME'};
 
+# File::Map is optional. Without it the index gets read into one string.
+my $have_file_map = eval { require File::Map; 1 };
+
 # Min and max values for integer data types
 
 my %name2range = (
@@ -242,23 +266,50 @@ my %name2range = (
 
 my $prng_class;
 
+# The algorithm used if the caller of 'new' does not assign one.
+my $default_algorithm = RANDOM_ALGORITHM_LCG;
+
 1;
 
+sub setDefaultAlgorithm {
+# Return 1 if the algorithm is known and usable, 0 otherwise.
+    my ($algorithm) = @_;
+    return 0 if not is_algorithm($algorithm);
+    $default_algorithm = $algorithm;
+    return 1;
+}
+
+sub is_algorithm {
+    my ($algorithm) = @_;
+    return 0 if not defined $algorithm;
+    return 1 if $algorithm eq RANDOM_ALGORITHM_LCG;
+    return 1 if $algorithm eq RANDOM_ALGORITHM_XOSHIRO and $Config{ivsize} >= 8;
+    return 0;
+}
+
 sub new {
     my $class = shift;
 
     my $prng = $class->SUPER::new({
         'seed'              => RANDOM_SEED,
-        'varchar_length'    => RANDOM_VARCHAR_LENGTH
+        'varchar_length'    => RANDOM_VARCHAR_LENGTH,
+        'algorithm'         => RANDOM_ALGORITHM,
+        'stream'            => RANDOM_STREAM
     }, @_ );
 
+    my $algorithm = $prng->[RANDOM_ALGORITHM];
+    $algorithm    = $default_algorithm if not defined $algorithm;
+    if (not is_algorithm($algorithm)) {
+        Carp::cluck("WARN: The PRNG algorithm '$algorithm' is unknown or not supported by this " .
+                    "perl. Will use '" . RANDOM_ALGORITHM_LCG . "'.");
+        $algorithm = RANDOM_ALGORITHM_LCG;
+    }
+    $prng->[RANDOM_ALGORITHM] = ($algorithm eq RANDOM_ALGORITHM_LCG ? undef : $algorithm);
 
-    $prng->setSeed($prng->seed() > 0 ? $prng->seed() : 1);
+    $prng->setSeed($prng->seed() > 0 ? $prng->seed() : 1, $prng->[RANDOM_STREAM]);
 
 #   say("Initializing PRNG with seed '" . $prng->seed() . "' ...");
 
-    $prng->[RANDOM_GENERATOR] = $prng->seed();
-
     return $prng;
 }
 
@@ -266,9 +317,41 @@ sub seed {
     return $_[0]->[RANDOM_SEED];
 }
 
+sub algorithm {
+    return (defined $_[0]->[RANDOM_ALGORITHM] ? $_[0]->[RANDOM_ALGORITHM] : RANDOM_ALGORITHM_LCG);
+}
+
 sub setSeed {
-    $_[0]->[RANDOM_SEED] = $_[1];
-    $_[0]->[RANDOM_GENERATOR] = $_[1];
+# $_[2] is the optional number of the stream like the number of the worker thread.
+# The LCG uses seed + stream because historic seeds should reproduce.
+    my ($prng, $seed, $stream) = @_;
+    $stream = 0 if not defined $stream;
+    $prng->[RANDOM_STREAM] = $stream;
+    if (not defined $prng->[RANDOM_ALGORITHM]) {
+        $prng->[RANDOM_SEED]      = $seed + $stream;
+        $prng->[RANDOM_GENERATOR] = $seed + $stream;
+        return;
+    }
+    $prng->[RANDOM_SEED]   = $seed;
+    $prng->[RANDOM_CHUNKS] = [];
+    # The state gets initialized with splitmix64 like recommended by the authors.
+    # The 64-bit constants require a Perl with 64-bit integers.
+    no warnings 'portable';
+    my @state;
+    my $x = $seed;
+    foreach my $i (0..3) {
+        my $z;
+        {
+            use integer;
+            $x = $x + 0x9e3779b97f4a7c15;
+            $z = $x;
+        }
+        { use integer; $z = ($z ^ ($z >> 30 & 0x3FFFFFFFF)) * 0xbf58476d1ce4e5b9; }
+        { use integer; $z = ($z ^ ($z >> 27 & 0x1FFFFFFFFF)) * 0x94d049bb133111eb; }
+        push @state, $z ^ ($z >> 31);
+    }
+    $prng->[RANDOM_GENERATOR] = \@state;
+    $prng->jump() foreach (1..$stream);
 }
 
 sub update_generator {
@@ -278,11 +361,57 @@ sub update_generator {
     }
 }
 
+sub xoshiro_step {
+# Compute the next 64 bits of xoshiro256** and split them into four 16-bit values.
+# '>>' and '^' outside of 'use integer' work unsigned.
+    my $s = $_[0]->[RANDOM_GENERATOR];
+    my ($result, $x);
+    { use integer; $x = $s->[1] * 5; }
+    $x = ($x << 7) | ($x >> 57);
+    { use integer; $result = $x * 9; }
+    my $t = $s->[1] << 17;
+    $s->[2] ^= $s->[0];
+    $s->[3] ^= $s->[1];
+    $s->[1] ^= $s->[2];
+    $s->[0] ^= $s->[3];
+    $s->[2] ^= $t;
+    $s->[3] = ($s->[3] << 45) | ($s->[3] >> 19);
+    push @{$_[0]->[RANDOM_CHUNKS]}, $result >> 48, ($result >> 32) & 0xFFFF,
+                                    ($result >> 16) & 0xFFFF, $result & 0xFFFF;
+}
+
+sub jump {
+# Advance xoshiro256** by 2^128 steps. Gives 2^128 non overlapping streams.
+    my ($prng) = @_;
+    return if not defined $prng->[RANDOM_ALGORITHM];
+    my $s = $prng->[RANDOM_GENERATOR];
+    no warnings 'portable';
+    my @jump = (0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c);
+    my @new  = (0, 0, 0, 0);
+    foreach my $word (@jump) {
+        foreach my $bit (0..63) {
+            if ($word & (1 << $bit)) {
+                $new[$_] ^= $s->[$_] foreach (0..3);
+            }
+            xoshiro_step($prng);
+        }
+    }
+    @$s = @new;
+    $prng->[RANDOM_CHUNKS] = [];
+}
+
+sub next16 {
+# Unsigned 16-bit value of xoshiro256**.
+    xoshiro_step($_[0]) if not @{$_[0]->[RANDOM_CHUNKS]};
+    return shift @{$_[0]->[RANDOM_CHUNKS]};
+}
+
 ### Random unsigned integer. 16 bit on 32-bit platforms, 48 bit on
 ### 64-bit platforms. For internal use in Random.pm. Use int() or
 ### uint16() instead.
 sub urand {
     use integer;
+    return next16($_[0]) if defined $_[0]->[RANDOM_ALGORITHM];
     update_generator($_[0]);
     ## The lower bits are of bad statistical quality in an LCG, so we
     ## just use the higher bits.
@@ -304,6 +433,7 @@ sub urand {
 ### Random unsigned 16-bit integer
 sub uint16 {
     use integer;
+    return uint16_xoshiro(@_) if defined $_[0]->[RANDOM_ALGORITHM];
     # urand() is manually inlined for efficiency
     update_generator($_[0]);
     # When being called from somewhere like GendataAdvanced.pm I get masses of
@@ -322,11 +452,54 @@ sub uint16 {
         ((($_[0]->[RANDOM_GENERATOR] >> 15) & 0xFFFF) % ($_[2] - $_[1] + 1));
 }
 
+sub uint16_xoshiro {
+    use integer;
+    # next16() is manually inlined for efficiency
+    xoshiro_step($_[0]) if not @{$_[0]->[RANDOM_CHUNKS]};
+    my $rand = shift @{$_[0]->[RANDOM_CHUNKS]};
+    if (not defined $_[1]) {
+        Carp::cluck('WARN: Call of \'uint16\' with not defined parameter $_[1]. ' .
+                    'Will set it to 0.');
+        $_[1] = 0;
+    }
+    if (not defined $_[2]) {
+        Carp::cluck('WARN: Call of \'uint16\' with not defined parameter $_[2]. ' .
+                    'Will set it to 0.');
+        $_[2] = 0;
+    }
+    return $_[1] + ($rand % ($_[2] - $_[1] + 1));
+}
+
+### Reference to an array of $_[3] random unsigned 16-bit integers
+### between $_[1] and $_[2]. Same values like calling uint16 that often.
+sub uint16Array {
+    my ($prng, $min, $max, $count) = @_;
+    use integer;
+    my $range = $max - $min + 1;
+    my @values;
+    $#values = $count - 1;
+    if (defined $prng->[RANDOM_ALGORITHM]) {
+        my $chunks = $prng->[RANDOM_CHUNKS];
+        foreach my $i (0..$count - 1) {
+            xoshiro_step($prng) if not @$chunks;
+            $values[$i] = $min + (shift(@$chunks) % $range);
+        }
+    } else {
+        foreach my $i (0..$count - 1) {
+            $prng->[RANDOM_GENERATOR] = $prng->[RANDOM_GENERATOR] * 1103515245 + 12345;
+            $values[$i] = $min + ((($prng->[RANDOM_GENERATOR] >> 15) & 0xFFFF) % $range);
+        }
+    }
+    return \@values;
+}
+
 ### Signed 64-bit integer of any range.
 ### Slower, so use uint16 wherever possible.
 sub int {
     my $rand;
-    {
+    if (defined $_[0]->[RANDOM_ALGORITHM]) {
+        $rand = next16($_[0]);
+    } else {
         use integer;
         # urand() is manually inlined for efficiency
         update_generator($_[0]);
@@ -350,11 +523,15 @@ sub int {
 ### Signed 64-bit float of any range.
 sub float {
     my $rand;
-    # urand() is manually inlined for efficiency
-    update_generator($_[0]);
-    # Since this may be a 64-bit platform, we mask down to 16 bit
-    # to ensure the division below becomes correct.
-    $rand = ($_[0]->[RANDOM_GENERATOR] >> 15) & 0xFFFF;
+    if (defined $_[0]->[RANDOM_ALGORITHM]) {
+        $rand = next16($_[0]);
+    } else {
+        # urand() is manually inlined for efficiency
+        update_generator($_[0]);
+        # Since this may be a 64-bit platform, we mask down to 16 bit
+        # to ensure the division below becomes correct.
+        $rand = ($_[0]->[RANDOM_GENERATOR] >> 15) & 0xFFFF;
+    }
     if (not defined $_[1]) {
         Carp::cluck('WARN: Call of \'float\' with not defined parameter $_[1]. ' .
                     'Will set it to 0.');
@@ -368,6 +545,13 @@ sub float {
     return $_[1] + (($rand / 0x10000) * ($_[2] - $_[1] + 1));
 }
 
+### String of $_[1] random bytes between $_[2] and $_[3].
+sub bytes {
+    my ($prng, $count, $min, $max) = @_;
+    return '' if $count <= 0;
+    return pack('C*', @{$prng->uint16Array($min, $max, $count)});
+}
+
 sub digit {
     return $_[0]->uint16(0, 9);
 }
@@ -440,6 +624,14 @@ sub text {
     # If length is not defined, stick with the shortest text length
     $len = 255 unless defined $len;
     my $str = '';
+    # As long as the remainder is big enough that the next words fit for sure pick them in
+    # one call. This consumes the same random numbers like picking them one by one below.
+    my $dict      = $prng->dictionary('english');
+    my $max_chunk = $dict->{max_length} + 1;
+    while ($dict->{count} > 0 and $len - length($str) > $max_chunk) {
+        my $count = CORE::int(($len - length($str) - 1) / $max_chunk);
+        $str .= join(' ', dict_words($dict, $prng->uint16Array(0, $dict->{count} - 1, $count))) . ' ';
+    }
     while (my $remainder = $len - length($str)) {
         my $word= $prng->fromDictionary('english');
         if (length($word) < $remainder) {
@@ -473,7 +665,7 @@ sub string {
     # of the string.
 
     if (not defined $prng->[RANDOM_STRBUF]) {
-        $prng->[RANDOM_STRBUF] = join('', map{ chr($prng->uint16(ASCII_RANGE_START, ASCII_RANGE_END)) } (1..RANDOM_STRBUF_SIZE) );
+        $prng->[RANDOM_STRBUF] = $prng->bytes(RANDOM_STRBUF_SIZE, ASCII_RANGE_START, ASCII_RANGE_END);
     } else {
         $prng->[RANDOM_STRBUF] = substr($prng->[RANDOM_STRBUF], 1) . chr($prng->uint16(ASCII_RANGE_START, ASCII_RANGE_END));
     }
@@ -563,7 +755,8 @@ sub json_value {
     } elsif ($value_type == JSON_VALUE_STRING) {
         return '"' . $prng->string($prng->uint16(0,64)) . '"';
     } elsif ($value_type == JSON_VALUE_NUMBER) {
-        return $prng->int();
+        # Same value like the former int() which warned about the missing range every time.
+        return $prng->int(0, 0);
     } elsif ($value_type == JSON_VALUE_TRUE) {
         return 'true';
     } elsif ($value_type == JSON_VALUE_FALSE) {
@@ -585,9 +778,8 @@ sub json_pair {
     return '"'. $prng->json_key() . '": ' . $prng->json_value();
 }
 
-sub json_value_type {
-    my $prng = shift;
-    return $prng->arrayElement([
+# Built once instead of per call.
+my @json_value_types = (
         JSON_VALUE_OBJECT,
         JSON_VALUE_ARRAY,
         JSON_VALUE_STRING, JSON_VALUE_STRING, JSON_VALUE_STRING, JSON_VALUE_STRING, JSON_VALUE_STRING, JSON_VALUE_STRING,
@@ -597,7 +789,11 @@ sub json_value_type {
         JSON_VALUE_TRUE, JSON_VALUE_TRUE, JSON_VALUE_TRUE, JSON_VALUE_TRUE, JSON_VALUE_TRUE, JSON_VALUE_TRUE, JSON_VALUE_TRUE,
         JSON_VALUE_FALSE, JSON_VALUE_FALSE, JSON_VALUE_FALSE, JSON_VALUE_FALSE, JSON_VALUE_FALSE, JSON_VALUE_FALSE, JSON_VALUE_FALSE,
         JSON_VALUE_NULL, JSON_VALUE_NULL, JSON_VALUE_NULL, JSON_VALUE_NULL, JSON_VALUE_NULL, JSON_VALUE_NULL, JSON_VALUE_NULL
-    ]);
+);
+
+sub json_value_type {
+    my $prng = shift;
+    return $prng->arrayElement(\@json_value_types);
 }
 
 # For JSON Path, we'll use syntax from here:
@@ -771,19 +967,143 @@ sub isFieldType {
 
 sub fromDictionary {
     my ($rand, $dict_name) = @_;
+    my $dict = $rand->dictionary($dict_name);
+    ## To avoid mod zero-problems in uint16 (See Bug#45857)
+    return undef if $dict->{count} == 0;
+    return dict_word($dict, $rand->uint16(0, $dict->{count} - 1));
+}
+
+# Dictionary index
+# ----------------
+# The words of dict/<name>.txt get stored as one string
+#    DICT_INDEX_MAGIC, number of words, length of the longest word,
+#    number of words + 1 offsets of the words within the blob, the blob
+# So picking some word costs two vec + one substr and the memory is close to the size of the
+# file. The index gets written into $RQG_DICT_CACHE (default $TMPDIR/rqg_dict_cache_<uid>,
+# '' disables it) and loaded from there by all later processes. If File::Map is installed the
+# index file gets mapped and all processes of the box share the pages. Otherwise the pages get
+# at least shared between the RQG runner and its workers because preloadDictionaries runs
+# before they get forked.
+# The cache directory must be owned by the current user and have the mode 0700. Otherwise some
+# other user could plant index files. The cache is not used in that case.
+
+sub dict_index_file {
+# Return the name of the index file for the dictionary file or undef if the cache is disabled.
+    my ($dict_file) = @_;
+    my $cache_dir = $ENV{&DICT_CACHE_ENV};
+    if (not defined $cache_dir) {
+        $cache_dir = (defined $ENV{'TMPDIR'} ? $ENV{'TMPDIR'} : '/tmp') . "/rqg_dict_cache_$<";
+    }
+    return undef if $cache_dir eq '';
+    if (not -d $cache_dir) {
+        # Concurrent RQG runs might create the directory at the same time.
+        mkdir($cache_dir, 0700);
+        return undef if not -d $cache_dir;
+    }
+    my @dir_stat = lstat($cache_dir);
+    if (not @dir_stat or not -d _ or $dir_stat[4] != $< or ($dir_stat[2] & 07777) != 0700) {
+        say("WARN: The dictionary cache directory '$cache_dir' is not owned by the current " .
+            "user or has not the mode 0700. Dictionary caching is disabled.")
+            if not $dict_cache_warning_emitted++;
+        return undef;
+    }
+    my @stat = stat($dict_file);
+    return undef if not @stat;
+    my $key = $dict_file;
+    $key =~ s{[^A-Za-z0-9_.-]}{_}g;
+    return $cache_dir . "/" . $key . "." . $stat[7] . "." . $stat[9] . ".idx";
+}
+
+sub build_dict_index {
+    my ($dict_file) = @_;
+    open (DICT, $dict_file) or warn "# Unable to load $dict_file: $!";
+    my @dict_data = map { chop; $_ } <DICT>;
+    close DICT;
+    my $max_length = 0;
+    my @offsets    = (0);
+    foreach my $word (@dict_data) {
+        $max_length = length($word) if length($word) > $max_length;
+        push @offsets, $offsets[-1] + length($word);
+    }
+    return DICT_INDEX_MAGIC . pack('NN', scalar @dict_data, $max_length) . pack('N*', @offsets) .
+           join('', @dict_data);
+}
+
+sub dictionary {
+# Return the index of the dictionary.
+    my ($rand, $dict_name) = @_;
 
     if (not exists $dict_data{$dict_name}) {
         # We pick from our universe only and current position is most probably not the top of the universe.
         # my $dict_file = $rqg_home ne '' ? $rqg_home ."/dict/$dict_name.txt" : "dict/$dict_name.txt";
         my $dict_file = $rqg_home . "/dict/$dict_name.txt";
 
-        open (DICT, $dict_file) or warn "# Unable to load $dict_file: $!";
-        my @dict_data = map { chop; $_ } <DICT>;
-        close DICT;
-        $dict_data{$dict_name} = \@dict_data;
+        my $index_file = dict_index_file($dict_file);
+        my $data;
+        if (defined $index_file and -f $index_file) {
+            if ($have_file_map) {
+                undef $data if not eval { File::Map::map_file($data, $index_file, '<'); 1 };
+            } elsif (open(my $index_fh, '<:raw', $index_file)) {
+                local $/;
+                $data = <$index_fh>;
+                close($index_fh);
+            }
+            undef $data if defined $data and
+                           substr($data, 0, length(DICT_INDEX_MAGIC)) ne DICT_INDEX_MAGIC;
+        }
+        if (not defined $data) {
+            $data = build_dict_index($dict_file);
+            if (defined $index_file) {
+                # Concurrent RQG runs might write the same index. The rename is atomic.
+                my $index_tmp = $index_file . ".tmp" . $$;
+                my $index_fh;
+                if (open($index_fh, '>:raw', $index_tmp) and print $index_fh $data and
+                    close($index_fh)) {
+                    unlink($index_tmp) if not rename($index_tmp, $index_file);
+                } else {
+                    unlink($index_tmp);
+                }
+            }
+        }
+        my ($count, $max_length) = unpack('NN', substr($data, length(DICT_INDEX_MAGIC), 8));
+        $dict_data{$dict_name} = {
+            count      => $count,
+            max_length => $max_length,
+            base       => DICT_INDEX_HEADER + 4 * ($count + 1),
+            data       => \$data,
+        };
     }
 
-    return $rand->arrayElement($dict_data{$dict_name});
+    return $dict_data{$dict_name};
+}
+
+sub dict_word {
+# The offsets are 32-bit big endian and start at a multiple of 4, so vec reads them in place.
+    my ($dict, $id) = @_;
+    my $first = DICT_INDEX_HEADER / 4 + $id;
+    my $from  = vec(${$dict->{data}}, $first, 32);
+    return substr(${$dict->{data}}, $dict->{base} + $from, vec(${$dict->{data}}, $first + 1, 32) - $from);
+}
+
+sub dict_words {
+# The words for a list of ids. Same like dict_word but without a sub call per word, which
+# matters for bulk consumers like text().
+    my ($dict, $ids) = @_;
+    my $data  = $dict->{data};
+    my $base  = $dict->{base};
+    my $first = DICT_INDEX_HEADER / 4;
+    return map {
+        my $from = vec($$data, $first + $_, 32);
+        substr($$data, $base + $from, vec($$data, $first + $_ + 1, 32) - $from);
+    } @$ids;
+}
+
+sub preloadDictionaries {
+# Load the indexes of all dictionaries before forking workers.
+    foreach my $dict_file (glob($rqg_home . "/dict/*.txt")) {
+        my ($dict_name) = $dict_file =~ m{/([^/]+)\.txt$};
+        GenTest_e::Random->dictionary($dict_name);
+    }
 }
 
 sub shuffleArray {
@@ -22,6 +22,7 @@ require Exporter;
 @ISA = qw(GenTest_e);
 
 use strict;
+use Digest::MD5;
 use GenTest_e;
 
 use constant RESULT_QUERY          => 0;
@@ -41,6 +42,10 @@ use constant RESULT_INFO           => 13;
 use constant RESULT_COLUMN_TYPES   => 14;
 use constant RESULT_EXPLAIN        => 15;
 use constant RESULT_PERFORMANCE    => 16;
+use constant RESULT_DIGEST         => 17;
+
+# Number of rows of a result set fetched as digest which get kept for messages.
+use constant DIGEST_SAMPLE_ROWS    => 10;
 
 1;
 
@@ -63,7 +68,8 @@ sub new {
         'info'           => RESULT_INFO,
         'column_types'   => RESULT_COLUMN_TYPES,
         'explain'        => RESULT_EXPLAIN,
-        'performance'    => RESULT_PERFORMANCE
+        'performance'    => RESULT_PERFORMANCE,
+        'digest'         => RESULT_DIGEST
     }, @_);
 }
 
@@ -117,6 +123,8 @@ sub rows {
     my $result = shift;
     if (defined $result->[RESULT_DATA]) {
         return $#{$result->[RESULT_DATA]} + 1;
+    } elsif (defined $result->[RESULT_DIGEST]) {
+        return $result->[RESULT_DIGEST]->{rows};
     } else {
         return undef;
     }
@@ -158,4 +166,45 @@ sub performance {
     return $_[0]->[RESULT_PERFORMANCE];
 }
 
+sub digest {
+    return $_[0]->[RESULT_DIGEST];
+}
+
+# Result set digests
+# ------------------
+# Result sets fetched with EXECUTOR_FLAG_DIGEST_DATA have no data but a digest
+#    { rows => <number of rows>, sum => [ 4 x 32bit ], sample => [ first rows ] }
+# The MD5 of every row gets split into four 32bit words which get summed up modulo 2**32.
+# Hence equal multisets of rows have equal digests no matter in which order the rows come.
+
+sub newDigest {
+    return { rows => 0, sum => [ 0, 0, 0, 0 ], sample => [] };
+}
+
+sub addToDigest {
+    my ($digest, $row) = @_;
+    # The length prefix keeps ('a b', 'c') and ('a', 'b c') apart.
+    my $text = join('', map { defined $_ ? length($_) . ':' . $_ : 'N' } @$row);
+    utf8::encode($text) if utf8::is_utf8($text);
+    my @words = unpack('N4', Digest::MD5::md5($text));
+    my $sum   = $digest->{sum};
+    foreach my $i (0..3) {
+        $sum->[$i] = ($sum->[$i] + $words[$i]) % 4294967296;
+    }
+    push @{$digest->{sample}}, [ @$row ] if $digest->{rows} < DIGEST_SAMPLE_ROWS;
+    $digest->{rows}++;
+}
+
+sub digestOfData {
+    my ($data) = @_;
+    my $digest = newDigest();
+    addToDigest($digest, $_) foreach (@{$data || []});
+    return $digest;
+}
+
+sub digestText {
+    my ($digest) = @_;
+    return sprintf("%d:%08x%08x%08x%08x", $digest->{rows}, @{$digest->{sum}});
+}
+
 1;
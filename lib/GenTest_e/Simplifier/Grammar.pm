@@ -38,6 +38,7 @@ require Exporter;
     SIMP_EMPTY_QUERY
     SIMP_WAIT_EXIT_QUERY
     SIMP_EXIT_QUERY
+    SIMP_WEIGHT_TO_ONE
 );
 
 use utf8;
@@ -107,6 +108,9 @@ use constant SIMP_EMPTY_QUERY       => '';
 # The next line caused for a short timespan a lot trouble. AFAIR something with reporters.
 use constant SIMP_EXIT_QUERY        => '{ exit 0 }';
 use constant SIMP_WAIT_EXIT_QUERY   => '{ sleep 30 ; exit 0 }';
+# Orders with a component_string starting with SIMP_WEIGHT_TO_ONE shrink the weight
+# (/*+weight=<n>*/) of the component following that prefix to 1 instead of removing it.
+use constant SIMP_WEIGHT_TO_ONE     => '_weight_to_one_only:';
 
 # Structure for keeping the actual grammar
 #-----------------------------------------
@@ -338,6 +342,19 @@ sub get_unique_component_list {
 
 }
 
+sub get_weighted_component_list {
+# Return the unique components of the rule which have a weight other than 1.
+    my ($rule_name) = @_;
+
+    my $rule_obj   = $grammar_obj->rule($rule_name);
+    my $components = $rule_obj->components();
+    my %weighted;
+    foreach my $id (0..$#$components) {
+        $weighted{join('', @{$components->[$id]})} = 1 if 1 != $rule_obj->weight($id);
+    }
+    return grep { $weighted{$_} } $rule_obj->unique_components();
+}
+
 sub estimate_cut_steps {
 # Estimate the number of orders to be generated
 
@@ -348,6 +365,8 @@ sub estimate_cut_steps {
         my @rule_unique_component_list = $rule_obj->unique_components();
         my $count_add                  = scalar @rule_unique_component_list;
         $count_add-- if $simplify_mode eq SIMP_MODE_SOFT;
+        my @weighted_component_list    = get_weighted_component_list($rule_name);
+        $count_add += scalar @weighted_component_list;
         $count += $count_add;
         say("DEBUG: estimate_cut_steps: rule_name '$rule_name', count_add $count_add, " .
             "count_total $count") if $script_debug;
@@ -1529,6 +1548,9 @@ sub shrink_grammar {
 
     my ($rule_name, $component_string, $dtd_protection) = @_;
 
+    my $shrink_weight = (defined $component_string and
+                         $component_string =~ s{^\Q${\SIMP_WEIGHT_TO_ONE}\E}{}s) ? 1 : 0;
+
     # INTERNAL ERROR in case a parameter is undef.
     # Carp::confess is rude and ongoing RQG runs will be not stopped.
     # But that should be ok and after extreme short time fixed nearly for ever.
@@ -1555,8 +1577,32 @@ sub shrink_grammar {
     my $rule_obj          = $grammar_obj->rule($rule_name);
     my @unique_components = $rule_obj->unique_components();
 
+    my $components = $rule_obj->components();
+
     my $reduced_rule_string;
-    if ('_to_empty_string_only' ne $component_string) {
+    if ($shrink_weight) {
+        # Weighted component (/*+weight=<n>*/): generate_orders adds this order beside the one
+        # removing the component. So the weaker simplification gets tried in the same round.
+        my $found = 0;
+        foreach my $id (0..$#$components) {
+            $found = 1 if 1 != $rule_obj->weight($id) and
+                          join('', @{$components->[$id]}) eq $component_string;
+        }
+        if (not $found) {
+            say("DEBUG: shrink_grammar: The rule '$rule_name' is no more containing the " .
+                "component_string ->$component_string<- with some weight other than 1.")
+                if $script_debug;
+            return undef;
+        }
+        foreach my $id (0..$#$components) {
+            my $existing_component_string = join('', @{$components->[$id]});
+            push @reduced_components,
+                 ($existing_component_string eq $component_string ?
+                  '' : $rule_obj->weight_prefix($id)) . $existing_component_string;
+        }
+        say("DEBUG: shrink_grammar: Shrinking the weight of the component_string " .
+            "->$component_string<- in rule '$rule_name' to 1.") if $script_debug;
+    } elsif ('_to_empty_string_only' ne $component_string) {
         if ($simplify_mode eq SIMP_MODE_SOFT and 1 == scalar @unique_components) {
             say("DEBUG: shrink_grammar: The rule '$rule_name' has already only one unique " .
                 "component and mode is non destructive.") if $script_debug;
@@ -1631,12 +1677,12 @@ sub shrink_grammar {
         # So we can at least think about removing that component_string.
         # The rule exists, it contains $component_string and there are more than one unique components.
 
-        my $components = $rule_obj->components();
-        foreach my $component (@$components) {
-            my $existing_component_string = join('', @$component);
+        foreach my $id (0..$#$components) {
+            my $existing_component_string = join('', @{$components->[$id]});
             say("DEBUG: existing_component_string ->$existing_component_string<-") if $script_debug;
             if ($existing_component_string ne $component_string) {
-                push @reduced_components, $existing_component_string;
+                push @reduced_components,
+                     $rule_obj->weight_prefix($id) . $existing_component_string;
             }
         }
     } else {
@@ -1903,4 +1949,17 @@ sub use_clones_in_grammar {
 
 } # End sub use_clones_in_grammar
 
+sub checkpoint_state {
+# References to the variables which change during the grammar simplification. Needed for
+# resume after some death of rqg_batch.pl. See lib/Checkpoint.pm.
+    return {
+        grammar_obj   => \$grammar_obj,
+        rule_hash     => \%rule_hash,
+        threads       => \$threads,
+        grammar_flags => \$grammar_flags,
+        simplify_mode => \$simplify_mode,
+        clone_number  => \$clone_number,
+    };
+}
+
 1;
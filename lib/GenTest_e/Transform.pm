@@ -27,6 +27,7 @@ use strict;
 use lib 'lib';
 use GenTest_e;
 use GenTest_e::Constants;
+use GenTest_e::Comparator;
 use GenTest_e::Executor::MySQL;
 use Data::Dumper;
 
@@ -348,10 +349,7 @@ sub isDistinct {
     }
 
 
-    my $distinct_original = join ('<row>', sort keys %{$original_rows} );
-    my $distinct_transformed = join ('<row>', sort keys %{$transformed_rows} );
-
-    if ($distinct_original ne $distinct_transformed) {
+    if (not GenTest_e::Comparator::sameKeys($original_rows || {}, $transformed_rows || {})) {
         return STATUS_CONTENT_MISMATCH;
     } else {
         return STATUS_OK;
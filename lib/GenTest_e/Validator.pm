@@ -45,6 +45,12 @@ sub prerequisites {
     return undef;
 }
 
+# Validators which can work with result sets fetched as digest (EXECUTOR_FLAG_DIGEST_DATA)
+# instead of the rows return 1.
+sub acceptsDigest {
+    return 0;
+}
+
 sub dbh {
     return $_[0]->[VALIDATOR_DBH];
 }
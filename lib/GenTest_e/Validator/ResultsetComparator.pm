@@ -29,6 +29,10 @@ use GenTest_e::Comparator;
 use GenTest_e::Result;
 use GenTest_e::Validator;
 
+sub acceptsDigest {
+	return 1;
+}
+
 sub validate {
 	my ($comparator, $executors, $results) = @_;
 
@@ -46,6 +50,7 @@ sub validate {
 	     ($compare_outcome == STATUS_CONTENT_MISMATCH) 
 	) {
 		say("---------- RESULT COMPARISON ISSUE START ----------");
+		$results = GenTest_e::Comparator::materialize($executors, $results);
 	}
 
 	if ($compare_outcome == STATUS_LENGTH_MISMATCH) {
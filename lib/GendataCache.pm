@@ -0,0 +1,231 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+
+package GendataCache;
+
+# Purpose
+# -------
+# Store the data directory of the DB server as it is after the work phase GenData and a clean
+# shutdown. Later RQG runs with the same GenData relevant setup restore that snapshot instead of
+# running bootstrap + GenData again.
+#
+# Typical use case
+# ----------------
+# Simplifier or Combinator campaigns where hundreds of RQG runs use the same .zz/.sql files,
+# seed and server options. GenData of these runs delivers byte identical data.
+#
+# Layout within the cache directory
+# ---------------------------------
+# <gendata_cache>/<key>/data      -- copy of the data directory
+# <gendata_cache>/<key>/key.txt   -- the text from which <key> was computed (for humans)
+# <gendata_cache>/<key>.<pid>     -- snapshot under construction, renamed to <key> when complete
+# A snapshot directory <key> gets only created by rename and is therefore all time complete.
+#
+# Limitations
+# -----------
+# Only RQG runs with exact one DB server, no replication, no upgrade test, no start-dirty and
+# no config file template get supported.
+#
+
+use strict;
+use Digest::MD5;
+use File::Basename;
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+
+# The files in the data directory which must not get into the snapshot.
+use constant GENDATA_CACHE_EXCLUDE_PATTERN => '^(core.*|.*\.pid|.*\.err)$';
+
+our $gendata_cache;
+
+sub check_and_set_gendata_cache {
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- the directory does not exist and could not be created
+    ($gendata_cache) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (1 != scalar @_) {
+        my $status = STATUS_INTERNAL_ERROR;
+        Carp::cluck("INTERNAL ERROR: $who_am_i Exact one parameter(gendata_cache) needs to get " .
+                    "assigned. " . Basics::exit_status_text($status));
+        safe_exit($status);
+    }
+    if (not defined $gendata_cache) {
+        say("INFO: $who_am_i gendata_cache is not defined. No snapshots of GenData results.");
+        return STATUS_OK;
+    }
+    if ($gendata_cache eq '') {
+        say("ERROR: $who_am_i The value assigned to gendata_cache is ''.");
+        help();
+        $gendata_cache = undef;
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $gendata_cache = Basics::unify_path($gendata_cache);
+    if (not -d $gendata_cache) {
+        # Parallel RQG runs might try to create the directory at the same time.
+        mkdir $gendata_cache;
+        if (not -d $gendata_cache) {
+            say("ERROR: $who_am_i The directory '$gendata_cache' does not exist and could not " .
+                "be created : $!");
+            $gendata_cache = undef;
+            return STATUS_ENVIRONMENT_FAILURE;
+        }
+    }
+    say("INFO: $who_am_i Snapshots of GenData results are stored in '$gendata_cache'.");
+    return STATUS_OK;
+}
+
+sub get_gendata_cache {
+    return $gendata_cache;
+}
+
+sub compute_key {
+# Compute the key of the snapshot from everything which has an impact on the result of GenData.
+# The caller has to assign pairs of (name, value) where value is
+# - undef or a scalar
+# - a reference to an array of scalars
+# Values starting with 'file:' are names of files and the content of these files gets used.
+#
+# Return values
+# - success  (key, text the key was computed from)
+# - failure  undef
+    my (%parameters) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $key_text = '';
+    foreach my $name (sort keys %parameters) {
+        my $value = $parameters{$name};
+        my @values;
+        if (not defined $value) {
+            @values = ('<undef>');
+        } elsif (ref $value eq 'ARRAY') {
+            @values = map { defined $_ ? $_ : '<undef>' } @$value;
+        } else {
+            @values = ($value);
+        }
+        foreach my $val (@values) {
+            if ($val =~ m{^file:(.*)$}) {
+                my $file = $1;
+                if (not open(CACHE_KEY_FILE, '<', $file)) {
+                    say("ERROR: $who_am_i Open file '$file' failed : $!");
+                    return undef;
+                }
+                binmode CACHE_KEY_FILE;
+                my $md5 = Digest::MD5->new;
+                $md5->addfile(*CACHE_KEY_FILE);
+                close(CACHE_KEY_FILE);
+                $val = $file . ' md5:' . $md5->hexdigest;
+            }
+            $key_text .= $name . ' : ' . $val . "\n";
+        }
+    }
+    return Digest::MD5::md5_hex($key_text), $key_text;
+}
+
+sub snapshot_exists {
+    my ($key) = @_;
+    return 0 if not defined $gendata_cache;
+    return (-d $gendata_cache . "/" . $key . "/data") ? 1 : 0;
+}
+
+sub restore_snapshot {
+# Copy the content of the snapshot into the already existing and empty data directory.
+# Reflink clones get used if the filesystem supports them. Otherwise its an ordinary copy.
+#
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- no snapshot or copy failed
+    my ($key, $datadir) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (not snapshot_exists($key)) {
+        say("ERROR: $who_am_i There is no snapshot for key '$key'.");
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    my $snapshot = $gendata_cache . "/" . $key . "/data";
+    my $cmd = "cp -a --reflink=auto $snapshot/. $datadir/ 2>&1";
+    my ($status, $output) = Auxiliary::run_cmd($cmd);
+    if (STATUS_OK != $status) {
+        say("ERROR: $who_am_i Restoring the snapshot '$snapshot' into '$datadir' failed.");
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    say("INFO: $who_am_i GenData result restored from snapshot '$snapshot'.");
+    return STATUS_OK;
+}
+
+sub store_snapshot {
+# Copy the content of the data directory of the already stopped DB server into the cache.
+#
+# Return values
+# STATUS_OK                  -- success or some concurrent RQG run was faster
+# STATUS_ENVIRONMENT_FAILURE -- copy failed, the RQG run could go on anyway
+    my ($key, $key_text, $datadir) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    if (snapshot_exists($key)) {
+        say("INFO: $who_am_i Snapshot for key '$key' exists already.");
+        return STATUS_OK;
+    }
+    my $snapshot     = $gendata_cache . "/" . $key;
+    my $snapshot_tmp = $snapshot . "." . $$;
+    if (STATUS_OK != Basics::conditional_remove__make_dir($snapshot_tmp)) {
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    my $cmd = "cp -a --reflink=auto $datadir/. $snapshot_tmp/data 2>&1";
+    my ($status, $output) = Auxiliary::run_cmd($cmd);
+    if (STATUS_OK != $status) {
+        say("ERROR: $who_am_i Copying '$datadir' to '$snapshot_tmp/data' failed.");
+        Basics::conditional_remove_dir($snapshot_tmp);
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    my $exclude_pattern = GENDATA_CACHE_EXCLUDE_PATTERN;
+    if (opendir(SNAPSHOT_DIR, $snapshot_tmp . "/data")) {
+        foreach my $file (readdir(SNAPSHOT_DIR)) {
+            unlink($snapshot_tmp . "/data/" . $file) if $file =~ m{$exclude_pattern};
+        }
+        closedir(SNAPSHOT_DIR);
+    }
+    if (STATUS_OK != Basics::make_file($snapshot_tmp . "/key.txt", $key_text)) {
+        Basics::conditional_remove_dir($snapshot_tmp);
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    # rename is atomic. In case some concurrent RQG run has stored the same snapshot in between
+    # than the rename fails and we throw our copy away.
+    if (not rename($snapshot_tmp, $snapshot)) {
+        say("INFO: $who_am_i Snapshot for key '$key' was stored by some concurrent RQG run.");
+        Basics::conditional_remove_dir($snapshot_tmp);
+        return STATUS_OK;
+    }
+    say("INFO: $who_am_i GenData result stored as snapshot '$snapshot'.");
+    return STATUS_OK;
+}
+
+sub help {
+    print("\nHELP about the RQG run option 'gendata_cache'.\n"                                     .
+          "--gendata_cache=<directory>\n"                                                         .
+          "    Keep snapshots of the data directory after the work phase GenData in <directory>.\n" .
+          "    RQG runs with the same GenData relevant setup (grammar independent!) restore the\n" .
+          "    snapshot instead of running bootstrap and GenData.\n"                              .
+          "    Supported only for RQG runs with one DB server and without replication, upgrade\n"  .
+          "    test, start-dirty or config file template.\n"                                      .
+          "    The directory should be on a filesystem supporting reflinks (XFS, Btrfs).\n"        .
+          "    Removing outdated snapshots is the job of the user.\n");
+}
+
+1;
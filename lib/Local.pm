@@ -306,7 +306,9 @@ sub check_and_set_local_config {
                 safe_exit($status);
             }
         } elsif (1 == $batch) {
-            $build_thread = $build_thread + $minor_runid - 1;
+            # rqg_batch_agent.pl uses agent_<number of the RQG worker>.
+            my ($worker_number) = $minor_runid =~ m{([0-9]+)$};
+            $build_thread = $build_thread + $worker_number - 1;
             check_dir($results_dir);
         } else {
             check_dir($results_dir);
@@ -0,0 +1,207 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+
+package PhaseTimes;
+
+# Purpose
+# -------
+# Aggregate where the box-hours of some rqg_batch.pl campaign went to.
+# Auxiliary::set_rqg_phase appends every phase change of a RQG run with timestamp and CPU time
+# consumed by the process group of the RQG worker to <RQG workdir>/rqg_phase.times.
+# When the RQG worker is reaped (Batch::handle_finished_worker) these records get
+# - summed up per phase and per order
+# - appended as events to the timeline of the campaign
+#
+# Files within the workdir of the rqg_batch.pl run
+# ------------------------------------------------
+# timeline.json   -- Chrome trace event format (JSON array). Load it into chrome://tracing or
+#                    https://ui.perfetto.dev. One track per RQG worker, one slice per phase.
+#                    The closing ']' gets only written at campaign end. Both viewers accept
+#                    the file without it.
+# phase_times.txt -- Wall clock and CPU time per phase and per order. Written at campaign end.
+#
+# Limitations
+# -----------
+# - CPU time of processes which were not reaped by some member of the process group is lost.
+#   Example: DB server killed with SIGKILL by rqg_batch.pl.
+# - RQG runs performed by some agent (BatchAgent.pm) report the CPU time of the RQG worker only.
+#
+
+use strict;
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+
+use constant PHASE_TIMELINE_FILE => 'timeline.json';
+use constant PHASE_SUMMARY_FILE  => 'phase_times.txt';
+
+my $timeline_file;
+my $summary_file;
+
+# phase -> [ wall clock seconds, CPU seconds, number of RQG runs ]
+my %phase_hash;
+# order id -> phase -> [ wall clock seconds, CPU seconds ]
+my %order_phase_hash;
+# order id -> number of RQG runs
+my %order_runs_hash;
+
+sub init {
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- the timeline file could not be created
+    my ($workdir, $resume) = @_;
+
+    $timeline_file = $workdir . "/" . PHASE_TIMELINE_FILE;
+    $summary_file  = $workdir . "/" . PHASE_SUMMARY_FILE;
+    if (not $resume or not -f $timeline_file) {
+        return STATUS_ENVIRONMENT_FAILURE if STATUS_OK != Basics::make_file($timeline_file, "[\n");
+    }
+    return STATUS_OK;
+}
+
+sub checkpoint_state {
+    return {
+        phase_hash       => \%phase_hash,
+        order_phase_hash => \%order_phase_hash,
+        order_runs_hash  => \%order_runs_hash,
+    };
+}
+
+sub read_phase_times {
+# Return a list of [ phase, timestamp, CPU seconds ] or an empty list.
+    my ($rqg_workdir) = @_;
+
+    my @records;
+    my $file = $rqg_workdir . "/" . Auxiliary::RQG_PHASE_TIMES_FILE;
+    return @records if not open(PHASE_TIMES, '<', $file);
+    while (my $line = <PHASE_TIMES>) {
+        next if $line !~ m{^(\S+) ([0-9.]+) ([0-9.]+)$};
+        push @records, [ $1, $2, $3 ];
+    }
+    close(PHASE_TIMES);
+    return @records;
+}
+
+sub account_run {
+# Add the phases of some finished RQG run to the sums and to the timeline.
+# The last phase which is not 'complete' (RQG run stopped or died) ends at $end_time.
+# Return the point of time when the RQG runner reached the phase 'finished' or undef.
+    my ($worker_num, $order_id, $run_number, $verdict, $rqg_workdir, $end_time) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my @records = read_phase_times($rqg_workdir);
+    return undef if 0 == scalar @records;
+
+    $order_id = '<undef>' if not defined $order_id;
+    $order_runs_hash{$order_id}++;
+    my $events = '';
+    my $finished_time;
+    for my $i (0..$#records) {
+        my ($phase, $begin, $cpu_begin) = @{$records[$i]};
+        last if $phase eq Auxiliary::RQG_PHASE_COMPLETE;
+        $finished_time = $begin if $phase eq Auxiliary::RQG_PHASE_FINISHED;
+        my ($end, $cpu_end) = ($end_time, $cpu_begin);
+        if ($i < $#records) {
+            (undef, $end, $cpu_end) = @{$records[$i + 1]};
+        }
+        my $wall = $end - $begin;
+        $wall    = 0 if $wall < 0;
+        # Reaped processes move their CPU time to the parent. Killed ones make it disappear.
+        my $cpu  = $cpu_end - $cpu_begin;
+        $cpu     = 0 if $cpu < 0;
+
+        $phase_hash{$phase} = [0, 0, 0] if not exists $phase_hash{$phase};
+        $phase_hash{$phase}->[0] += $wall;
+        $phase_hash{$phase}->[1] += $cpu;
+        $phase_hash{$phase}->[2]++;
+        $order_phase_hash{$order_id}{$phase} = [0, 0]
+            if not exists $order_phase_hash{$order_id}{$phase};
+        $order_phase_hash{$order_id}{$phase}->[0] += $wall;
+        $order_phase_hash{$order_id}{$phase}->[1] += $cpu;
+
+        $events .= sprintf('{"name":"%s","cat":"rqg","ph":"X","ts":%d,"dur":%d,"pid":1,' .
+                           '"tid":%d,"args":{"run":"%s","order":"%s","verdict":"%s",'   .
+                           '"cpu_s":%.2f}},' . "\n",
+                           $phase, $begin * 1000000, $wall * 1000000, $worker_num,
+                           $run_number, $order_id, $verdict, $cpu);
+    }
+    if (STATUS_OK != Basics::append_string_to_file($timeline_file, $events)) {
+        say("WARN: $who_am_i Appending to '$timeline_file' failed.");
+    }
+    return $finished_time;
+}
+
+sub phase_order {
+# The phases in the order of their occurence.
+    my @phases;
+    foreach my $phase (@{&Auxiliary::RQG_PHASE_ALLOWED_VALUE_LIST}) {
+        push @phases, $phase if exists $phase_hash{$phase};
+    }
+    return @phases;
+}
+
+sub summary {
+# Return the table wall clock and CPU time per phase.
+    my $total_wall = 0;
+    foreach my $phase (keys %phase_hash) {
+        $total_wall += $phase_hash{$phase}->[0];
+    }
+    my $text = "STATISTICS: " . Basics::rfill('Phase', 15) . Basics::lfill('Wall (h)', 10) .
+               Basics::lfill('Wall %', 8) . Basics::lfill('CPU (h)', 10) .
+               Basics::lfill('CPU/Wall', 10) . Basics::lfill('Runs', 8) . "\n";
+    foreach my $phase (phase_order()) {
+        my ($wall, $cpu, $runs) = @{$phase_hash{$phase}};
+        $text .= "STATISTICS: " . Basics::rfill($phase, 15)                                   .
+                 Basics::lfill(sprintf("%.2f", $wall / 3600), 10)                            .
+                 Basics::lfill(sprintf("%.1f", $total_wall ? 100 * $wall / $total_wall : 0), 8) .
+                 Basics::lfill(sprintf("%.2f", $cpu / 3600), 10)                             .
+                 Basics::lfill(sprintf("%.2f", $wall ? $cpu / $wall : 0), 10)                 .
+                 Basics::lfill($runs, 8) . "\n";
+    }
+    return $text;
+}
+
+sub finish {
+# Close the timeline and write the summary file which has in addition the times per order.
+    my $who_am_i = Basics::who_am_i;
+
+    Basics::append_string_to_file($timeline_file,
+        '{"name":"process_name","ph":"M","pid":1,"args":{"name":"rqg_batch.pl"}}' . "\n]\n");
+
+    my @phases = phase_order();
+    my $text = summary() . "\n" .
+               "Wall clock / CPU time in s per order\n" .
+               Basics::rfill('OrderId', 9) . Basics::lfill('Runs', 6);
+    foreach my $phase (@phases) {
+        $text .= Basics::lfill($phase, 18);
+    }
+    $text .= "\n";
+    foreach my $order_id (sort { $a <=> $b } grep { /^[0-9]+$/ } keys %order_runs_hash) {
+        $text .= Basics::rfill($order_id, 9) . Basics::lfill($order_runs_hash{$order_id}, 6);
+        foreach my $phase (@phases) {
+            my $value = $order_phase_hash{$order_id}{$phase};
+            $text .= Basics::lfill(defined $value ?
+                                   sprintf("%d/%d", $value->[0], $value->[1]) : '-', 18);
+        }
+        $text .= "\n";
+    }
+    if (STATUS_OK != Basics::make_file($summary_file, $text)) {
+        say("WARN: $who_am_i Writing '$summary_file' failed.");
+    }
+}
+
+1;
@@ -0,0 +1,314 @@
+#  Copyright (c) 2026 MariaDB plc
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; version 2 of the License.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#
+
+package RRTraces;
+
+# Purpose
+# -------
+# Get the rr traces of RQG runs performed by rqg_batch.pl as fast as possible off the fast
+# storage (usually tmpfs) and into their final shape.
+#
+# Pipeline
+# --------
+# 1. The RQG worker renames the rr trace directories <fast dir>/<worker>/<server>/rr into the
+#    spool <fast dir>/rr_spool immediate after the RQG runner exited. Renaming within the same
+#    filesystem costs nothing. The names of the spooled traces get written into RR_SPOOL_FILE
+#    within the RQG workdir.
+# 2. rqg_batch.pl detects the new trace in the spool and moves it to <slow dir>/rr_spool.
+#    This does not wait for the verdict or the archiving by the RQG worker.
+# 3. rqg_batch.pl learns the final verdict of the RQG run when reaping the RQG worker.
+#    - Verdict ignore_* (or similar) -> The trace gets dropped wherever it is.
+#    - Verdict interest or replay    -> 'rr pack' makes the trace self contained, the trace gets
+#      compressed into <RQG workdir>/<server>/rr.tar.zst (zstd) or rr.tar.xz and the spooled
+#      trace gets removed.
+#      This step waits till asynchronous archiving (Archiver.pm) of the RQG run has finished and
+#      ResourceControl reports no lack of resources.
+# The steps 2. and 3. run as child processes of rqg_batch.pl with nice 19 and (if 'ionice' is
+# installed) idle IO priority. At most rr_jobs of them at the same time.
+#
+# Replay of some compressed trace
+# -------------------------------
+#     mkdir /tmp/trace ; zstd -dc <RQG workdir>/1/rr.tar.zst | tar -xf - -C /tmp/trace
+#     _RR_TRACE_DIR=/tmp/trace rr replay
+#
+# Limitations
+# -----------
+# Spooled traces of some rqg_batch.pl run which died are not picked up by --resume.
+#
+
+use strict;
+use File::Basename;
+use File::Path;
+use POSIX ":sys_wait_h";
+use GenTest_e;
+use GenTest_e::Constants;
+use Auxiliary;
+use Basics;
+use Local;
+use Verdict;
+use ResourceControl;
+use Archiver;
+
+use constant RR_SPOOL_DIR      => 'rr_spool';
+use constant RR_SPOOL_FILE     => 'rqg_rr.spool';
+use constant RR_PACK_LOG       => 'rqg_rr_pack.log';
+use constant RR_JOBS_DEFAULT   => 2;
+
+# Where the spooled trace is.
+use constant TRACE_FAST        => 'fast';
+use constant TRACE_MOVING      => 'moving';
+use constant TRACE_SLOW        => 'slow';
+use constant TRACE_PACKING     => 'packing';
+
+my $fast_spool;
+my $slow_spool;
+my $rr_jobs;
+my $ionice;
+my $compressor;
+my $suffix;
+
+# name of the spooled trace -> { state, verdict, target, server }
+my %trace_hash;
+# pid of some child -> name of the spooled trace
+my %job_hash;
+
+sub check_and_set_rr_traces {
+# Return values
+# STATUS_OK                  -- success
+# STATUS_ENVIRONMENT_FAILURE -- wrong value assigned or spool not creatable
+    my ($jobs) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    $jobs = RR_JOBS_DEFAULT if not defined $jobs;
+    if ($jobs !~ m{^[1-9][0-9]*$}) {
+        say("ERROR: $who_am_i The value '$jobs' assigned to rr_jobs is not a positive integer.");
+        help();
+        return STATUS_ENVIRONMENT_FAILURE;
+    }
+    $rr_jobs    = $jobs;
+    $fast_spool = Local::get_rqg_fast_dir() . "/" . RR_SPOOL_DIR;
+    $slow_spool = Local::get_rqg_slow_dir() . "/" . RR_SPOOL_DIR;
+    foreach my $dir ($fast_spool, $slow_spool) {
+        return STATUS_ENVIRONMENT_FAILURE if STATUS_OK != Basics::conditional_make_dir($dir);
+    }
+    # find_external_command would complain loud.
+    $ionice = (system("which ionice >/dev/null 2>&1") == 0) ? 1 : 0;
+    if (system("which zstd >/dev/null 2>&1") == 0) {
+        ($compressor, $suffix) = ('zstd -q -3 -T1', 'tar.zst');
+    } else {
+        ($compressor, $suffix) = ('xz -0 --threads=1', 'tar.xz');
+    }
+    say("INFO: $who_am_i rr traces get spooled in '$fast_spool' and '$slow_spool'. " .
+        "Kept traces get compressed to rr.$suffix. rr_jobs $rr_jobs.");
+    return STATUS_OK;
+}
+
+sub is_enabled {
+    return defined $fast_spool ? 1 : 0;
+}
+
+sub spool {
+# Called by the RQG worker immediate after the RQG runner exited.
+# Return values
+# STATUS_OK      -- Success
+# STATUS_FAILURE -- No success
+    my ($rqg_workdir, $worker_num) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $entries = '';
+    foreach my $trace (sort glob(Local::get_rqg_fast_dir() . "/$worker_num/*/rr")) {
+        next if -l $trace or not -d $trace;
+        my $server = File::Basename::basename(File::Basename::dirname($trace));
+        my $name   = $worker_num . "_" . $server . "_" . $$;
+        if (not rename($trace, $fast_spool . "/" . $name)) {
+            say("ERROR: $who_am_i Renaming '$trace' to '$fast_spool/$name' failed : $!");
+            return STATUS_FAILURE;
+        }
+        $entries .= $name . "\t" . $server . "\n";
+    }
+    return STATUS_OK if $entries eq '';
+    return Basics::make_file($rqg_workdir . "/" . RR_SPOOL_FILE, $entries);
+}
+
+sub register {
+# Called by rqg_batch.pl when reaping the RQG worker. Must happen before $rqg_workdir gets
+# moved or dropped.
+    my ($rqg_workdir, $verdict, $target) = @_;
+
+    my $spool_file = $rqg_workdir . "/" . RR_SPOOL_FILE;
+    return if not open(SPOOL_FILE, '<', $spool_file);
+    while (my $line = <SPOOL_FILE>) {
+        chomp $line;
+        my ($name, $server) = split(/\t/, $line);
+        next if not defined $server;
+        $trace_hash{$name} = { state => TRACE_FAST } if not exists $trace_hash{$name};
+        $trace_hash{$name}->{verdict} = $verdict;
+        $trace_hash{$name}->{target}  = $target;
+        $trace_hash{$name}->{server}  = $server;
+    }
+    close(SPOOL_FILE);
+    unlink($spool_file);
+}
+
+sub keep_trace {
+    my ($verdict) = @_;
+    return ($verdict eq Verdict::RQG_VERDICT_INTEREST or
+            $verdict eq Verdict::RQG_VERDICT_REPLAY) ? 1 : 0;
+}
+
+sub resources_ok {
+    my $load_status = ResourceControl::get_readings()->{load_status};
+    return (not defined $load_status or $load_status eq ResourceControl::LOAD_INCREASE() or
+            $load_status eq ResourceControl::LOAD_KEEP()) ? 1 : 0;
+}
+
+sub start_job {
+    my ($name, $state, $code) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    my $pid = fork();
+    if (not defined $pid) {
+        say("ERROR: $who_am_i fork failed : $!. Will try later.");
+        return;
+    }
+    if (0 == $pid) {
+        setpgrp(0,0);
+        setpriority(0, 0, 19);
+        system("ionice -c 3 -p $$") if $ionice;
+        safe_exit($code->());
+    }
+    $job_hash{$pid} = $name;
+    $trace_hash{$name}->{state} = $state;
+}
+
+sub move_job {
+    my ($name) = @_;
+    return Basics::move_dir_to_newdir($fast_spool . "/" . $name, $slow_spool . "/" . $name);
+}
+
+sub pack_job {
+    my ($name) = @_;
+    my $who_am_i = "RRTraces [$name]:";
+
+    my $trace      = $slow_spool . "/" . $name;
+    my $target     = $trace_hash{$name}->{target};
+    my $target_dir = $target . "/" . $trace_hash{$name}->{server};
+    my $log        = $target . "/" . RR_PACK_LOG;
+    return STATUS_FAILURE if STATUS_OK != Basics::conditional_make_dir($target_dir);
+    # Every subdirectory with a 'version' file is a trace. 'latest-trace' is a symlink.
+    foreach my $dir (sort glob($trace . "/*")) {
+        next if -l $dir or not -f $dir . "/version";
+        system("rr pack $dir >>$log 2>&1");
+        say("WARN: $who_am_i 'rr pack $dir' failed. Keeping the trace unpacked.") if $?;
+    }
+    my $archive = $target_dir . "/rr." . $suffix;
+    system("tar --create --file - -C $trace . 2>>$log | $compressor > $archive 2>>$log");
+    if ($? >> 8) {
+        say("ERROR: $who_am_i Compressing into '$archive' failed. Moving the trace " .
+            "uncompressed.");
+        unlink($archive);
+        return Basics::move_dir_to_newdir($trace, $target_dir . "/rr");
+    }
+    File::Path::rmtree($trace);
+    return STATUS_OK;
+}
+
+sub drop {
+    my ($name) = @_;
+    my $state = $trace_hash{$name}->{state};
+    File::Path::rmtree(($state eq TRACE_FAST ? $fast_spool : $slow_spool) . "/" . $name);
+    delete $trace_hash{$name};
+}
+
+sub poll {
+# To be called in the main loops of rqg_batch.pl.
+# $force: Ignore lack of resources and drop traces nobody registered (end of rqg_batch.pl).
+    my ($force) = @_;
+    my $who_am_i = Basics::who_am_i;
+
+    return if not is_enabled();
+    foreach my $pid (keys %job_hash) {
+        next if $pid != waitpid($pid, WNOHANG);
+        my $exit_status = $? >> 8;
+        my $name = delete $job_hash{$pid};
+        my $state = $trace_hash{$name}->{state};
+        if ($exit_status) {
+            say("WARN: $who_am_i Processing the rr trace '$name' ($state) failed. The remainings " .
+                "get kept for manual inspection.");
+            delete $trace_hash{$name};
+        } elsif ($state eq TRACE_MOVING) {
+            $trace_hash{$name}->{state} = TRACE_SLOW;
+        } else {
+            delete $trace_hash{$name};
+        }
+    }
+    if (opendir(SPOOL, $fast_spool)) {
+        foreach my $name (readdir(SPOOL)) {
+            next if $name eq '.' or $name eq '..' or exists $trace_hash{$name};
+            $trace_hash{$name} = { state => TRACE_FAST };
+        }
+        closedir(SPOOL);
+    }
+    foreach my $name (sort keys %trace_hash) {
+        my $trace   = $trace_hash{$name};
+        my $state   = $trace->{state};
+        next if $state eq TRACE_MOVING or $state eq TRACE_PACKING;
+        my $verdict = $trace->{verdict};
+        # All RQG workers are reaped when $force is set. So a missing verdict means orphan.
+        if ((defined $verdict and not keep_trace($verdict)) or ($force and not defined $verdict)) {
+            drop($name);
+            next;
+        }
+        next if $rr_jobs <= scalar keys %job_hash;
+        if ($state eq TRACE_FAST) {
+            # Getting the trace off the fast storage has priority and ignores the resources.
+            start_job($name, TRACE_MOVING, sub { move_job($name) });
+        } elsif (defined $verdict and ($force or resources_ok()) and
+                 not -e $trace->{target} . "/" . Archiver::ARCHIVE_PENDING) {
+            start_job($name, TRACE_PACKING, sub { pack_job($name) });
+        }
+    }
+}
+
+sub count_pending {
+    return scalar keys %trace_hash;
+}
+
+sub drain {
+# Wait till all spooled traces are processed. To be called at the end of rqg_batch.pl after
+# all RQG workers were reaped and Archiver::drain.
+    my $who_am_i = Basics::who_am_i;
+    return if not is_enabled();
+    say("INFO: $who_am_i Waiting for the processing of " . count_pending() . " rr traces.")
+        if count_pending();
+    while (count_pending()) {
+        poll(1);
+        sleep 1 if count_pending();
+    }
+}
+
+sub help {
+    print("\nHELP about the rqg_batch.pl option 'rr_jobs'.\n"                                       .
+          "--rr_jobs=<n>\n"                                                                      .
+          "    Maximum number of background processes which move rr traces from the fast to\n"    .
+          "    the slow dir, run 'rr pack' and compress the traces of RQG runs with the verdict\n" .
+          "    '" . Verdict::RQG_VERDICT_INTEREST . "' or '" . Verdict::RQG_VERDICT_REPLAY        .
+          "' into <RQG workdir>/<server>/rr.tar.zst (rr.tar.xz if zstd\n"                          .
+          "    is not installed). Traces of other RQG runs get dropped.\n"                       .
+          "    (Default) " . RR_JOBS_DEFAULT . "\n");
+}
+
+1;
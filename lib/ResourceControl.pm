@@ -970,6 +970,31 @@ sub ask_tool {
     system("ps -elf");
 }
 
+sub get_readings {
+# Return the values of the last measurement. Values not measured yet are undef.
+# Sizes are in MB, CPU and filesystem usage in %.
+    return {
+        load_status         => $load_status,
+        load_count          => $load_count,
+        load_increase_count => $load_increase_count,
+        load_keep_count     => $load_keep_count,
+        load_decrease_count => $load_decrease_count,
+        mem_total           => $mem_total,
+        mem_est_free        => $mem_est_free,
+        swap_total          => $swap_total,
+        swap_used           => $swap_used,
+        vardir_free         => $vardir_free,
+        vardir_percent      => $vardir_percent,
+        slowdir_free        => $slowdir_free,
+        slowdir_percent     => $slowdir_percent,
+        workdir_free        => $workdir_free,
+        cpu_idle            => $cpu_idle,
+        cpu_iowait          => $cpu_iowait,
+        cpu_system          => $cpu_system,
+        cpu_user            => $cpu_user,
+    };
+}
+
 sub print_statistics {
     $min_keep_worker =     "<undef>" if not defined $min_keep_worker;
     $min_decrease_worker = "<undef>" if not defined $min_decrease_worker;
@@ -1233,6 +1233,52 @@ $verdict_setup
 
 } # End sub init
 
+# The grammar string analyzed last, the strings of its rules and the rules where every
+# expansion is endless.
+my $analyzed_grammar_string = '';
+my %parent_rule_string_hash;
+my %endless_rule_hash;
+sub grammar_terminates {
+# Return 0 if the child grammar has endless rules which are not endless in the parent grammar.
+# Otherwise 1.
+# The child grammar is the parent grammar with its rules replaced by the rule strings in
+# %$redefine_hash (rule name -> rule string). The rules get merged before parsing because
+# parsing the parent grammar string with the redefines appended warns about every rule
+# being defined twice.
+# Rules being already endless in the parent do not count. They might be rare used and the RQG
+# runs with the parent grammar replay nevertheless.
+    my ($redefine_hash) = @_;
+
+    if ($analyzed_grammar_string ne $grammar_string) {
+        %endless_rule_hash       = ();
+        %parent_rule_string_hash = ();
+        my $parent_obj = GenTest_e::Grammar->new(grammar_string => $grammar_string,
+                                                 grammar_flags  => $grammar_flags);
+        if (defined $parent_obj) {
+            map { $endless_rule_hash{$_} = 1 } @{$parent_obj->analyze()->{non_terminating}};
+            map { $parent_rule_string_hash{$_} = $parent_obj->rule($_)->toString() }
+                keys %{$parent_obj->rules()};
+        }
+        $analyzed_grammar_string = $grammar_string;
+    }
+    # The RQG run will tell what is wrong.
+    return 1 if not %parent_rule_string_hash;
+    my %child_rule_string_hash = (%parent_rule_string_hash, %$redefine_hash);
+    my $child_grammar_string   = join("\n\n", map { $child_rule_string_hash{$_} }
+                                                  sort keys %child_rule_string_hash);
+    # The child gets parsed only once here. Do not fill the grammar cache with it.
+    my $child_obj = GenTest_e::Grammar->new(grammar_string => $child_grammar_string,
+                                            grammar_flags  => $grammar_flags,
+                                            grammar_cache  => 0);
+    # The RQG run will tell what is wrong.
+    return 1 if not defined $child_obj;
+    my @new_endless = grep { not exists $endless_rule_hash{$_} }
+                           @{$child_obj->analyze()->{non_terminating}};
+    say("DEBUG: Simplifier::grammar_terminates: Endless rules '" . join("', '", @new_endless) .
+        "'.") if 0 < scalar @new_endless and Auxiliary::script_debug("S5");
+    return (0 == scalar @new_endless) ? 1 : 0;
+}
+
 
 sub get_job {
 # 1. If 1 == $phase_switch
@@ -1435,6 +1481,8 @@ sub get_job {
                         "# Order id list : " . join(" ", @oid_list) . "\n\n";
 
                     my $is_valid = 0;
+                    my $main_rule_string;
+                    my %redefine_hash;
                     foreach my $oid ( @oid_list ) {
                         my $curr_rule_name        = $order_array[$oid][ORDER_PROPERTY2];
                         my $curr_component_string = $order_array[$oid][ORDER_PROPERTY3];
@@ -1452,9 +1500,32 @@ sub get_job {
                         } else {
                             # Do not print $new_rule_string into the comment because it could
                             # contain line breaks.
-                            $is_valid = 1 if $oid == $order_id;
+                            if ($oid == $order_id) {
+                                $is_valid         = 1;
+                                $main_rule_string = $new_rule_string;
+                            }
                             $redefine_string .= "# Order id $oid\n" . "# -------------- \n" .
                                                 $new_rule_string . "\n\n";
+                            $redefine_hash{$curr_rule_name} = $new_rule_string;
+                        }
+                    }
+
+                    # Removing a component could make some rule endless (indirect recursion).
+                    # Throw such candidates away before spending a RQG run on them.
+                    if ($is_valid > 0 and
+                        not grammar_terminates(\%redefine_hash)) {
+                        # Maybe one of the extra orders is guilty. So try the main order alone.
+                        $redefine_string =
+                            "################ Generated by grammar simplifier ################\n" .
+                            "# Order id list : $order_id\n\n" .
+                            "# Order id $order_id\n" . "# -------------- \n" .
+                            $main_rule_string . "\n\n";
+                        if (not grammar_terminates({ $rule_name => $main_rule_string })) {
+                            say("DEBUG: Order id '$order_id' affecting rule '$rule_name' " .
+                                "component '$component_string' makes the grammar endless.")
+                                if Auxiliary::script_debug("S4");
+                            Batch::add_to_try_never($order_id);
+                            $is_valid = 0;
                         }
                     }
 
@@ -1779,6 +1850,14 @@ sub generate_orders {
                     add_order($cl_snip_all . $cl_snip_phase, $rule_name, $component);
                     $success++;
                 }
+                # Replaying with the weight of a component shrunk to 1 is some success in case
+                # removing the component does not replay.
+                foreach my $component (
+                    GenTest_e::Simplifier::Grammar::get_weighted_component_list($rule_name)) {
+                    add_order($cl_snip_all . $cl_snip_phase, $rule_name,
+                              GenTest_e::Simplifier::Grammar::SIMP_WEIGHT_TO_ONE . $component);
+                    $success++;
+                }
                 # dump_orders;
             } else {
                 say("DEBUG: Rule '$rule_name' has only " . (scalar @rule_unique_component_list) .
@@ -3236,6 +3315,55 @@ sub make_child_from_parent {
     $child_number++;
 }
 
+sub checkpoint_state {
+# References to the variables which change during the campaign. Needed for resume after
+# some death of rqg_batch.pl. See lib/Checkpoint.pm.
+# The state of the grammar simplification is in GenTest_e::Simplifier::Grammar.
+    return {
+        phase                        => \$phase,
+        phase_switch                 => \$phase_switch,
+        simp_chain                   => \@simp_chain,
+        simp_success                 => \$simp_success,
+        first_replay_success         => \$first_replay_success,
+        thread1_replay_success       => \$thread1_replay_success,
+        rvt_simp_success             => \$rvt_simp_success,
+        thread_reduce_success        => \$thread_reduce_success,
+        grammar_simp_success         => \$grammar_simp_success,
+        final_replay_success         => \$final_replay_success,
+        order_array                  => \@order_array,
+        left_over_trials             => \$left_over_trials,
+        threads                      => \$threads,
+        cl_snip_phase                => \$cl_snip_phase,
+        cl_snip_step                 => \$cl_snip_step,
+        duration                     => \$duration,
+        parent_number                => \$parent_number,
+        parent_grammar               => \$parent_grammar,
+        parent_grammar_string        => \$parent_grammar_string,
+        grammar_string               => \$grammar_string,
+        child_number                 => \$child_number,
+        child_grammar                => \$child_grammar,
+        campaign_number              => \$campaign_number,
+        campaign_success             => \$campaign_success,
+        campaign_duds_since_replay   => \$campaign_duds_since_replay,
+        refill_number                => \$refill_number,
+        rvt_options                  => \$rvt_options,
+        reporter_array               => \@reporter_array,
+        reporter_hash                => \%reporter_hash,
+        transformer_array            => \@transformer_array,
+        transformer_hash             => \%transformer_hash,
+        validator_array              => \@validator_array,
+        validator_hash               => \%validator_hash,
+        have_rvt_generated           => \$have_rvt_generated,
+        have_thread_reduce_generated => \$have_thread_reduce_generated,
+        replay_runtime_fifo          => \@replay_runtime_fifo,
+        estimate_runtime_fifo        => \@estimate_runtime_fifo,
+        generate_calls               => \$Simplifier::generate_calls,
+        order_id_now                 => \$Simplifier::order_id_now,
+        arrival_number               => \$Simplifier::arrival_number,
+        clone_phase                  => \$Simplifier::clone_phase,
+    };
+}
+
 sub free_memory {
     @order_array           = ();
     @reporter_array        = ();
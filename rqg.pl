@@ -81,8 +81,10 @@ use Runtime;
 use Basics;
 use Local;
 use SQLtrace;
+use GendataCache;
 use GenTest_e::Constants;
 use GenTest_e::Properties;
+use GenTest_e::Random;
 use GenTest_e::App::GenTest_e;
 use GenTest_e::App::GenConfig;
 use DBServer_e::DBServer;
@@ -95,6 +97,7 @@ Local::check_and_set_rqg_home($rqg_home);
 
 #--------------------
 use GenTest_e::Grammar;
+use GenTest_e::Generator::FromGrammar;
 #--------------------
 
 $| = 1;
@@ -127,16 +130,18 @@ my (@basedirs, @mysqld_options, @vardirs, @engine, @vcols, @views,
     @validators, @reporters, @transformers, $filter,
     $gendata_advanced, $skip_gendata, @gendata_sql_files, $grammar_file, @redefine_files,
     $seed, $mask, $mask_level, $no_mask, $skip_recursive_rules,
-    $rows, $queries, $ps_protocol, $sqltrace,
+    $rows, $queries, $ps_protocol, $ps_cache, $async_execute, $resultset_digest,
+    $sqltrace,
     $varchar_len, $notnull, $short_column_names, $strict_fields,
-    $max_gd_duration,
+    $max_gd_duration, $gendata_parallel,
     $valgrind, $valgrind_options, $rr, $wait_debugger,
     $start_dirty, $build_thread,
     $logfile, $querytimeout,
     $freeze_time,
-    $skip_shutdown, $galera, $use_gtid, $annotate_rules,
+    $skip_shutdown, $galera, $use_gtid, $annotate_rules, $rule_coverage,
+    $adaptive_weights, $adaptive_weights_replay, $generate_ahead, $prng,
     $restart_timeout, $scenario, $upgrade_test, $max_gt_rounds,
-    $gendata_dump, $config_file,
+    $gendata_dump, $gendata_cache, $config_file,
     $workdir, $script_debug_value,
     $options);
 
@@ -221,6 +226,7 @@ if (not GetOptions(
     'skip-gendata'                => \$skip_gendata,
     'skip_gendata'                => \$skip_gendata,
     'gendata_dump'                => \$gendata_dump,
+    'gendata_cache=s'             => \$gendata_cache,
     'genconfig:s'                 => \$genconfig,
     'notnull'                     => \$notnull,
     'short_column_names'          => \$short_column_names,
@@ -263,12 +269,29 @@ if (not GetOptions(
     'use_gtid=s'                  => \$use_gtid,
     'annotate_rules'              => \$annotate_rules,
     'annotate-rules'              => \$annotate_rules,
+    'rule_coverage'               => \$rule_coverage,
+    'rule-coverage'               => \$rule_coverage,
+    'adaptive_weights:s'          => \$adaptive_weights,
+    'adaptive-weights:s'          => \$adaptive_weights,
+    'adaptive_weights_replay=s'   => \$adaptive_weights_replay,
+    'adaptive-weights-replay=s'   => \$adaptive_weights_replay,
+    'generate_ahead=i'            => \$generate_ahead,
+    'generate-ahead=i'            => \$generate_ahead,
+    'prng=s'                      => \$prng,
     'upgrade-test:s'              => \$upgrade_test,
     'upgrade_test:s'              => \$upgrade_test,
     'scenario:s'                  => \$scenario,
     'max_gd_duration=i'           => \$max_gd_duration,
+    'gendata_parallel=i'          => \$gendata_parallel,
+    'gendata-parallel=i'          => \$gendata_parallel,
     'ps-protocol'                 => \$ps_protocol,
     'ps_protocol'                 => \$ps_protocol,
+    'ps-cache=i'                  => \$ps_cache,
+    'ps_cache=i'                  => \$ps_cache,
+    'async-execute'               => \$async_execute,
+    'async_execute'               => \$async_execute,
+    'resultset-digest'            => \$resultset_digest,
+    'resultset_digest'            => \$resultset_digest,
     'script_debug:s'              => \$script_debug_value,
     'rounds=i'                    => \$max_gt_rounds,
     )) {
@@ -882,6 +905,13 @@ if ($rpl_mode eq Auxiliary::RQG_RPL_GALERA) {
     }
 }
 
+if (defined $prng and not GenTest_e::Random::is_algorithm($prng)) {
+    say("ERROR: The value '$prng' for --prng is not supported. Supported are '" .
+        GenTest_e::Random::RANDOM_ALGORITHM_LCG() . "' and on 64-bit perl '" .
+        GenTest_e::Random::RANDOM_ALGORITHM_XOSHIRO() . "'.");
+    my $status = STATUS_CONFIG_ERROR;
+    run_end($status);
+}
 
 # Auxiliary::calculate_seed writes a message about
 # - assigned and computed setting of seed
@@ -998,6 +1028,12 @@ if (not defined $max_gt_rounds) {
     $max_gt_rounds = 1;
 }
 
+# Snapshots of GenData results
+$status = GendataCache::check_and_set_gendata_cache($gendata_cache);
+if (STATUS_OK != $status) {
+    run_end($status);
+};
+
 #
 # Final preparations followed by start servers.
 #
@@ -1030,6 +1066,9 @@ foreach my $server_id (0.. $max_id) {
 #
 
 my $rplsrv;
+# Snapshots of GenData results (--gendata_cache)
+my ($gendata_cache_key, $gendata_cache_key_text);
+my $gendata_restored = 0;
 # say("DEBUG: rpl_mode is '$rpl_mode'");
 # FIXME: Let a routine in Auxiliary figure that out or figure out once and memorize result.
 if ((defined $rpl_mode and $rpl_mode ne Auxiliary::RQG_RPL_NONE) and
@@ -1273,13 +1312,71 @@ if ((defined $rpl_mode and $rpl_mode ne Auxiliary::RQG_RPL_NONE) and
     my $max_id = $number_of_servers - 1;
     # say("DEBUG: max_id is $max_id");
 
+    # Snapshots of GenData results are only supported for the most simple setup.
+    if (defined GendataCache::get_gendata_cache()) {
+        if (1 != $number_of_servers or defined $start_dirty or $genconfig) {
+            say("INFO: gendata_cache is not supported for this setup. Will not use it.");
+        } else {
+            my $mysqld_binary;
+            foreach my $name ("mariadbd" . $extension, "mysqld" . $extension) {
+                $mysqld_binary = Auxiliary::find_file_at_places($basedirs[1], \@subdir_list,
+                                                                $name);
+                last if defined $mysqld_binary;
+            }
+            my @binary_stat = (defined $mysqld_binary ? stat($mysqld_binary) : ());
+            if (not @binary_stat) {
+                say("INFO: No server binary found below '$basedirs[1]'. Will not use " .
+                    "gendata_cache.");
+            } else {
+                ($gendata_cache_key, $gendata_cache_key_text) = GendataCache::compute_key(
+                    'basedir'            => $basedirs[1],
+                    'binary'             => $mysqld_binary . " size:" . $binary_stat[7] .
+                                            " mtime:" . $binary_stat[9],
+                    'mysqld_options'     => $mysqld_options[0],
+                    'engine'             => $engine[0],
+                    'vcols'              => $vcols[0],
+                    'views'              => $views[0],
+                    'gendata'            => (defined $skip_gendata ? '<skip>' :
+                                             (-f $gendata ? 'file:' . $gendata : $gendata)),
+                    'gendata_advanced'   => $gendata_advanced,
+                    'gendata_sql'        => [ map { 'file:' . $_ } @gendata_sql_files ],
+                    'seed'               => $seed,
+                    'prng'               => $prng,
+                    'gendata_parallel'   => ((defined $gendata_parallel and $gendata_parallel > 1) ?
+                                             $gendata_parallel : undef),
+                    'rows'               => $rows,
+                    'varchar_length'     => $varchar_len,
+                    'notnull'            => $notnull,
+                    'short_column_names' => $short_column_names,
+                    'strict_fields'      => $strict_fields,
+                    'threads'            => $threads,
+                    'rr'                 => $rr,
+                    'valgrind'           => $valgrind,
+                );
+                if (defined $gendata_cache_key and GendataCache::snapshot_exists($gendata_cache_key)) {
+                    if (STATUS_OK == GendataCache::restore_snapshot($gendata_cache_key,
+                                                                    $workdir . "/1/data")) {
+                        $gendata_restored = 1;
+                    } else {
+                        # Get rid of a maybe partial copy. Bootstrap needs an empty data directory.
+                        if (STATUS_OK != Auxiliary::make_dbs_dirs($workdir . "/1")) {
+                            my $status = STATUS_ENVIRONMENT_FAILURE;
+                            say("ERROR: Preparing the storage structure for the server[0] failed.");
+                            exit_test($status);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
     foreach my $server_id (0.. $max_id) {
 
         $server[$server_id] = DBServer_e::MySQL::MySQLd->new(
                             basedir            => $basedirs[$server_id+1],
                             vardir             => $workdir . "/" . ($server_id+1),
                             port               => $ports[$server_id],
-                            start_dirty        => $start_dirty,
+                            start_dirty        => ($gendata_restored ? 1 : $start_dirty),
                             valgrind           => $valgrind,
                             valgrind_options   => $valgrind_options,
                             rr                 => $rr,
@@ -1422,10 +1519,20 @@ my $gentestProps = GenTest_e::Properties->new(
               'servers',
               'multi-master',
               'annotate-rules',
+              'rule-coverage',
+              'adaptive-weights',
+              'adaptive-weights-trace',
+              'adaptive-weights-replay',
+              'generate-ahead',
+              'prng',
               'restart-timeout',
               'upgrade-test',
               'ps-protocol',
-              'max_gd_duration'
+              'ps-cache',
+              'async-execute',
+              'resultset-digest',
+              'max_gd_duration',
+              'gendata-parallel'
     ]
 );
 
@@ -1477,6 +1584,9 @@ if ($valgrind) {
 $gentestProps->rr($rr) if defined $rr;
 
 $gentestProps->property('ps-protocol',1) if $ps_protocol;
+$gentestProps->property('ps-cache',$ps_cache) if $ps_cache;
+$gentestProps->property('async-execute',1) if $async_execute;
+$gentestProps->property('resultset-digest',1) if $resultset_digest;
 $gentestProps->sqltrace($sqltrace) if defined $sqltrace;
 $gentestProps->querytimeout($querytimeout) if defined $querytimeout;
 $gentestProps->logfile($logfile) if defined $logfile;
@@ -1488,8 +1598,19 @@ $gentestProps->property('restart-timeout', $restart_timeout) if defined $restart
 $gentestProps->property('multi-master', 1) if (defined $galera and scalar(@dsns)>1);
 $gentestProps->servers(\@server) if @server;
 $gentestProps->property('annotate-rules',$annotate_rules) if defined $annotate_rules;
+$gentestProps->property('rule-coverage',$workdir) if defined $rule_coverage;
+if (defined $adaptive_weights or defined $adaptive_weights_replay) {
+    $gentestProps->property('adaptive-weights',
+                            defined $adaptive_weights ? $adaptive_weights : '');
+    $gentestProps->property('adaptive-weights-trace',$workdir);
+    $gentestProps->property('adaptive-weights-replay',$adaptive_weights_replay)
+        if defined $adaptive_weights_replay;
+}
+$gentestProps->property('generate-ahead',$generate_ahead) if $generate_ahead;
+$gentestProps->property('prng',$prng) if defined $prng;
 $gentestProps->property('upgrade-test',$upgrade_test) if $upgrade_test;
 $gentestProps->property('max_gd_duration',$max_gd_duration); #  if defined $max_gd_duration;
+$gentestProps->property('gendata-parallel',$gendata_parallel) if $gendata_parallel;
 
 #
 # Basically anything added via $gentestProps->property(<whatever name>,<value>)
@@ -1595,7 +1716,12 @@ alarm ($alarm_timeout);
 # For experimenting
 # killServers();
 
-$gentest_result = $gentest->doGenData();
+if ($gendata_restored) {
+    say("INFO: GenData omitted because its result was restored from the gendata_cache.");
+    $gentest_result = STATUS_OK;
+} else {
+    $gentest_result = $gentest->doGenData();
+}
 say("DEBUG: rqg.pl: Reset alarm timeout.");
 alarm (0);
 $alarm_msg = "";
@@ -1635,6 +1761,22 @@ if (defined $upgrade_test) {
            status2text($final_result) . "($final_result) because GenData is slightly imperfect.");
        $final_result = STATUS_OK;
        say("INFO: Hence reducing the status to " . status2text($final_result) . "($final_result).");
+   } elsif (defined $gendata_cache_key and not $gendata_restored) {
+       # Only a result of GenData+Servercheck without any trouble is worth to be stored.
+       # A clean shutdown gives a consistent data directory.
+       my $status = $server[0]->stopServer;
+       if (STATUS_OK != $status) {
+           say("ERROR: Shutdown of server[1] for storing the GenData result failed.");
+           exit_test($status);
+       }
+       GendataCache::store_snapshot($gendata_cache_key, $gendata_cache_key_text,
+                                    $server[0]->datadir);
+       $status = $server[0]->startServer;
+       if (STATUS_OK != $status) {
+           say("ERROR: Restart of server[1] after storing the GenData result failed.");
+           exit_test($status);
+       }
+       $ENV{SERVER_PID1} = $server[0]->serverpid;
    }
 }
 
@@ -1718,6 +1860,8 @@ while ( $gt_round <= $max_gt_rounds) {
 
     $gentest_result = $gentest->doGenTest();
     say("GenTest returned status " . status2text($gentest_result) . "($gentest_result)");
+    GenTest_e::Generator::FromGrammar::merge_coverage($workdir, $grammar_file)
+        if defined $rule_coverage;
     $final_result = $gentest_result;
     $message =      "RQG GenTest runtime in s : " . (time() - $gentest_start_time);
     $summary .=     "SUMMARY: $message\n";
@@ -2476,6 +2620,12 @@ $0 - Run a complete random query generation (RQG) test.
     --views        : Generate views. Optionally specify view type (algorithm) as option value. Passed to lib/GenTest_e/App/Gentest.pm.
                      Different values can be provided to servers through --views1 | --views2 | --views3
     --max_gd_duration : Abort the RQG run in case the work phase Gendata lasts longer than max_gd_duration
+    --gendata_parallel=<n>: Create and fill the tables of Gendata, GendataSimple or GendataAdvanced via up to <n>
+                     connections in parallel. Every table gets its own PRNG stream derived from the seed.
+                     So the data does not depend on <n> but differs from the data generated with <n> = 1 (default).
+    --gendata_cache : Directory for snapshots of the data directory after GenData. RQG runs with the same
+                     GenData relevant setup restore the snapshot instead of running bootstrap and GenData.
+                     (OPTIONAL) See lib/GendataCache.pm.
     --gendata_dump : After running the work phase Gendata dump the content of the first DB server to the
                      file 'after_gendata.dump'. (OPTIONAL)
 
@@ -2500,9 +2650,31 @@ $0 - Run a complete random query generation (RQG) test.
     --mask         : Grammar mask. Passed to lib/GenTest_e/App/Gentest.pm.
     --mask-level   : Grammar mask level. Passed to lib/GenTest_e/App/Gentest.pm.
     --filter       : File for disabling the execution of SQLs containing certain patterns. Passed to lib/GenTest_e/App/Gentest.pm.
+    --ps_cache=<n> : The worker threads replace the integer and string literals of DML by placeholders and execute
+                     the statements via up to <n> server side prepared statements per connection. (OPTIONAL)
+                     The sqltrace shows the statements with the literals.
+    --async_execute: Worker threads without validators send the last statement of a batch asynchronous and
+                     generate the next batch while the server executes it. (OPTIONAL)
+    --resultset_digest: Fetch the result sets of SELECTs unbuffered and compare them via order independent
+                     digests. Only in case of a mismatch the SELECT gets executed once more for showing the diff.
+                     Requires that all validators support that (ResultsetComparator). (OPTIONAL)
     --freeze_time  : Freeze time for each query so that CURRENT_TIMESTAMP gives the same result for all transformers/validators
     --annotate-rules: Add to the resulting query a comment with the rule name before expanding each rule.
                       Useful for debugging query generation, otherwise makes the query look ugly and barely readable.
+    --rule_coverage: Count per rule component how often it was used and the outcome (ok, error status, crash) of executing
+                     the queries. The report gets written to <workdir>/rule_coverage.txt .
+    --adaptive_weights[=<list>]: Pick rule components whose queries fail mostly with outcomes from <list> less often.
+                     <list> is a comma separated list of status names and error numbers.
+                     (Default) STATUS_SEMANTIC_ERROR,1062,1205
+                     The changes of weights get written to <workdir>/adaptive_weights.<thread> .
+    --adaptive_weights_replay=<directory>: Use the weight changes from <directory>/adaptive_weights.<thread> instead of
+                     adapting. Together with the same seed this generates the same queries again.
+    --generate_ahead=<n>: Let some helper process per thread generate the next <n> query batches while the thread
+                     executes the current one. Grammars using _connection_id, _current_user, _pid, _tmpfile,
+                     _tmpnam, _tmptable or Perl snippets with \$executors or \$\$ get generated without helper.
+    --prng=<lcg|xoshiro256>: Pseudo random number generator used for data and queries. (Default) lcg
+                     lcg reproduces the data and queries of historic seeds. xoshiro256 (64-bit perl only) gives
+                     statistically better and independent streams per thread.
     --restart-timeout: If the server has gone away, do not fail immediately, but wait to see if it restarts (it might be a part of the test)
     --upgrade-test : enable Upgrade reporter and treat server1 and server2 as old/new server, correspondingly. After the test flow
                      on server1, server2 will be started on the same datadir, and the upgrade consistency will be checked
@@ -82,6 +82,12 @@ use Getopt::Long;
 use Data::Dumper;
 
 use ResourceControl;
+use Checkpoint;
+use BatchAgent;
+use PhaseTimes;
+use BatchMetrics;
+use Archiver;
+use RRTraces;
 
 # Structure for managing RQG Worker (child processes)
 # ---------------------------------------------------
@@ -177,15 +183,18 @@ my ($config_file, $basedir, $vardir, $trials, $duration, $grammar, $gendata,
     $force, $no_mask, $exhaustive, $start_combination, $dryrun, $noLog,
     $parallel, $noshuffle, $workdir, $discard_logs, $max_rqg_runtime,
     $help, $help_simplifier, $help_combinator, $help_verdict, $help_rr, $help_archiving, $help_local,
-    $help_rqg_home, $help_dbdir_type, $runner, $noarchiving,
+    $help_rqg_home, $help_dbdir_type, $help_checkpoint, $runner, $noarchiving,
     $rr, $sqltrace,
     $dbdir_type, $vardir_type, $fast_vardir, $slow_vardir,
-    $stop_on_replay, $script_debug_value, $runid, $threads, $type, $algorithm, $resource_control);
+    $stop_on_replay, $script_debug_value, $runid, $threads, $type, $algorithm, $resource_control,
+    $resume, $checkpoint_interval, $help_agent, $help_metrics, $metrics_interval, $metrics_port,
+    $archive_format, $archive_async, $archive_threads, $archive_jobs, $rr_jobs);
 
 use constant DEFAULT_MAX_RQG_RUNTIME => 7200;
 
 # my @basedirs    = ('', '');
 my @basedirs;
+my @agents;
 
 
 $discard_logs  = 0;
@@ -272,6 +281,9 @@ if (not GetOptions(
            'help_archiving'            => \$help_archiving,
            'help_dbdir_type'           => \$help_dbdir_type,
            'help_rqg_home'             => \$help_rqg_home,
+           'help_checkpoint'           => \$help_checkpoint,
+           'help_agent'                => \$help_agent,
+           'help_metrics'              => \$help_metrics,
            ### type == Which type of campaign to run
            # pass_through: no
            'type=s'                    => \$type,        # Swallowed and handled by rqg_batch
@@ -316,7 +328,12 @@ if (not GetOptions(
            # <option>:1   Value is optional, if no value given than treat as if 1 given
            'stop_on_replay:1'          => \$stop_on_replay,         # Swallowed and handled by rqg_batch
            'noarchiving'               => \$noarchiving,            # Swallowed and handled by rqg_batch
+           'archive_format=s'          => \$archive_format,         # Swallowed and handled by rqg_batch
+           'archive_async'             => \$archive_async,          # Swallowed and handled by rqg_batch
+           'archive_threads=i'         => \$archive_threads,        # Swallowed and handled by rqg_batch
+           'archive_jobs=i'            => \$archive_jobs,           # Swallowed and handled by rqg_batch
            'rr:s'                      => \$rr,                     # Swallowed and handled by rqg_batch
+           'rr_jobs=i'                 => \$rr_jobs,                # Swallowed and handled by rqg_batch
            'sqltrace:s'                => \$sqltrace,               # Swallowed and handled by rqg_batch
 #          'threads=i'                 => \$threads,                # Pass through (@ARGV). Simplifier maybe needs that
            'discard_logs'              => \$discard_logs,           # Swallowed and handled by rqg_batch
@@ -324,12 +341,18 @@ if (not GetOptions(
            'resource_control=s'        => \$resource_control,       # Swallowed and handled by rqg_batch
            'script_debug=s'            => \$script_debug_value,     # Swallowed and handled by rqg_batch
            'runid:i'                   => \$runid,                  # Swallowed and handled by rqg_batch
+           'resume=s'                  => \$resume,                 # Swallowed and handled by rqg_batch
+           'checkpoint_interval=i'     => \$checkpoint_interval,    # Swallowed and handled by rqg_batch
+           'agent=s@'                  => \@agents,                 # Swallowed and handled by rqg_batch
+           'metrics_interval=i'        => \$metrics_interval,       # Swallowed and handled by rqg_batch
+           'metrics_port=i'            => \$metrics_port,           # Swallowed and handled by rqg_batch
                                                    )) {
     if (not defined $help             and
         not defined $help_simplifier  and not defined $help_combinator and
         not defined $help_verdict     and not defined $help_rr         and
-        not defined $help_dbdir_type                                     and
-        not defined $help_archiving   and not defined $help_rqg_home      ) {
+        not defined $help_dbdir_type  and not defined $help_checkpoint   and
+        not defined $help_archiving   and not defined $help_rqg_home   and
+        not defined $help_agent       and not defined $help_metrics        ) {
         # Somehow wrong option.
         help();
         safe_exit(STATUS_ENVIRONMENT_FAILURE);
@@ -357,10 +380,20 @@ if (defined $help) {
     safe_exit(0);
 } elsif (defined $help_rr) {
     Runtime::help_rr();
+    RRTraces::help();
     safe_exit(0);
 } elsif (defined $help_archiving) {
     Batch::help_archiving();
     safe_exit(0);
+} elsif (defined $help_checkpoint) {
+    Checkpoint::help();
+    safe_exit(0);
+} elsif (defined $help_agent) {
+    BatchAgent::help();
+    safe_exit(0);
+} elsif (defined $help_metrics) {
+    BatchMetrics::help();
+    safe_exit(0);
 }
 
 
@@ -414,7 +447,8 @@ if (not defined $dbdir_type) {
 
 # Read local.cfg and make the infrastructure down to <whatever>/<runid>.
 # ($major_runid, $minor_runid, $dbdir_type, my $batch)
-Local::check_and_set_local_config(undef, undef, $dbdir_type, 2);
+# In case of resume the <runid> is the one of the campaign to be resumed.
+Local::check_and_set_local_config(undef, $resume, $dbdir_type, 2);
 # Never use $vardir = Local::get_vardir();
 
 # In case rr is invoked and local.cfg contains some defined value rr_options_add than
@@ -471,7 +505,16 @@ my $bin_arch_dir = Local::get_binarch_dir();
 
 # Generate the infrastructure (several files) for bookkeeping of all the RQG runs somehow finished
 # ------------------------------------------------------------------------------------------------
-Batch::make_infrastructure($workdir);
+Batch::make_infrastructure($workdir, defined $resume);
+if (STATUS_OK != Checkpoint::check_and_set_checkpoint($workdir, $checkpoint_interval)) {
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
+if (STATUS_OK != PhaseTimes::init($workdir, defined $resume)) {
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
+if (STATUS_OK != BatchMetrics::check_and_set_metrics($workdir, $metrics_interval, $metrics_port)) {
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
 
 if (defined $sqltrace) {
     $sqltrace = SQLtrace::check_sqltracing($sqltrace);
@@ -513,7 +556,14 @@ if (not defined $parallel) {
     $parallel = $workers_mid;
     say("INFO: Setting the upper limit for the number of parallel RQG runners to $parallel.");
 }
-Batch::set_workers_range($parallel, $workers_mid, $workers_min);
+# The RQG workers on other hosts get the numbers following the local ones.
+# ResourceControl observes only the current box. So the remote RQG workers are added on top.
+my $workers_remote = BatchAgent::check_and_set_agents(\@agents, $parallel);
+if (not defined $workers_remote) {
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
+Batch::set_workers_range($parallel + $workers_remote, $workers_mid + $workers_remote,
+                         $workers_min + $workers_remote);
 
 if (defined $gendata) {
     $cl_end .= " --gendata=$gendata";
@@ -579,9 +629,13 @@ if ($noarchiving) {
     }
 } else {
     say("INFO: Archiving of data of interesting RQG runs is enabled.");
-    if ( STATUS_OK == Auxiliary::find_external_command('xz') ) {
-    } else {
-        say("ERROR: The compressor 'xz' was not found.");
+    if (STATUS_OK != Archiver::check_and_set_archiver($workdir, $archive_format, $archive_async,
+                                                      $archive_threads, $archive_jobs)) {
+        $status = STATUS_ENVIRONMENT_FAILURE;
+        safe_exit($status);
+    }
+    if (defined $rr and Runtime::RR_OFF ne $rr and
+        STATUS_OK != RRTraces::check_and_set_rr_traces($rr_jobs)) {
         $status = STATUS_ENVIRONMENT_FAILURE;
         safe_exit($status);
     }
@@ -745,6 +799,22 @@ if      ($Batch::batch_type eq Batch::BATCH_TYPE_COMBINATOR) {
     safe_exit(4);
 }
 
+Checkpoint::register_state('Batch', Batch::checkpoint_state());
+Checkpoint::register_state('PhaseTimes', PhaseTimes::checkpoint_state());
+Checkpoint::register_state('BatchMetrics', BatchMetrics::checkpoint_state());
+if      ($Batch::batch_type eq Batch::BATCH_TYPE_COMBINATOR) {
+    Checkpoint::register_state('Combinator', Combinator::checkpoint_state());
+} elsif ($Batch::batch_type eq Batch::BATCH_TYPE_RQG_SIMPLIFIER) {
+    Checkpoint::register_state('Simplifier', Simplifier::checkpoint_state());
+    Checkpoint::register_state('Simplifier::Grammar',
+                               GenTest_e::Simplifier::Grammar::checkpoint_state());
+}
+if (defined $resume) {
+    Batch::resume_campaign();
+    BatchMetrics::resumed();
+    Archiver::enqueue_pending($workdir) if not $noarchiving;
+}
+
 say("DEBUG: Command line options to be appended to the call of the RQG runner: ->" .
     $cl_end . "<-") if Auxiliary::script_debug("T1");
 
@@ -783,6 +853,9 @@ while($Batch::give_up <= 1) {
     last if $Batch::give_up > 1;
     # 3. Resource problem is ahead.
     my $delay_start = Batch::check_resources();
+    BatchMetrics::update(0);
+    Archiver::poll();
+    RRTraces::poll(0);
     last if $Batch::give_up > 1;
     # 4. Some worker misbehaved (bad setup or server no more responsive)
     Batch::check_rqg_runtime_exceeded($max_rqg_runtime);
@@ -970,6 +1043,8 @@ while($Batch::give_up <= 1) {
                 }
                 my $rqg_log = $rqg_workdir . "/rqg.log";
                 my ($whatever, $rqg_major_runid) = Local::get_runid();
+                # The agent on some other host needs the options only.
+                my $rqg_options = $command;
                 # Experimental:
                 # $rqg_log = "/tmp/otto";
                 $command .= " --major_runid=$rqg_major_runid --minor_runid=" . $free_worker .
@@ -1060,24 +1135,43 @@ while($Batch::give_up <= 1) {
                     # say("DEBUG: $who_am_i =>" . $command . "<=");
                     #
 
-                    my $rc = system($command);
-                    if      ($? == -1) {
-                        say("WARNING: $who_am_i ->" . $command . "<- failed to execute: $!");
-                        safe_exit(STATUS_UNKNOWN_ERROR);
-                    } elsif ($? & 127) {
-                        say("WARNING: $who_am_i ->" . $command . "<- died with signal " .
-                            ($? & 127));
-                        safe_exit(STATUS_PERL_FAILURE);
-                    } elsif (($? >> 8) != 0) {
-                        say("DEBUG: $who_am_i ->"   . $command . "<- exited with value " .
-                            ($? >> 8)) if Auxiliary::script_debug("W2");
-                        # Do not exit because the RQG runner harvested most probably something like
-                        # STATUS_SERVER_CRASHED or similar.
+                    my $rc;
+                    my $remote = BatchAgent::is_remote($free_worker);
+                    if ($remote) {
+                        # The agent performs the RQG run on the other host, mirrors the phase
+                        # changes and finally transfers the files of the RQG workdir.
+                        if (STATUS_OK != BatchAgent::run_job($free_worker, $rqg_workdir,
+                                                     $rqg_major_runid, $runner, $rqg_options)) {
+                            say("WARNING: $who_am_i The RQG run on the host '" .
+                                BatchAgent::get_host($free_worker) . "' failed.");
+                            safe_exit(STATUS_UNKNOWN_ERROR);
+                        }
                     } else {
-                        say("DEBUG: $who_am_i ->" .   $command . "<- exited with value " .
-                            ($? >> 8)) if Auxiliary::script_debug("W2");
+                        $rc = system($command);
+                        if      ($? == -1) {
+                            say("WARNING: $who_am_i ->" . $command . "<- failed to execute: $!");
+                            safe_exit(STATUS_UNKNOWN_ERROR);
+                        } elsif ($? & 127) {
+                            say("WARNING: $who_am_i ->" . $command . "<- died with signal " .
+                                ($? & 127));
+                            safe_exit(STATUS_PERL_FAILURE);
+                        } elsif (($? >> 8) != 0) {
+                            say("DEBUG: $who_am_i ->"   . $command . "<- exited with value " .
+                                ($? >> 8)) if Auxiliary::script_debug("W2");
+                            # Do not exit because the RQG runner harvested most probably something
+                            # like STATUS_SERVER_CRASHED or similar.
+                        } else {
+                            say("DEBUG: $who_am_i ->" .   $command . "<- exited with value " .
+                                ($? >> 8)) if Auxiliary::script_debug("W2");
+                        }
+                        Batch::append_string_to_file($rqg_log, Basics::get_process_family());
+                    }
+                    # Get the rr traces out of the way before the verdict is known. rqg_batch.pl
+                    # moves them off the fast storage meanwhile.
+                    if (RRTraces::is_enabled() and not $remote and
+                        STATUS_OK != RRTraces::spool($rqg_workdir, $free_worker)) {
+                        safe_exit(STATUS_ENVIRONMENT_FAILURE);
                     }
-                    Batch::append_string_to_file($rqg_log, Basics::get_process_family());
 
                     # say("DEBUG: $who_am_i After performing the RQG run and before calculation of verdict.");
 
@@ -1121,8 +1215,18 @@ while($Batch::give_up <= 1) {
                                                         Auxiliary::RQG_PHASE_ARCHIVING)) {
                             safe_exit(STATUS_ENVIRONMENT_FAILURE);
                         }
-                        if (not $noarchiving) {
-                            if (STATUS_OK != Auxiliary::archive_results($rqg_workdir)) {
+                        # Asynchronous archiving: Only preserve the remainings and leave the
+                        # archiving and cleanup to some archiver started by rqg_batch.pl.
+                        my $staged = 0;
+                        if (not $noarchiving and not $remote and Archiver::is_async()) {
+                            if (STATUS_OK != Archiver::stage($rqg_workdir, $free_worker)) {
+                                say("ERROR FATAL: rqg_batch.pl Archiver::stage failed.");
+                                safe_exit(STATUS_ENVIRONMENT_FAILURE);
+                            }
+                            $staged = 1;
+                        } elsif (not $noarchiving) {
+                            if (STATUS_OK != ($remote ? BatchAgent::fetch_archive($rqg_workdir)
+                                                      : Archiver::archive($rqg_workdir))) {
                                 my $msg_snip = "ERROR: Archiving the remainings of the RQG " .
                                                "test failed.";
                                 # We already have the current process family within the rqg.log.
@@ -1145,7 +1249,8 @@ while($Batch::give_up <= 1) {
                         # say("DEBUG rqg_workdir ->$rqg_workdir<-");
                         # say("DEBUG: Some fast dir ->" . Local::get_rqg_fast_dir . "/$free_worker<-");
                         # say("DEBUG: Some slow dir ->" . Local::get_rqg_slow_dir . "/$free_worker<-");
-                        if (STATUS_OK != Auxiliary::clean_workdir_preserve($rqg_workdir)) {
+                        if (not $staged and
+                            STATUS_OK != Auxiliary::clean_workdir_preserve($rqg_workdir)) {
                             say("ERROR FATAL: rqg_batch.pl Auxiliary::clean_workdir_preserve failed.");
                             my $status = STATUS_ENVIRONMENT_FAILURE;
                             safe_exit($status);
@@ -1159,6 +1264,8 @@ while($Batch::give_up <= 1) {
                         }
                     }
 
+                    # Let the agent remove the remainings on the other host.
+                    BatchAgent::end_job() if $remote;
                     if (STATUS_OK != Auxiliary::set_rqg_phase($rqg_workdir,
                                                     Auxiliary::RQG_PHASE_COMPLETE)) {
                         safe_exit(STATUS_ENVIRONMENT_FAILURE);
@@ -1275,6 +1382,9 @@ while($Batch::give_up <= 1) {
             Batch::check_exit_file($exit_file);
             last if $Batch::give_up > 1;
             my $delay_start = Batch::check_resources();
+            BatchMetrics::update(0);
+            Archiver::poll();
+            RRTraces::poll(0);
             last if $Batch::give_up > 1;
             Batch::check_runtime_exceeded($batch_end_time);
             last if $Batch::give_up > 1;
@@ -1299,6 +1409,7 @@ while($Batch::give_up <= 1) {
 
     my $active_workers = Batch::reap_workers();
     Batch::process_finished_runs();
+    Batch::write_checkpoint(0, 0);
     last if $Batch::give_up > 1;
 
     next if defined $dryrun;
@@ -1326,6 +1437,7 @@ while (Batch::count_active_workers()) {
     Batch::process_finished_runs();
     Batch::check_rqg_runtime_exceeded($max_rqg_runtime);
     Batch::process_finished_runs();
+    Batch::write_checkpoint(0, 0);
     say("DEBUG: At begin of loop waiting till all RQG worker have finished.")
         if Auxiliary::script_debug("T5");
     # First handle all cases for giving up.
@@ -1336,6 +1448,9 @@ while (Batch::count_active_workers()) {
     # No "last if $Batch::give_up > 1;" because we want the Batch::reap_workers() with the cleanup.
     $poll_time = 0.1 if $Batch::give_up > 1;
     my $delay_start = Batch::check_resources();
+    BatchMetrics::update(0);
+    Archiver::poll();
+    RRTraces::poll(0);
     last if $Batch::give_up > 2;
     # 2. The assigned max_runtime is exceeded.
     Batch::check_runtime_exceeded($batch_end_time);
@@ -1348,6 +1463,11 @@ while (Batch::count_active_workers()) {
 # But in case this returns 0 than we will not run the loop body and so Batch::process_finished_runs
 # would be not called.  So we must do that here again.
 Batch::process_finished_runs();
+Batch::write_checkpoint(1, 1);
+# The fast and slow dirs get removed below. So all archiving must be finished.
+Archiver::drain();
+RRTraces::drain();
+BatchMetrics::update(1);
 Batch::dump_try_hashes() if Auxiliary::script_debug("T3");
 # dump_orders();
 
@@ -1360,6 +1480,8 @@ $best_verdict = Verdict::RQG_VERDICT_REPLAY   if 0 < $Batch::verdict_replay;
 
 say("\n\n");
 ResourceControl::print_statistics;
+say("STATISTICS: Wall clock and CPU time of the RQG runs per phase\n" . PhaseTimes::summary());
+PhaseTimes::finish();
 my $fat_message = Batch::get_extra_info_hash("STATISTICS");
 my $pl = Verdict::RQG_VERDICT_LENGTH + 2;
 my $message = ""                                                                                   .
@@ -1456,6 +1578,13 @@ sub help() {
    "      Information about client side SQL tracing by RQG\n"                                      .
    "--help_dbdir_type\n"                                                                           .
    "      Information about the RQG option dbdir_type\n"                                           .
+   "--help_checkpoint\n"                                                                           .
+   "      Information about checkpoints of the campaign state and resuming a campaign after the\n"  .
+   "      rqg_batch.pl process died.\n"                                                            .
+   "--help_agent\n"                                                                                .
+   "      Information about running RQG workers on other hosts.\n"                                 .
+   "--help_metrics\n"                                                                              .
+   "      Information about live metrics of the rqg_batch.pl run in the Prometheus format.\n"      .
    "--help_local\n"                                                                                .
    "      Information about the mandatory file local.cfg which gets used for computing the\n"      .
    "      storage places for archives, vardirs, workdirs and other stuff.\n"                       .
@@ -0,0 +1,182 @@
+#!/usr/bin/perl
+
+# Copyright (c) 2026 MariaDB plc
+# Use is subject to license terms.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+# USA
+#
+
+# Agent performing exact one RQG run on behalf of some rqg_batch.pl running on another (or the
+# same) host. Gets started by the RQG worker of rqg_batch.pl via ssh (see lib/BatchAgent.pm for
+# the protocol) and talks with him via stdin/stdout.
+# stdout gets redirected to stderr first because all the RQG modules print to stdout and
+# that must not disturb the protocol.
+#
+
+use strict;
+use Carp;
+use File::Basename;
+use Cwd;
+my $rqg_home;
+BEGIN {
+    # Save the protocol channel and than redirect STDOUT to STDERR.
+    open(PROTOCOL_OUT, ">&STDOUT") or die "Duplicating STDOUT failed : $!";
+    open(STDOUT, ">&STDERR")       or die "Redirecting STDOUT failed : $!";
+    # Cwd::abs_path reports the target of a symlink.
+    $rqg_home = File::Basename::dirname(Cwd::abs_path($0));
+    if (not -e $rqg_home . "/lib/GenTest_e.pm") {
+        print("ERROR: The rqg_home ('$rqg_home') calculated does not look like the root of a " .
+              "RQG install.\n");
+        exit 2;
+    }
+    my $rqg_libdir = $rqg_home . '/lib';
+    unshift @INC , $rqg_libdir;
+    $ENV{'RQG_HOME'} = $rqg_home;
+    print("# INFO: Top level directory of RQG calculated '$rqg_home'.\n"     .
+          "# INFO: Environment variable 'RQG_HOME' set to '$rqg_home'.\n"    .
+          "# INFO: Perl array variable \@INC adjusted to ->" . join("---", @INC) . "<-\n");
+}
+use Time::HiRes;
+use POSIX ":sys_wait_h"; # for nonblocking read
+use IO::Select;
+use File::Path;
+use Auxiliary;
+use Basics;
+use Local;
+use Verdict;
+use BatchAgent;
+use GenTest_e;
+use GenTest_e::Constants;
+
+$| = 1;
+binmode PROTOCOL_OUT;
+PROTOCOL_OUT->autoflush(1);
+binmode STDIN;
+
+my $who_am_i = "rqg_batch_agent.pl:";
+
+Auxiliary::script_debug_init("");
+Local::check_and_set_rqg_home($rqg_home);
+
+BatchAgent::send_message(\*PROTOCOL_OUT, "HELLO " . BatchAgent::AGENT_PROTOCOL_VERSION);
+
+my $message = BatchAgent::read_message(\*STDIN);
+if (not defined $message or $message !~ m{^RUN ([0-9]+) ([0-9]+) (\S+) (.*)$}) {
+    say("ERROR: $who_am_i Expected RUN but got '" . (defined $message ? $message : '<EOF>') .
+        "'.");
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
+my ($major_runid, $minor_runid, $runner, $options) = ($1, $2, $3, $4);
+
+# Nearly the same layout like on the host of rqg_batch.pl:
+# <results_dir>/<major_runid>/agent_<minor_runid>, <fast/slow dir>/<major_runid>/agent_<minor_runid>
+# For the host 'local' <results_dir>/<major_runid>/<minor_runid> is the RQG workdir of the
+# coordinator. So we must neither prepare nor remove that.
+my $agent_runid = "agent_" . $minor_runid;
+Local::check_and_set_local_config($major_runid, $agent_runid, undef, 1);
+my $rqg_workdir = Local::get_results_dir();
+if (STATUS_OK != Auxiliary::make_rqg_infrastructure($rqg_workdir)) {
+    say("ERROR: $who_am_i Preparing the RQG workdir '$rqg_workdir' failed.");
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
+my $rqg_log = $rqg_workdir . "/rqg.log";
+
+my $command = "perl -w $rqg_home/$runner $options --major_runid=$major_runid " .
+              "--minor_runid=$agent_runid >> $rqg_log 2>&1";
+$command = Auxiliary::prepare_command_for_system($command);
+
+sub stop_run_and_exit {
+    my ($pid) = @_;
+    say("INFO: $who_am_i The coordinator is gone. Stopping the RQG run.");
+    kill '-KILL', $pid;
+    waitpid($pid, 0);
+    cleanup();
+    safe_exit(STATUS_OK);
+}
+
+sub cleanup {
+    chdir($rqg_home);
+    foreach my $tree (Local::get_rqg_fast_dir(), Local::get_rqg_slow_dir(), $rqg_workdir) {
+        Basics::conditional_remove_dir($tree);
+    }
+}
+
+my $pid = fork();
+if (not defined $pid) {
+    say("ERROR: $who_am_i fork failed : $!");
+    safe_exit(STATUS_ENVIRONMENT_FAILURE);
+}
+if (0 == $pid) {
+    setpgrp(0,0);
+    exec($command);
+}
+
+my $select = IO::Select->new(\*STDIN);
+my $phase  = Auxiliary::RQG_PHASE_INIT;
+my $exit_status;
+while (1) {
+    my $new_phase = Auxiliary::get_rqg_phase($rqg_workdir);
+    if (defined $new_phase and $new_phase ne $phase) {
+        $phase = $new_phase;
+        BatchAgent::send_message(\*PROTOCOL_OUT, "PHASE $phase");
+    }
+    if ($pid == waitpid($pid, WNOHANG)) {
+        $exit_status = $? >> 8;
+        last;
+    }
+    # The coordinator sends nothing during the RQG run. Readable means EOF == he is gone.
+    stop_run_and_exit($pid) if $select->can_read(0.5);
+}
+my $new_phase = Auxiliary::get_rqg_phase($rqg_workdir);
+BatchAgent::send_message(\*PROTOCOL_OUT, "PHASE $new_phase")
+    if defined $new_phase and $new_phase ne $phase;
+BatchAgent::send_message(\*PROTOCOL_OUT, "EXIT $exit_status");
+Basics::append_string_to_file($rqg_log, Basics::get_process_family());
+
+# The coordinator has his own rqg_phase.*, rqg_verdict.* and rqg.job.
+if (opendir(WORKDIR, $rqg_workdir)) {
+    foreach my $file (sort readdir(WORKDIR)) {
+        my $path = $rqg_workdir . "/" . $file;
+        next if -l $path or not -f $path;
+        next if $file =~ m{^rqg_phase\.} or $file =~ m{^rqg_verdict\.} or $file eq 'rqg.job';
+        BatchAgent::send_file(\*PROTOCOL_OUT, $path);
+    }
+    closedir(WORKDIR);
+}
+BatchAgent::send_message(\*PROTOCOL_OUT, "FILES_DONE");
+
+while (1) {
+    $message = BatchAgent::read_message(\*STDIN);
+    if (not defined $message or $message eq 'END') {
+        cleanup();
+        BatchAgent::send_message(\*PROTOCOL_OUT, "BYE") if defined $message;
+        last;
+    } elsif ($message eq 'ARCHIVE') {
+        my $status = Auxiliary::archive_results($rqg_workdir);
+        if (STATUS_OK == $status and opendir(WORKDIR, $rqg_workdir)) {
+            foreach my $file (sort readdir(WORKDIR)) {
+                next if $file !~ m{^archive\.};
+                BatchAgent::send_file(\*PROTOCOL_OUT, $rqg_workdir . "/" . $file);
+            }
+            closedir(WORKDIR);
+        }
+        BatchAgent::send_message(\*PROTOCOL_OUT, "ARCHIVE_DONE $status");
+    } else {
+        say("ERROR: $who_am_i Unexpected message '$message'.");
+        cleanup();
+        safe_exit(STATUS_ENVIRONMENT_FAILURE);
+    }
+}
+safe_exit(STATUS_OK);
@@ -19,9 +19,11 @@ use strict;
 use lib 'lib';
 use lib '../lib';
 
-use Test::More tests => 8;
+use Config;
+use Test::More tests => 17;
 
 use GenTest::Random;
+use GenTest_e::Random;
 
 my $prng = GenTest::Random->new(
 	seed => 2
@@ -37,3 +39,53 @@ ok($prng->string(1) eq 'a', 'prng_string_one');
 ok($prng->string(20) eq 'qccmdluyolx', 'prng_string_twenty1');
 ok($prng->string(20) eq 'ccmdluyolx', 'prng_string_twenty2');
 ok(length($prng->string(65535)) > 1024, 'prng_string_huge');
+
+# GenTest_e::Random with the LCG must deliver the same values like GenTest::Random.
+# setSeed($seed, $stream) is the same like seed + stream.
+my $prng_e = GenTest_e::Random->new(
+	seed => 2
+);
+$numbers = join(' ', map { $prng_e->digit() } (0..9));
+ok($numbers eq '7 4 9 8 4 1 2 1 5 2', 'prng_e_lcg_stability');
+my $prng_stream = GenTest_e::Random->new(seed => 5);
+$prng_stream->setSeed(5, 3);
+my $prng_sum = GenTest_e::Random->new(seed => 8);
+ok(join(' ', map { $prng_stream->uint16(0, 65535) } (1..5)) eq
+   join(' ', map { $prng_sum->uint16(0, 65535) } (1..5)), 'prng_e_lcg_stream');
+
+# Known answers of xoshiro256** seeded via splitmix64 (computed with the reference C code of
+# Blackman/Vigna). Stream 1 is stream 0 advanced by one jump().
+# seed, stream, the first three 64-bit outputs
+my @xoshiro_vectors = (
+	[ 1,     0, 'b3f2af6d0fc710c5 853b559647364cea 92f89756082a4514' ],
+	[ 1,     1, '332802f81eaae9d0 02d18d7749b84f96 c3729a527851f63d' ],
+	[ 2,     0, '1a28690da8a8d057 b9bb8042daedd58a 2f1829af001ef205' ],
+	[ 2,     1, '4266ba2364a5733e d7396ce94d91f9ea 0dcf8e2be42aa83d' ],
+	[ 12345, 0, 'be6a36374160d49b 214aaa0637a688c6 f69d16de9954d388' ],
+	[ 12345, 1, '3ed575283f0594e6 4b77bcfa88a79146 6336cf023aa5cafe' ],
+);
+
+SKIP: {
+	skip('xoshiro256** requires 64-bit integers', 7) if $Config{ivsize} < 8;
+	foreach my $vector (@xoshiro_vectors) {
+		my ($seed, $stream, $expected) = @$vector;
+		my $prng_x = GenTest_e::Random->new(
+			seed      => $seed,
+			algorithm => GenTest_e::Random::RANDOM_ALGORITHM_XOSHIRO
+		);
+		$prng_x->setSeed($seed, $stream);
+		# Every 64-bit output gets consumed as four 16-bit values, the highest first.
+		my @words = map { sprintf('%04x%04x%04x%04x', @{$prng_x->uint16Array(0, 65535, 4)}) } (1..3);
+		ok(join(' ', @words) eq $expected, "prng_xoshiro_seed${seed}_stream${stream}");
+	}
+	my $prng_a = GenTest_e::Random->new(
+		seed      => 7,
+		algorithm => GenTest_e::Random::RANDOM_ALGORITHM_XOSHIRO
+	);
+	my $prng_b = GenTest_e::Random->new(
+		seed      => 7,
+		algorithm => GenTest_e::Random::RANDOM_ALGORITHM_XOSHIRO
+	);
+	ok(join(' ', @{$prng_a->uint16Array(3, 1000, 9)}) eq
+	   join(' ', map { $prng_b->uint16(3, 1000) } (1..9)), 'prng_xoshiro_uint16Array');
+}
@@ -0,0 +1,71 @@
+# Copyright (c) 2026 MariaDB plc
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+# USA
+
+use strict;
+use lib 'lib';
+use lib '../lib';
+
+use Test::More;
+
+use GenTest_e::Executor::MySQL;
+
+# Query, expected shape, expected values to bind
+my @cases = (
+    [ "SELECT 1, 'abc' FROM t1",
+      "SELECT 1, 'abc' FROM t1", [] ],
+    [ "SELECT CONCAT(col1, 'x'), 2 + 3 AS s FROM t1 WHERE col1 = 'y'",
+      "SELECT CONCAT(col1, 'x'), 2 + 3 AS s FROM t1 WHERE col1 = ?", [ 'y' ] ],
+    [ "SELECT 7",
+      "SELECT 7", [] ],
+    [ "SELECT col1 FROM t1 WHERE col2 = 1 AND col3 = 'a''b' LIMIT 5",
+      "SELECT col1 FROM t1 WHERE col2 = ? AND col3 = ? LIMIT ?", [ 1, "a'b", 5 ] ],
+    [ "SELECT col1 FROM (SELECT 1 AS col1 FROM t1 WHERE col2 = 4) AS d",
+      "SELECT col1 FROM (SELECT 1 AS col1 FROM t1 WHERE col2 = ?) AS d", [ 4 ] ],
+    [ "SELECT col1 FROM t1 ORDER BY 1",
+      "SELECT col1 FROM t1 ORDER BY 1", [] ],
+    [ "SELECT col1 FROM t1 GROUP BY 1, 2 HAVING COUNT(*) > 3",
+      "SELECT col1 FROM t1 GROUP BY 1, 2 HAVING COUNT(*) > ?", [ 3 ] ],
+    [ "UPDATE t1 SET col1 = CAST(col2 AS CHAR(10)) WHERE col3 = 8",
+      "UPDATE t1 SET col1 = CAST(col2 AS CHAR(10)) WHERE col3 = ?", [ 8 ] ],
+    [ "INSERT INTO t1 (col1) VALUES (_utf8'x'), ('y')",
+      "INSERT INTO t1 (col1) VALUES (_utf8'x'), (?)", [ 'y' ] ],
+    [ "DELETE FROM t1 WHERE t1.1 = 2",
+      "DELETE FROM t1 WHERE t1.1 = ?", [ 2 ] ],
+    [ "DELETE FROM t1 WHERE col1 = 'it\\'s' OR col1 = 'z'",
+      "DELETE FROM t1 WHERE col1 = 'it\\'s' OR col1 = ?", [ 'z' ] ],
+    [ "SELECT col1 FROM t1 WHERE col2 = 1.5",
+      "SELECT col1 FROM t1 WHERE col2 = 1.5", [] ],
+    [ "SELECT col1 FROM t1 /* E_R Thread1 QNO 12 CON_ID 4 */ WHERE col2 = 6",
+      "SELECT col1 FROM t1   WHERE col2 = ?", [ 6 ] ],
+);
+# Text only
+my @text_only = (
+    "SELECT 1; SELECT 2",
+    "SELECT col1 FROM t1 WHERE col2 = ?",
+    "CREATE TABLE t2 (col1 INT)",
+);
+
+plan tests => 2 * @cases + @text_only;
+
+foreach my $case (@cases) {
+    my ($query, $expected_shape, $expected_values) = @$case;
+    my ($shape, $binds) = GenTest_e::Executor::MySQL::ps_shape($query);
+    is($shape, $expected_shape, "ps_shape: $query");
+    is_deeply([ map { $_->[0] } @{$binds || []} ], $expected_values, "ps_binds: $query");
+}
+foreach my $query (@text_only) {
+    ok(not(defined GenTest_e::Executor::MySQL::ps_shape($query)), "ps_text_only: $query");
+}